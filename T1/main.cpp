@@ -9,11 +9,13 @@
 #include "quicksort/quicksort_externo.h"
 #include "file_generator/input_generator.h"       
 #include "misc/block_size.h"      
+#include "misc/modelo_costos.h"
 using namespace std;
 
 
 //Header
 int busqueda_ternaria(int left, int right, size_t M, size_t B, std::string& archivo_entrada, size_t tamano_archivo);
+void validar_modelo(size_t M, size_t B, const CalibracionDispositivo& calibracion, size_t a_modelo);
 void exportToCsv(const std::string& filename, const std::vector<std::tuple<double, size_t>>& data);
 
 /** 
@@ -73,6 +75,45 @@ int busqueda_ternaria(int left, int right, size_t M, size_t B, std::string& arch
     return a;
 }
 
+/**
+ * Compara el I/O que predice el modelo de costos con el contadorIO medido, ordenando un archivo de 8M con ambos
+ * algoritmos para algunas aridades, entre ellas la elegida por el modelo. El quicksort se promedia en 3 ejecuciones
+ * porque sus pivotes son aleatorios
+ * @param M memoria principal o RAM definida
+ * @param B tamaño de bloque
+ * @param calibracion costos del dispositivo
+ * @param a_modelo aridad elegida por el modelo
+ */
+void validar_modelo(size_t M, size_t B, const CalibracionDispositivo& calibracion, size_t a_modelo){
+    std::string archivo_entrada = "validacion.bin";
+    std::string archivo_salida = "validacion_salida.bin";
+    size_t tamano = 8;
+    generate_binary_file(archivo_entrada, M, tamano);
+    ParametrosCosto parametros{tamano * M, M, B, sizeof(int64_t), hilosDisponibles(), 1.0};
+
+    size_t b = B / sizeof(int64_t);
+    std::vector<size_t> aridades = {2, 4, 16, a_modelo, b};
+    cout << "aridad, IO mergesort medido, previsto, IO quicksort medido, previsto" << endl;
+    for (size_t a : aridades) {
+        MergesortExterno mergesort(B, M, a);
+        mergesort.mergesort(archivo_entrada, archivo_salida, tamano * M);
+        double previsto_merge = predecirMergesort(parametros, a, calibracion).bloques;
+
+        QuicksortExterno quicksort(B, M, a);
+        double medido_quick = 0;
+        for (int j = 0; j < 3; j++) {
+            quicksort.ordenar(archivo_entrada, archivo_salida);
+            medido_quick += quicksort.obtenerContadorIO() / 3.0;
+        }
+        double previsto_quick = predecirQuicksort(parametros, a, calibracion).bloques;
+
+        cout << a << ", " << mergesort.obtenerContadorIO() << ", " << previsto_merge << ", "
+             << medido_quick << ", " << previsto_quick << endl;
+    }
+    std::remove(archivo_salida.c_str());
+    std::remove(archivo_entrada.c_str());
+}
+
 /**
  * exporta los datos obtenidos a formato csv
  * @param filename nombre del archivo a exportar
@@ -109,13 +150,15 @@ int main(int argc, char* argv[]){
     }
 
     // Procesar argumentos
-    if (argc == 2) {
+    if (argc >= 2) {
         M = std::stoul(argv[1]) * 1024 * 1024;  // Convertir MB a bytes
     }
 
-    if (argc > 2){
+    // Forma de elegir la aridad: con el modelo de costos, con la busqueda ternaria, o validar el modelo y salir
+    std::string eleccion = (argc == 3) ? argv[2] : "modelo";
+    if (argc > 3 || (eleccion != "modelo" && eleccion != "busqueda" && eleccion != "validar")){
         std::cerr << "Uso:\n"
-            << "  " << argv[0] << " <memoria_en_MB> \n";
+            << "  " << argv[0] << " <memoria_en_MB> [modelo|busqueda|validar]\n";
         return 1;
     }
     
@@ -124,19 +167,31 @@ int main(int argc, char* argv[]){
     std::cout << "- Tamaño del bloque de disco: " << B << std::endl;
 
     // Paso 1: Calculo de a
-    std::string archivo_entrada = filename + ".bin";
-    generate_binary_file(archivo_entrada, M, 60);
-
     size_t tamano_archivo = 60 * M;
     size_t b = B / sizeof(int64_t);
+    int a;
 
-    int a = busqueda_ternaria(2, b, M, B, archivo_entrada, tamano_archivo);
-    //int a = 200;
+    if (eleccion == "busqueda") {
+        std::string archivo_entrada = filename + ".bin";
+        generate_binary_file(archivo_entrada, M, 60);
+        a = busqueda_ternaria(2, b, M, B, archivo_entrada, tamano_archivo);
+        std::remove(archivo_entrada.c_str());
+    } else {
+        // Modelo de costos calibrado con una medicion corta del disco, sin ordenar el archivo de 60M
+        CalibracionDispositivo calibracion = calibrarDispositivo(filename + "_calibracion.bin", B, TipoDispositivo::Posicional);
+        ParametrosCosto parametros{tamano_archivo, M, B, sizeof(int64_t), hilosDisponibles(), 1.0};
+        EleccionAridad eleccion_modelo = elegirAridad(AlgoritmoExterno::Mergesort, parametros, calibracion, 2, b);
+        a = static_cast<int>(eleccion_modelo.aridad);
+        cout << "Prediccion del modelo: " << eleccion_modelo.prediccion.describir() << endl;
+        cout << "Reparto de M previsto en la mezcla final: " << eleccion_modelo.plan.describir() << endl;
+        if (eleccion == "validar") {
+            validar_modelo(M, B, calibracion, eleccion_modelo.aridad);
+            return 0;
+        }
+    }
     
     cout<< "Aridad obtenida: " << a << std::endl;
 
-    std::remove(archivo_entrada.c_str());
-
     // Paso 2: Ordenamiento de archivos
     cout << std::endl;
     std::vector<size_t> N = {4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48, 52, 56, 60};
@@ -147,9 +202,19 @@ int main(int argc, char* argv[]){
     std::vector<std::tuple<int, size_t>> io_quick;
     std::vector<std::tuple<double, size_t>> time_quick;
 
-    // Inicializar estructuras para algoritmos de ordenamiento
-    MergesortExterno mergesort(B, M, a);
-    QuicksortExterno quicksort(B, M, a); 
+    // Inicializar estructuras para algoritmos de ordenamiento, ambos con el mismo dispositivo de bloques
+    TipoDispositivo dispositivo = TipoDispositivo::Posicional;
+    MergesortExterno mergesort(B, M, a, dispositivo);
+    QuicksortExterno quicksort(B, M, a, dispositivo); 
+    cout << "Dispositivo de bloques: " << nombreDispositivo(dispositivo) << endl;
+
+    // Reportar como se reparte M entre los buffers de cada pasada
+    cout << "Reparto de M en la mezcla: " << mergesort.obtenerPlanMezcla().describir() << endl;
+    PlanMezclas plan_60M = mergesort.planMezclasPrevisto(60 * M);
+    cout << "Plan de mezclas para 60M: " << plan_60M.describir() << endl;
+    cout << "Niveles encadenados con la mezcla final: " << planificarEncadenamiento(plan_60M, M, B).niveles << endl;
+    cout << "Reparto de M en la particion: " << quicksort.obtenerPlanParticion().describir() << endl;
+    cout << "Instrucciones de la mezcla de dos tramos: " << nombreNivelSimd(nivelSimdDisponible()) << endl;
 
     // Procesar un archivo a la vez
     for (size_t i = 0; i < N.size(); i++) {
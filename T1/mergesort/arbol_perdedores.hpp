@@ -0,0 +1,146 @@
+#ifndef ARBOL_PERDEDORES_HPP
+#define ARBOL_PERDEDORES_HPP
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/**
+ * Arbol de perdedores (torneo) para la mezcla de k secuencias ordenadas.
+ * Cada hoja guarda el elemento actual de una secuencia; cada nodo interno guarda el indice
+ * de la hoja que perdio en ese nodo, y la raiz (perdedores[0]) guarda al ganador global.
+ * Reemplazar al ganador solo recorre el camino hoja-raiz, por lo que cada elemento de salida
+ * cuesta O(log k) comparaciones en vez de O(k).
+ *
+ * Una hoja agotada pierde contra cualquier hoja activa; cuando el ganador esta agotado, todas
+ * las secuencias terminaron. Los empates se resuelven a favor de la hoja de menor indice,
+ * igual que el recorrido lineal que reemplaza.
+ */
+template <typename T, typename Compare = std::less<T>>
+class ArbolPerdedores {
+private:
+    size_t k;                     // Numero de hojas (secuencias)
+    std::vector<T> claves;        // Elemento actual de cada hoja
+    std::vector<bool> agotada;    // Indica si la secuencia de cada hoja ya termino
+    std::vector<size_t> perdedores; // perdedores[0] es el ganador, perdedores[1..k-1] los nodos internos
+    Compare cmp;
+
+    /**
+     * Indica si la hoja i le gana a la hoja j
+     */
+    bool gana(size_t i, size_t j) const {
+        if (agotada[i]) return false;
+        if (agotada[j]) return true;
+        if (cmp(claves[i], claves[j])) return true;
+        if (cmp(claves[j], claves[i])) return false;
+        return i < j;
+    }
+
+public:
+    /**
+     * Constructor del arbol, todas las hojas parten agotadas hasta que se les asigne un valor
+     * @param num_hojas cantidad de secuencias a mezclar
+     * @param comparador criterio de orden de los elementos
+     */
+    explicit ArbolPerdedores(size_t num_hojas, Compare comparador = Compare())
+        : k(num_hojas), claves(num_hojas), agotada(num_hojas, true),
+          perdedores(num_hojas > 0 ? num_hojas : 1, 0), cmp(comparador) {}
+
+    /**
+     * Asigna el valor inicial de una hoja, se debe llamar antes de construir()
+     * @param i indice de la hoja
+     * @param valor primer elemento de la secuencia i
+     */
+    void fijarHoja(size_t i, const T& valor) {
+        claves[i] = valor;
+        agotada[i] = false;
+    }
+
+    /**
+     * Marca una hoja como agotada antes de construir()
+     * @param i indice de la hoja
+     */
+    void agotarHoja(size_t i) {
+        agotada[i] = true;
+    }
+
+    /**
+     * Juega el torneo completo a partir de los valores de las hojas, O(k)
+     */
+    void construir() {
+        if (k == 0) return;
+
+        // ganadores[n] es el ganador del subarbol n; las hojas viven en [k, 2k)
+        std::vector<size_t> ganadores(2 * k);
+        for (size_t i = 0; i < k; i++) {
+            ganadores[k + i] = i;
+        }
+        for (size_t n = k - 1; n >= 1; n--) {
+            size_t izq = ganadores[2 * n];
+            size_t der = ganadores[2 * n + 1];
+            if (gana(izq, der)) {
+                ganadores[n] = izq;
+                perdedores[n] = der;
+            } else {
+                ganadores[n] = der;
+                perdedores[n] = izq;
+            }
+        }
+        perdedores[0] = ganadores[1];
+    }
+
+    /**
+     * @return true si todas las secuencias se agotaron
+     */
+    bool vacio() const {
+        return k == 0 || agotada[perdedores[0]];
+    }
+
+    /**
+     * @return indice de la hoja ganadora (el menor elemento actual)
+     */
+    size_t ganador() const {
+        return perdedores[0];
+    }
+
+    /**
+     * @return menor elemento actual entre todas las secuencias
+     */
+    const T& valorGanador() const {
+        return claves[perdedores[0]];
+    }
+
+    /**
+     * Reemplaza el elemento de la hoja ganadora por el siguiente de su secuencia y rejuega su camino
+     * @param valor siguiente elemento de la secuencia ganadora
+     */
+    void reemplazarGanador(const T& valor) {
+        claves[perdedores[0]] = valor;
+        rejugar();
+    }
+
+    /**
+     * Marca la secuencia ganadora como agotada y rejuega su camino
+     */
+    void agotarGanador() {
+        agotada[perdedores[0]] = true;
+        rejugar();
+    }
+
+private:
+    /**
+     * Sube desde la hoja ganadora hasta la raiz, intercambiando con los perdedores que ahora ganan
+     */
+    void rejugar() {
+        size_t actual = perdedores[0];
+        for (size_t n = (actual + k) / 2; n > 0; n /= 2) {
+            if (gana(perdedores[n], actual)) {
+                std::swap(perdedores[n], actual);
+            }
+        }
+        perdedores[0] = actual;
+    }
+};
+
+#endif // ARBOL_PERDEDORES_HPP
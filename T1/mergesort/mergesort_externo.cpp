@@ -1,20 +1,40 @@
 #include "mergesort_externo.hpp"
-#include <queue>
-#include <stack>
+#include "arbol_perdedores.hpp"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <sstream>
+#include <thread>
 
 /** 
- * Constructor del mergesort externo, se inicializa declarando el tamaño de bloque, el tamaño de memoria, y la aridad. 
- * Inicializa el contador de I/O en 0, y inicializa un buffer de lectura de tamaño B.
+ * Constructor del mergesort externo, se inicializa declarando el tamaño de bloque, el tamaño de memoria, la aridad
+ * y el dispositivo con que se leen y escriben los bloques (stdio, pread/pwrite, mmap u O_DIRECT).
+ * Inicializa el contador de I/O en 0, un buffer de lectura de tamaño B, el backend de I/O asincrono de la mezcla
+ * (io_uring si esta disponible), y un pool con un hilo por nucleo para ordenar y mezclar los runs.
  */
-MergesortExterno::MergesortExterno(size_t tamano_bloque, size_t tamano_memoria, size_t aridad)
-    : B(tamano_bloque), M(tamano_memoria), a(aridad), contadorIO(0) {
-    buffer = new int64_t[B / sizeof(int64_t)];
+template <typename T, typename Clave>
+MergesortExterno<T, Clave>::MergesortExterno(size_t tamano_bloque, size_t tamano_memoria, size_t aridad, TipoDispositivo dispositivo)
+    : B(tamano_bloque), M(tamano_memoria), a(aridad), contadorIO(0), errorIO(false), modo_runs(GeneracionRuns::VentanasMemoria),
+      dispositivo(dispositivo) {
+    buffer = new T[registrosPorBloque()];
+    backendIO = BackendIO::IoUring;
+    pool.reset(new PoolHilos(hilosDisponibles()));
+    ordenamiento = OrdenamientoMemoria::Comparacion;
+    memoriaAuxiliar = 0;
+    nivelSimd = nivelSimdDisponible();
+    compresionRuns = false;
+    checkpoint = false;
+    mezclaEncadenada = true;
+    planMezcla = planificarBuffers(M, B, a, 1, 2, 2);
 }
 
 /**
  * Destructor de la estructura Mergesort exteno
  */
-MergesortExterno::~MergesortExterno(){
+template <typename T, typename Clave>
+MergesortExterno<T, Clave>::~MergesortExterno(){
     delete[] buffer;
 }
 
@@ -23,12 +43,14 @@ MergesortExterno::~MergesortExterno(){
  * @param archivo archivo que se va a leer
  * @param bloque buffer en el que se va a copiar los valores leidos
  * @param posicion indice en el archivo donde se va a leer
+ * @return cantidad de elementos leidos, menor a B/8 solo en el ultimo bloque del archivo
  */
-void MergesortExterno::leerBloque(FILE* archivo, int64_t* bloque, size_t posicion) {
-    fseek(archivo, posicion * B, SEEK_SET); // Se posiciona el lector en el índice del bloque
-    size_t ignorado = fread(bloque, sizeof(int64_t), B / sizeof(int64_t), archivo); // Se lee el bloque
-    (void)ignorado; // Se ignora el valor es solo para que no salgan flags al compilar
+template <typename T, typename Clave>
+size_t MergesortExterno<T, Clave>::leerBloque(ArchivoBloques& archivo, T* bloque, size_t posicion) {
+    size_t bytes_bloque = registrosPorBloque() * sizeof(T);
+    size_t leidos = archivo.leer(bloque, bytes_bloque, static_cast<uint64_t>(posicion) * bytes_bloque) / sizeof(T); // Se lee el bloque en su posición
     contadorIO++; 
+    return leidos;
 }
 
 /**
@@ -36,458 +58,1422 @@ void MergesortExterno::leerBloque(FILE* archivo, int64_t* bloque, size_t posicio
  * @param archivo archivo sobre el que se va a escribir
  * @param bloque buffer de datos desde el que se va a copiar los datos a escribir
  * @param posicion indice en el archivo, donde se va escribir
+ * @param elementos cantidad de elementos a escribir, B/8 salvo en el ultimo bloque
+ * @return false si la escritura quedo incompleta
  */
-void MergesortExterno::escribirBloque(FILE* archivo, int64_t* bloque, size_t posicion) {
-    fseek(archivo, posicion * B, SEEK_SET);
-    fwrite(bloque, sizeof(int64_t), B / sizeof(int64_t), archivo);
+template <typename T, typename Clave>
+bool MergesortExterno<T, Clave>::escribirBloque(ArchivoBloques& archivo, const T* bloque, size_t posicion, size_t elementos) {
+    size_t escritos = archivo.escribir(bloque, elementos * sizeof(T), static_cast<uint64_t>(posicion) * registrosPorBloque() * sizeof(T));
     contadorIO++;
+    return escritos == elementos * sizeof(T);
 }
 
 /**
- * Divide un archivos en multiples archivos temporales segun la aridad definida
- * @param archivo_entrada nombre del archivo de entrada que se va a dividir
- * @param archivo_salida nombre del archivo de salida donde se va a escribir el resultado final
- * @param inicio indice de inicio del archivo 
- * @param fin posicion del final del archivo
- * 
- * @return vector con los nombres de los archivos temporales creados
- */
-std::vector<std::string> MergesortExterno::dividirArchivo(const std::string& archivo_entrada, const std::string& archivo_salida, size_t inicio, size_t fin) {
-    // Vector para almacenar los nombres de los archivos temporales creados
-    std::vector<std::string> nombres_temp;
-
-    // Calculamos elementos por bloque
-    size_t elementos_por_bloque = B / sizeof(int64_t);
-
-    // Calculamos el número total de elementos
-    size_t num_elementos = fin - inicio;
-    
-    // Abrimos el archivo de entrada
-    FILE* entrada = fopen(archivo_entrada.c_str(), "rb");
-
-    // Calculamos elementos por archivo temporal (distribución equitativa)
-    size_t elementos_por_archivo = (num_elementos + a - 1) / a; // Redondeamos hacia arriba
-    
-    // Creamos y abrimos los archivos temporales
-    std::vector<FILE*> archivos_temp;
-    for (size_t i = 0; i < a; i++) {
-        std::string nombre = archivo_salida + ".temp" + std::to_string(i);
-        FILE* temp = fopen(nombre.c_str(), "wb+");
-
-        nombres_temp.push_back(nombre);
-        archivos_temp.push_back(temp);
-    }
-
-    // Posicionamos el archivo de entrada en el inicio correcto
-    if (fseek(entrada, inicio * sizeof(int64_t), SEEK_SET) != 0) {
-        std::cerr << "Error: No se pudo posicionar en el archivo de entrada" << std::endl;
-        fclose(entrada);
-        for (auto& archivo : archivos_temp) {
-            fclose(archivo);
-        }
-        return nombres_temp;
-    }
-
-    // Distribuimos los elementos del archivo de entrada entre los archivos temporales
-    for (size_t i = 0; i < num_elementos; ) {
-        // Determinamos a qué archivo temporal va este bloque
-        size_t archivo_idx = i / elementos_por_archivo;
-        if (archivo_idx >= a) archivo_idx = a - 1; // Para asegurar que no excedemos la aridad
-        
-        // Leemos un bloque del archivo de entrada
-        size_t elementos_a_leer = std::min(elementos_por_bloque, num_elementos - i); //Menor o igual B
-        size_t leidos = fread(buffer, sizeof(int64_t), elementos_a_leer, entrada);
-        contadorIO++;
-        
-        if (leidos == 0) break; // Si no leímos nada, salimos del bucle
-        
-        // Escribimos el bloque en el archivo temporal correspondiente
-        fwrite(buffer, sizeof(int64_t), leidos, archivos_temp[archivo_idx]);
-        contadorIO++;
-        
-        i += leidos;
-    }
-    
-    // Cerramos todos los archivos
-    fclose(entrada);
-    for (auto& archivo : archivos_temp) {
-        fclose(archivo);
-    }
-    
-    return nombres_temp;
-}
-
-/**
- * Ordena un pequeño archivo que cabe en memoria
+ * Ordena un fragmento del archivo que cabe en memoria. El fragmento se lee directamente desde su posicion
+ * en el archivo de entrada, por lo que inicio debe estar alineado a un bloque. La lectura, el ordenamiento
+ * y la escritura se solapan con ordenarEnPipeline usando el pool de hilos
  * @param archivo_entrada Nombre del archivo a ordenar
  * @param archivo_salida Nombre del archivo de salida
  * @param inicio Índice inicial en el archivo
  * @param fin Índice final en el archivo
+ * @param suma_salida recibe la suma de verificacion del archivo de salida
+ * @param comprimir indica si la salida se escribe en el formato comprimido de los runs
+ * @return false si falla una apertura, una lectura o una escritura; en ese caso marca errorIO
  */
-void MergesortExterno::ordenarEnMemoria(const std::string& archivo_entrada, const std::string& archivo_salida, size_t inicio, size_t fin) {
+template <typename T, typename Clave>
+bool MergesortExterno<T, Clave>::ordenarEnMemoria(const std::string& archivo_entrada, const std::string& archivo_salida, size_t inicio, size_t fin,
+                                                  uint64_t& suma_salida, bool comprimir) {
     size_t num_elementos = fin - inicio;
-    
-    // Reservar memoria para todos los elementos
-    int64_t* data = new int64_t[num_elementos];
+    size_t elementos_por_bloque = registrosPorBloque();  // Número de elementos que caben en un bloque
     
     // Abrir archivo de entrada
-    FILE* entrada = fopen(archivo_entrada.c_str(), "rb");
-    
-    // Posicionar en el punto de inicio
-    if (fseek(entrada, inicio * sizeof(int64_t), SEEK_SET) != 0) {
-        std::cerr << "Error: No se pudo posicionar en el archivo de entrada" << std::endl;
-        fclose(entrada);
-        delete[] data;
-        return;
+    std::unique_ptr<ArchivoBloques> entrada = abrirArchivoBloques(dispositivo, archivo_entrada, ModoApertura::Lectura);
+    if (!entrada) {
+        std::cerr << "Error: No se pudo abrir el archivo de entrada" << std::endl;
+        errorIO = true;
+        return false;
     }
     
-    // Leer todos los elementos
-    size_t posicion_data = 0;  // Índice para controlar la posición dentro de 'data'
-    size_t elementos_por_bloque = B / sizeof(int64_t);  // Número de elementos que caben en un bloque
-    size_t elementos_leidos = 0;
-    while (posicion_data < num_elementos) {
-        // Calcula cuántos elementos leer en este bloque
-        size_t elementos_a_leer = std::min(elementos_por_bloque, num_elementos - posicion_data);
-
-        // Lee un bloque del archivo
-        leerBloque(entrada, buffer, posicion_data / elementos_por_bloque);
-
-        // Copia el contenido del buffer a 'data' de forma secuencial
-        memcpy(data + posicion_data, buffer, elementos_a_leer * sizeof(int64_t));
-
-        // Actualiza la posición en 'data'
-        posicion_data += elementos_a_leer;
-        elementos_leidos += elementos_a_leer;
+    // Abrir archivo de salida
+    std::unique_ptr<ArchivoBloques> salida = abrirArchivoBloques(dispositivo, archivo_salida, ModoApertura::Escritura);
+    if (!salida) {
+        std::cerr << "Error al abrir archivo de salida: " << archivo_salida << std::endl;
+        errorIO = true;
+        return false;
     }
-    fclose(entrada);
     
-    // Ordenar los datos leídos
-    std::sort(data, data + elementos_leidos);
+    // Reservar memoria para todos los elementos
+    T* data = new T[num_elementos];
     
-    // Escribir los datos ordenados al archivo de salida
-    FILE* salida = fopen(archivo_salida.c_str(), "wb");
-
-    //Escribimos en el archivo desde data
-    posicion_data = 0;  
-    while (posicion_data < elementos_leidos) {
-        // Calcula cuántos elementos a escribir en este bloque
-        size_t elementos_a_escribir = std::min(elementos_por_bloque, elementos_leidos - posicion_data);
-        // Copia el bloque correspondiente en el buffer
-        memcpy(buffer, data + posicion_data, elementos_a_escribir * sizeof(int64_t));
-        // Escribe el bloque en el archivo
-        escribirBloque(salida, buffer, posicion_data / elementos_por_bloque);
-        // Actualiza la posición en 'data'
-        posicion_data += elementos_a_escribir;
-    }
-    fclose(salida);
+    // Lectura por bloques a partir del bloque donde comienza el fragmento
+    size_t bloque_lectura = inicio / elementos_por_bloque;
+    auto leer = [&](T* destino, size_t cantidad) -> size_t {
+        size_t leidos = leerBloque(*entrada, buffer, bloque_lectura++);
+        size_t elementos_a_copiar = std::min(leidos, cantidad);
+        memcpy(destino, buffer, elementos_a_copiar * sizeof(T));
+        return elementos_a_copiar;
+    };
+    
+    // Escritura secuencial por bloques en el archivo de salida, o por marcos comprimidos (solo con int64_t)
+    size_t bloque_escritura = 0;
+    SumaVerificacion suma;
+    std::unique_ptr<EscritorComprimido> comprimido;
+    if (comprimir) comprimido.reset(new EscritorComprimido(*salida, B, contadorIO));
+    bool escritura_corta = false;
+    auto escribir = [&](const T* origen, size_t cantidad) {
+        if (comprimido) {
+            comprimido->agregar(reinterpret_cast<const int64_t*>(origen), cantidad);
+        } else {
+            escritura_corta = !escribirBloque(*salida, origen, bloque_escritura++, cantidad) || escritura_corta;
+            suma.agregar(origen, cantidad * sizeof(T));
+        }
+    };
+    
+    size_t ordenados = ordenarEnPipeline<T, Clave>(data, num_elementos, elementos_por_bloque, *pool, leer, escribir, ordenamiento,
+                                                   memoriaAuxiliar);
+    if (comprimido) comprimido->terminar();
     
     delete[] data;
+    suma_salida = comprimido ? comprimido->obtenerSuma() : suma.valor();
+    if (ordenados != num_elementos || escritura_corta || (comprimido && comprimido->fallo())) {
+        std::cerr << "Error al generar el run " << archivo_salida << ": se leyeron " << ordenados << " de " << num_elementos
+                  << " registros" << (ordenados == num_elementos ? " y una escritura quedo incompleta" : "") << std::endl;
+        errorIO = true;
+        return false;
+    }
+    return true;
 }
 
 /**
- * mezcla los archivos temporales que pertenecen al mismo archivo original, manteniendo orden del arreglo
- * @param archivos_temp vector con los nombres de los archivos temporales para este nivel
- * @param archivo_salida nombre del archivo de salida al mezclar los archivos temporales
+ * Mezcla tramos ordenados de uno o mas archivos y escribe el resultado en 'salida' a partir de 'offset_salida'.
+ * El minimo entre las cabezas de los tramos se obtiene con un arbol de perdedores, O(log a) comparaciones por elemento.
+ * Con solo dos tramos se usa en cambio la mezcla vectorial de mezclarDos, sin saltos por cada elemento.
+ * Cada tramo tiene dos buffers: mientras se consume uno, el motor de I/O precarga el siguiente pedazo en el otro.
+ * La salida tambien usa dos buffers, uno se llena mientras el otro se escribe en segundo plano con escrituras
+ * posicionales, por lo que varias mezclas pueden escribir a la vez rangos disjuntos del mismo archivo.
+ * Los archivos se abren con el dispositivo configurado y cada transferencia se pide al motor sobre el descriptor
+ * que entrega el dispositivo (con O_DIRECT, el directo si esta alineada, que es lo normal porque los buffers son
+ * BufferAlineado); con stdio y mmap, que no trabajan sobre un descriptor, la transferencia se hace en el momento.
+ * Con runs comprimidos cada pedazo leido se descomprime de a un marco, y una salida comprimida solo escribe marcos
+ * llenos: los valores que no completan un marco pasan al otro buffer hasta el final de la mezcla.
+ * @param tramos tramos a mezclar, cada uno ordenado
+ * @param salida archivo de salida, abierto para escribir; nulo con sumidero
+ * @param offset_salida byte del archivo de salida donde comienza el resultado
+ * @param plan reparto de memoria entre los buffers de entrada y de salida
+ * @param entrada_comprimida indica si los tramos estan en el formato comprimido de los runs (solo con int64_t)
+ * @param salida_comprimida indica si el resultado se escribe en el formato comprimido de los runs (solo con int64_t)
+ * @param suma si no es nulo, acumula la suma de verificacion de los bytes escritos, en orden
+ * @param sumidero si no es nulo, recibe cada buffer de salida lleno en vez de escribirlo en 'salida' (sin comprimir),
+ * y al final se llama con 0 elementos. Si devuelve false la mezcla se detiene
+ * @param flujos si no es nulo, mezclas encadenadas que se mezclan ademas de los tramos, sin comprimir y sin pasar
+ * por disco; no cuentan I/O
+ * @return false si no se pudo abrir un tramo o una lectura o escritura fallo o quedo corta. La mezcla se detiene
+ * ahi, el resultado queda incompleto y se marca errorIO
  */
-void MergesortExterno::mergeArchivos(const std::vector<std::string>& archivos_temp, const std::string& archivo_salida) {
-    const size_t elementos_por_bloque = B / sizeof(int64_t);
+template <typename T, typename Clave>
+bool MergesortExterno<T, Clave>::mergeTramos(const std::vector<TramoRun>& tramos, ArchivoBloques* salida, uint64_t offset_salida, const PlanBuffers& plan,
+                                             bool entrada_comprimida, bool salida_comprimida, SumaVerificacion* suma,
+                                             const SumideroMezcla<T>* sumidero, const std::vector<FlujoOrdenado<T>*>* flujos) {
+    const size_t elementos_por_buffer = plan.elementosPorBuffer(sizeof(T));
+    const size_t bytes_por_buffer = elementos_por_buffer * sizeof(T);
+    entrada_comprimida = entrada_comprimida && std::is_same<T, int64_t>::value;
+    salida_comprimida = salida_comprimida && std::is_same<T, int64_t>::value && !sumidero;
+    // Una salida comprimida guarda ademas los valores que no alcanzaron a completar un marco
+    const size_t elementos_salida = salida_comprimida ? std::max(elementos_por_buffer, 2 * maxElementosPorMarco(B)) : elementos_por_buffer;
+    // Un tramo o una salida que no empieza alineada (las partes de la mezcla particionada) acorta su primera
+    // transferencia hasta el siguiente multiplo de 'paso', asi con O_DIRECT el resto va por el descriptor directo
+    const uint64_t paso = std::lcm<uint64_t>(sizeof(T), ALINEAMIENTO_DIRECTO);
     
-    // Estructuras para manejar cada archivo temporal
+    // Cada mezcla usa su propio motor, asi las mezclas concurrentes no comparten el anillo de io_uring
+    std::unique_ptr<MotorIO> motor = crearMotorIO(backendIO);
+    
+    // Estructuras para manejar cada tramo
     struct ArchivoTemp {
-        FILE* archivo;
-        std::vector<int64_t> buffer;
-        size_t pos_actual;      // Posición actual en el buffer
+        std::unique_ptr<ArchivoBloques> archivo; // Archivo del tramo, nulo si es un flujo
+        const std::string* nombre;      // Archivo del tramo, para los mensajes de error
+        FlujoOrdenado<T>* flujo;        // Mezcla encadenada que entrega este tramo, nullptr si se lee de un archivo
+        BufferAlineado<T> buffer;       // Pedazo que se esta consumiendo
+        BufferAlineado<T> siguiente;    // Pedazo que se esta precargando
+        std::vector<T> marco;           // Marco descomprimido del pedazo, solo con runs comprimidos
+        const T* datos;                 // Elementos que se estan consumiendo: el pedazo o el marco
+        size_t bytes_validos;    // Bytes leidos en el pedazo
+        size_t pos_marco;        // Byte del pedazo donde empieza el siguiente marco
+        uint64_t ticket;         // Operación de lectura en curso sobre 'siguiente'
+        bool pendiente;          // Indica si hay una lectura en curso
+        bool en_motor;           // Indica si la lectura en curso la hace el motor; si no, ya se hizo al pedirla
+        long resultado;          // Bytes leidos por una lectura que no hizo el motor
+        size_t pedidos;          // Bytes de la lectura en curso
+        uint64_t offset;         // Byte del archivo donde comienza el próximo pedazo a pedir
+        uint64_t fin;            // Byte del archivo donde termina el tramo
+        size_t pos_actual;       // Posición actual en el buffer
         size_t elementos_leidos; // Elementos válidos en el buffer
-        bool fin_archivo;       // Indicador de fin de archivo
+        bool fin_archivo;        // Indicador de fin del tramo
+    };
+    bool error = false; // Una lectura o escritura fallo, la mezcla se detiene
+    
+    // Pide al motor el siguiente pedazo de un tramo, si queda algo por leer
+    auto precargar = [&](ArchivoTemp& archivo) {
+        size_t bytes = static_cast<size_t>(std::min<uint64_t>(bytes_por_buffer, archivo.fin - archivo.offset));
+        uint64_t fin_pedazo = (archivo.offset + bytes) / paso * paso;
+        if (!entrada_comprimida && archivo.offset + bytes < archivo.fin && fin_pedazo > archivo.offset) {
+            bytes = static_cast<size_t>(fin_pedazo - archivo.offset);
+        }
+        archivo.pendiente = (bytes > 0);
+        if (archivo.pendiente) {
+            int fd = archivo.archivo->descriptorLectura(archivo.offset, bytes, archivo.siguiente.data());
+            archivo.en_motor = (fd >= 0);
+            if (archivo.en_motor) {
+                archivo.ticket = motor->leer(fd, archivo.siguiente.data(), bytes, archivo.offset);
+            } else {
+                archivo.resultado = static_cast<long>(archivo.archivo->leer(archivo.siguiente.data(), bytes, archivo.offset));
+            }
+            archivo.pedidos = bytes;
+            archivo.offset += bytes;
+        }
+    };
+    
+    // Descomprime el siguiente marco del pedazo activo
+    auto descomprimirSiguiente = [&](ArchivoTemp& archivo) {
+        const unsigned char* marco = reinterpret_cast<const unsigned char*>(archivo.buffer.data()) + archivo.pos_marco;
+        archivo.elementos_leidos = descomprimirMarco(marco, reinterpret_cast<int64_t*>(archivo.marco.data()));
+        archivo.pos_marco += B;
+        archivo.pos_actual = 0;
+        archivo.datos = archivo.marco.data();
+    };
+    
+    // Espera el pedazo precargado, lo deja como buffer activo y pide el que sigue. Con runs comprimidos primero
+    // se agotan los marcos del pedazo activo
+    auto avanzarBloque = [&](ArchivoTemp& archivo) {
+        if (archivo.flujo) {
+            // El lote del flujo se usa en su lugar, sigue valido hasta pedir el siguiente
+            archivo.elementos_leidos = archivo.flujo->siguienteLote(archivo.datos);
+            archivo.pos_actual = 0;
+            archivo.fin_archivo = (archivo.elementos_leidos == 0);
+            return;
+        }
+        if (entrada_comprimida && archivo.pos_marco < archivo.bytes_validos) {
+            descomprimirSiguiente(archivo);
+            return;
+        }
+        long bytes = 0;
+        if (archivo.pendiente) {
+            bytes = archivo.en_motor ? motor->esperar(archivo.ticket) : archivo.resultado;
+            archivo.pendiente = false;
+            // El tramo termina antes del fin del archivo, asi que una lectura corta tambien es un error
+            if (bytes != static_cast<long>(archivo.pedidos)) {
+                std::cerr << "Error al leer archivo temporal: " << *archivo.nombre << std::endl;
+                error = true;
+                bytes = 0;
+            }
+            contadorIO += bloquesTransferidos(bytes, B); // Contar bloques leídos
+        }
+        std::swap(archivo.buffer, archivo.siguiente);
+        archivo.bytes_validos = (bytes > 0) ? static_cast<size_t>(bytes) : 0;
+        archivo.elementos_leidos = archivo.bytes_validos / sizeof(T);
+        archivo.pos_actual = 0;
+        archivo.datos = archivo.buffer.data();
+        archivo.fin_archivo = (archivo.elementos_leidos == 0);
+        if (!archivo.fin_archivo) {
+            precargar(archivo);
+        }
+        if (entrada_comprimida && !archivo.fin_archivo) {
+            archivo.pos_marco = 0;
+            descomprimirSiguiente(archivo);
+        }
     };
     
-    std::vector<ArchivoTemp> archivos(archivos_temp.size());
+    size_t num_flujos = flujos ? flujos->size() : 0;
+    std::vector<ArchivoTemp> archivos(tramos.size() + num_flujos);
     
-    // Abrir todos los archivos temporales e inicializar buffers
-    for (size_t i = 0; i < archivos_temp.size(); ++i) {
-        archivos[i].archivo = fopen(archivos_temp[i].c_str(), "rb");
+    // Abrir todos los archivos e inicializar buffers
+    for (size_t i = 0; i < tramos.size(); ++i) {
+        archivos[i].nombre = &tramos[i].nombre;
+        archivos[i].flujo = nullptr;
+        archivos[i].pendiente = false;
+        archivos[i].archivo = abrirArchivoBloques(dispositivo, tramos[i].nombre, ModoApertura::Lectura);
         if (!archivos[i].archivo) {
             // Manejar error de apertura de archivo
-            std::cerr << "Error al abrir archivo temporal: " << archivos_temp[i] << std::endl;
+            std::cerr << "Error al abrir archivo temporal: " << tramos[i].nombre << std::endl;
             
-            // Cerrar archivos ya abiertos
+            // Esperar las lecturas en curso; los archivos ya abiertos se cierran al salir
             for (size_t j = 0; j < i; ++j) {
-                fclose(archivos[j].archivo);
+                if (archivos[j].pendiente && archivos[j].en_motor) motor->esperar(archivos[j].ticket);
             }
-            return;
+            errorIO = true;
+            return false;
         }
         
-        archivos[i].buffer.resize(elementos_por_bloque);
-        archivos[i].pos_actual = 0;
-        
-        // Leer el primer bloque de cada archivo
-        archivos[i].elementos_leidos = fread(archivos[i].buffer.data(), sizeof(int64_t), 
-                                            elementos_por_bloque, archivos[i].archivo);
-        contadorIO++; // Contar operación I/O
+        archivos[i].buffer.resize(elementos_por_buffer);
+        archivos[i].siguiente.resize(elementos_por_buffer);
+        if (entrada_comprimida) archivos[i].marco.resize(maxElementosPorMarco(B));
+        archivos[i].bytes_validos = 0;
+        archivos[i].pos_marco = 0;
+        archivos[i].offset = tramos[i].inicio * sizeof(T);
+        archivos[i].fin = tramos[i].fin * sizeof(T);
         
-        archivos[i].fin_archivo = (archivos[i].elementos_leidos == 0);
+        // Leer el primer pedazo de cada tramo, dejando pedido el segundo
+        precargar(archivos[i]);
+        avanzarBloque(archivos[i]);
     }
     
-    // Abrir archivo de salida
-    FILE* salida = fopen(archivo_salida.c_str(), "wb");
-    if (!salida) {
-        std::cerr << "Error al abrir archivo de salida: " << archivo_salida << std::endl;
-        // Cerrar archivos temporales
-        for (auto& archivo : archivos) {
-            fclose(archivo.archivo);
-        }
-        return;
+    // Los flujos no usan buffers de entrada, se mezclan directo desde los lotes que entregan
+    for (size_t i = tramos.size(); i < archivos.size(); ++i) {
+        archivos[i].nombre = nullptr;
+        archivos[i].flujo = (*flujos)[i - tramos.size()];
+        archivos[i].pendiente = false;
+        avanzarBloque(archivos[i]);
     }
     
-    // Buffer para escribir en archivo de salida
-    std::vector<int64_t> buffer_salida;
-    buffer_salida.resize(elementos_por_bloque);
+    // Doble buffer para escribir en archivo de salida. Con salida comprimida lo que se escribe son los marcos
+    BufferAlineado<T> buffers_salida[2] = {BufferAlineado<T>(elementos_salida), BufferAlineado<T>(elementos_salida)};
+    BufferAlineado<unsigned char> marcos_salida[2];
+    if (salida_comprimida) {
+        size_t max_marcos = (elementos_salida + minElementosPorMarco(B) - 1) / minElementosPorMarco(B);
+        marcos_salida[0].resize(max_marcos * B);
+        marcos_salida[1].resize(max_marcos * B);
+    }
+    uint64_t tickets_salida[2] = {0, 0};
+    size_t bytes_salida[2] = {0, 0};
+    long resultado_salida[2] = {0, 0}; // Bytes de una escritura que no hizo el motor
+    bool en_motor_salida[2] = {false, false};
+    bool escribiendo[2] = {false, false};
+    size_t actual_salida = 0;
     size_t pos_buffer_salida = 0;
+    size_t limite_salida = elementos_salida; // Elementos con que se vacia el buffer actual
+    uint64_t fin_primero = (offset_salida + elementos_salida * sizeof(T)) / paso * paso;
+    if (salida && !salida_comprimida && offset_salida % paso != 0 && fin_primero > offset_salida) {
+        limite_salida = static_cast<size_t>((fin_primero - offset_salida) / sizeof(T));
+    }
+    bool detenida = false; // El sumidero pidio detener la mezcla
     
-    // Proceso de mezcla
-    while (true) {
-        // Encontrar el valor mínimo entre todos los archivos
-        int64_t min_valor = INT64_MAX;
-        int min_indice = -1;
-        
-        for (size_t i = 0; i < archivos.size(); ++i) {
-            if (!archivos[i].fin_archivo && 
-                archivos[i].pos_actual < archivos[i].elementos_leidos) {
-                
-                int64_t valor_actual = archivos[i].buffer[archivos[i].pos_actual];
-                if (min_indice == -1 || valor_actual < min_valor) {
-                    min_valor = valor_actual;
-                    min_indice = i;
-                }
+    // Espera la escritura en curso de un buffer de salida; una escritura corta es un error
+    auto esperarEscritura = [&](size_t i) {
+        if (!escribiendo[i]) return;
+        escribiendo[i] = false;
+        long escritos = en_motor_salida[i] ? motor->esperar(tickets_salida[i]) : resultado_salida[i];
+        if (escritos != static_cast<long>(bytes_salida[i])) {
+            std::cerr << "Error al escribir la salida de la mezcla" << std::endl;
+            error = true;
+        }
+    };
+    
+    // Envia el buffer de salida actual a escribir y cambia al otro, esperando si aun se esta escribiendo
+    auto vaciarSalida = [&](bool final) {
+        if (sumidero) {
+            // El sumidero usa el buffer hasta que vuelve a pedir, asi que se cambia al otro sin escribir
+            detenida = !(*sumidero)(buffers_salida[actual_salida].data(), pos_buffer_salida);
+            pos_buffer_salida = 0;
+            actual_salida = 1 - actual_salida;
+            return;
+        }
+        const void* origen = buffers_salida[actual_salida].data();
+        size_t bytes = pos_buffer_salida * sizeof(T);
+        size_t restantes = 0;
+        if (salida_comprimida) {
+            // Solo marcos llenos salvo al final; el resto se mueve al comienzo del otro buffer
+            const int64_t* valores = reinterpret_cast<const int64_t*>(buffers_salida[actual_salida].data());
+            size_t usados = 0;
+            bytes = 0;
+            while (usados < pos_buffer_salida && (final || pos_buffer_salida - usados >= maxElementosPorMarco(B))) {
+                usados += comprimirMarco(valores + usados, pos_buffer_salida - usados, marcos_salida[actual_salida].data() + bytes, B);
+                bytes += B;
             }
+            restantes = pos_buffer_salida - usados;
+            memcpy(buffers_salida[1 - actual_salida].data(), valores + usados, restantes * sizeof(T));
+            origen = marcos_salida[actual_salida].data();
         }
-        
-        // Si no encontramos un valor mínimo, todos los archivos han sido procesados
-        if (min_indice == -1) break;
+        if (suma) suma->agregar(origen, bytes);
+        int fd = salida->descriptorEscritura(offset_salida, bytes, origen);
+        en_motor_salida[actual_salida] = (fd >= 0);
+        if (fd >= 0) {
+            tickets_salida[actual_salida] = motor->escribir(fd, origen, bytes, offset_salida);
+        } else {
+            resultado_salida[actual_salida] = static_cast<long>(salida->escribir(origen, bytes, offset_salida));
+        }
+        bytes_salida[actual_salida] = bytes;
+        escribiendo[actual_salida] = true;
+        contadorIO += bloquesTransferidos(bytes, B); // Contar bloques escritos
+        offset_salida += bytes;
+        pos_buffer_salida = restantes;
+        limite_salida = elementos_salida;
+        actual_salida = 1 - actual_salida;
+        esperarEscritura(actual_salida);
+    };
+    
+    // Con dos tramos de int64_t se mezcla por pedazos con el kernel vectorial, sin pasar por el arbol elemento a elemento
+    if constexpr (std::is_same<T, int64_t>::value) {
+        if (archivos.size() == 2) {
+            ArchivoTemp& x = archivos[0];
+            ArchivoTemp& y = archivos[1];
+            while (!x.fin_archivo && !y.fin_archivo && !detenida && !error) {
+                mezclarDos(x.datos, x.pos_actual, x.elementos_leidos,
+                           y.datos, y.pos_actual, y.elementos_leidos,
+                           buffers_salida[actual_salida].data(), pos_buffer_salida, limite_salida, nivelSimd);
+                if (x.pos_actual == x.elementos_leidos) avanzarBloque(x);
+                if (y.pos_actual == y.elementos_leidos) avanzarBloque(y);
+                if (pos_buffer_salida == limite_salida) vaciarSalida(false);
+            }
+    
+            // Copiar lo que queda del tramo que no se agoto
+            ArchivoTemp& resto = x.fin_archivo ? y : x;
+            while (!resto.fin_archivo && !detenida && !error) {
+                size_t cantidad = std::min(resto.elementos_leidos - resto.pos_actual, limite_salida - pos_buffer_salida);
+                memcpy(buffers_salida[actual_salida].data() + pos_buffer_salida, resto.datos + resto.pos_actual, cantidad * sizeof(T));
+                resto.pos_actual += cantidad;
+                pos_buffer_salida += cantidad;
+                if (resto.pos_actual == resto.elementos_leidos) avanzarBloque(resto);
+                if (pos_buffer_salida == limite_salida) vaciarSalida(false);
+            }
+        }
+    }
+    
+    // Arbol de perdedores con la cabeza de cada tramo, el ganador es el minimo actual
+    ArbolPerdedores<T, MenorPorClave<T, Clave>> arbol(archivos.size());
+    for (size_t i = 0; i < archivos.size(); ++i) {
+        if (!archivos[i].fin_archivo) {
+            arbol.fijarHoja(i, archivos[i].datos[0]);
+        }
+    }
+    arbol.construir();
+    
+    // Proceso de mezcla
+    while (!arbol.vacio() && !detenida && !error) {
+        size_t min_indice = arbol.ganador();
+        ArchivoTemp& actual = archivos[min_indice];
         
         // Agregar el valor mínimo al buffer de salida
-        buffer_salida[pos_buffer_salida++] = min_valor;
+        buffers_salida[actual_salida][pos_buffer_salida++] = arbol.valorGanador();
         
-        // Incrementar la posición en el archivo del valor mínimo
-        archivos[min_indice].pos_actual++;
+        // Incrementar la posición en el tramo del valor mínimo
+        actual.pos_actual++;
         
-        // Si agotamos el buffer de este archivo, cargar un nuevo bloque
-        if (archivos[min_indice].pos_actual >= archivos[min_indice].elementos_leidos) {
-            archivos[min_indice].elementos_leidos = fread(
-                archivos[min_indice].buffer.data(), 
-                sizeof(int64_t), 
-                elementos_por_bloque, 
-                archivos[min_indice].archivo
-            );
-            contadorIO++; // Contar operación I/O
-            
-            archivos[min_indice].pos_actual = 0;
-            
-            // Verificar si hemos llegado al fin del archivo
-            if (archivos[min_indice].elementos_leidos == 0) {
-                archivos[min_indice].fin_archivo = true;
-            }
+        // Si agotamos el buffer de este tramo, pasar al pedazo precargado
+        if (actual.pos_actual >= actual.elementos_leidos) {
+            avanzarBloque(actual);
+        }
+        
+        // Actualizar la hoja del tramo en el arbol, O(log a) comparaciones
+        if (actual.fin_archivo) {
+            arbol.agotarGanador();
+        } else {
+            arbol.reemplazarGanador(actual.datos[actual.pos_actual]);
         }
         
         // Si el buffer de salida está lleno, escribirlo al archivo
-        if (pos_buffer_salida == elementos_por_bloque) {
-            fwrite(buffer_salida.data(), sizeof(int64_t), elementos_por_bloque, salida);
-            contadorIO++; // Contar operación I/O
-            pos_buffer_salida = 0;
+        if (pos_buffer_salida == limite_salida) {
+            vaciarSalida(false);
         }
     }
     
-    // Escribir cualquier dato restante en el buffer de salida (tamaño menor a B)
-    if (pos_buffer_salida > 0) {
-        fwrite(buffer_salida.data(), sizeof(int64_t), pos_buffer_salida, salida);
-        contadorIO++; // Contar operación I/O
+    // Escribir cualquier dato restante en el buffer de salida
+    if (pos_buffer_salida > 0 && !detenida && !error) {
+        vaciarSalida(true);
     }
+    if (sumidero && !error) (*sumidero)(nullptr, 0);
     
-    // Cerrar todos los archivos
-    fclose(salida);
+    // Esperar las escrituras y las lecturas pendientes; los archivos de entrada se cierran al salir
+    for (size_t i = 0; i < 2; ++i) {
+        esperarEscritura(i);
+    }
     for (auto& archivo : archivos) {
-        fclose(archivo.archivo);
+        if (archivo.pendiente && archivo.en_motor) motor->esperar(archivo.ticket);
     }
+    if (error) errorIO = true;
+    return !error;
 }
 
 /**
- * Estructura para manejar fragmentos de archivos en el proceso iterativo
+ * mezcla los archivos temporales que pertenecen al mismo archivo original, manteniendo orden del arreglo
+ * @param archivos_temp vector con los nombres de los archivos temporales para este nivel
+ * @param archivo_salida nombre del archivo de salida al mezclar los archivos temporales
+ * @param plan reparto de memoria entre los buffers de entrada y de salida
+ * @param entrada_comprimida indica si los archivos estan en el formato comprimido de los runs
+ * @param salida_comprimida indica si el resultado se escribe en el formato comprimido de los runs
+ * @param suma si no es nulo, acumula la suma de verificacion del archivo de salida
+ * @return false si hubo un error de I/O; el archivo de salida queda incompleto
  */
-struct FragmentoArchivo {
-    std::string nombre;
-    size_t inicio;
-    size_t fin;
-};
+template <typename T, typename Clave>
+bool MergesortExterno<T, Clave>::mergeArchivos(const std::vector<std::string>& archivos_temp, const std::string& archivo_salida, const PlanBuffers& plan,
+                                               bool entrada_comprimida, bool salida_comprimida, SumaVerificacion* suma) {
+    // Cada archivo se mezcla completo, su tamaño define el fin del tramo (en un run comprimido se cuenta en
+    // palabras de 8 bytes, que es lo que mergeTramos lee)
+    std::vector<TramoRun> tramos;
+    for (const auto& nombre : archivos_temp) {
+        tramos.push_back({nombre, 0, elementosEnArchivo(nombre)});
+    }
+    
+    // Abrir archivo de salida
+    std::unique_ptr<ArchivoBloques> salida = abrirArchivoBloques(dispositivo, archivo_salida, ModoApertura::Escritura);
+    if (!salida) {
+        std::cerr << "Error al abrir archivo de salida: " << archivo_salida << std::endl;
+        errorIO = true;
+        return false;
+    }
+    return mergeTramos(tramos, salida.get(), 0, plan, entrada_comprimida, salida_comprimida, suma);
+}
+
+/**
+ * Mezcla final dividida por rangos de claves. Se muestrean bloques de cada run para elegir 'particiones' - 1
+ * separadores que reparten los elementos en partes parecidas, se ubica cada separador en cada run con busqueda
+ * binaria por bloques, y cada parte se mezcla en paralelo escribiendo su propio rango de bytes del archivo de
+ * salida. Como la parte j contiene exactamente los elementos entre el separador j-1 y el j, el resultado es
+ * identico al de una mezcla secuencial.
+ * @param runs nombres de los runs ordenados a mezclar
+ * @param archivo_salida nombre del archivo de salida
+ * @param particiones cantidad de partes que se mezclan en paralelo
+ * @return false si hubo un error de I/O; el archivo de salida queda incompleto
+ */
+template <typename T, typename Clave>
+bool MergesortExterno<T, Clave>::mergeFinalParticionado(const std::vector<std::string>& runs, const std::string& archivo_salida, size_t particiones) {
+    const size_t elementos_por_bloque = registrosPorBloque();
+    const size_t k = runs.size();
+    
+    // Lee un elemento o un bloque de un run, cada lectura cuenta como un acceso a bloque
+    Clave clave_de;
+    auto leerElementos = [&](ArchivoBloques& archivo, size_t posicion, T* destino, size_t cantidad) -> size_t {
+        size_t bytes = archivo.leer(destino, cantidad * sizeof(T), static_cast<uint64_t>(posicion) * sizeof(T));
+        contadorIO++;
+        return bytes / sizeof(T);
+    };
+    
+    // Muestra: clave del primer elemento de bloques equiespaciados de cada run, junto al numero de bloque
+    struct Muestra {
+        int64_t valor;
+        size_t bloque;
+        double peso; // Elementos que representa la muestra
+    };
+    std::vector<std::unique_ptr<ArchivoBloques>> archivos(k);
+    std::vector<size_t> tamanos(k);
+    std::vector<std::vector<Muestra>> muestras(k);
+    std::vector<Muestra> todas;
+    size_t total = 0;
+    for (size_t r = 0; r < k; r++) {
+        archivos[r] = abrirArchivoBloques(dispositivo, runs[r], ModoApertura::Lectura);
+        if (!archivos[r]) {
+            std::cerr << "Error al abrir archivo temporal: " << runs[r] << std::endl;
+            errorIO = true;
+            return false;
+        }
+        tamanos[r] = archivos[r]->tamano() / sizeof(T);
+        total += tamanos[r];
+        size_t bloques = (tamanos[r] + elementos_por_bloque - 1) / elementos_por_bloque;
+        size_t num_muestras = std::min<size_t>(bloques, 4 * particiones);
+        for (size_t t = 0; t < num_muestras; t++) {
+            size_t bloque = t * bloques / num_muestras;
+            T registro;
+            if (leerElementos(*archivos[r], bloque * elementos_por_bloque, &registro, 1) == 1) {
+                Muestra m{clave_de(registro), bloque, static_cast<double>(tamanos[r]) / num_muestras};
+                muestras[r].push_back(m);
+                todas.push_back(m);
+            }
+        }
+    }
+    
+    // Separadores: cuantiles de las muestras ponderadas por la cantidad de elementos que representan
+    std::sort(todas.begin(), todas.end(), [](const Muestra& x, const Muestra& y) { return x.valor < y.valor; });
+    std::vector<int64_t> separadores;
+    double acumulado = 0;
+    size_t siguiente_corte = 1;
+    for (const auto& m : todas) {
+        acumulado += m.peso;
+        while (siguiente_corte < particiones && acumulado >= static_cast<double>(total) * siguiente_corte / particiones) {
+            separadores.push_back(m.valor);
+            siguiente_corte++;
+        }
+    }
+    
+    // Primera posicion de cada run con un elemento >= separador. Las muestras acotan el rango de bloques
+    // y se termina con busqueda binaria leyendo el primer elemento de cada bloque probado
+    auto ubicar = [&](size_t r, int64_t separador) -> size_t {
+        size_t bloques = (tamanos[r] + elementos_por_bloque - 1) / elementos_por_bloque;
+        size_t lo = 0, hi = bloques;
+        bool hay_menor = false;
+        for (const auto& m : muestras[r]) {
+            if (m.valor < separador) {
+                lo = m.bloque;
+                hay_menor = true;
+            } else {
+                hi = m.bloque;
+                break;
+            }
+        }
+        if (!hay_menor) return 0; // El primer bloque ya comienza en un valor >= separador
+        
+        // Invariante: primer(lo) < separador, y primer(hi) >= separador o hi es el fin del run
+        while (hi - lo > 1) {
+            size_t medio = lo + (hi - lo) / 2;
+            T registro;
+            leerElementos(*archivos[r], medio * elementos_por_bloque, &registro, 1);
+            if (clave_de(registro) < separador) lo = medio; else hi = medio;
+        }
+        std::vector<T> bloque(elementos_por_bloque);
+        size_t leidos = leerElementos(*archivos[r], lo * elementos_por_bloque, bloque.data(), elementos_por_bloque);
+        auto primero_mayor_igual = std::lower_bound(bloque.begin(), bloque.begin() + leidos, separador,
+                                                    [&](const T& x, int64_t s) { return clave_de(x) < s; });
+        return lo * elementos_por_bloque + (primero_mayor_igual - bloque.begin());
+    };
+    
+    // cortes[j][r]: inicio de la parte j en el run r
+    size_t num_partes = separadores.size() + 1;
+    std::vector<std::vector<size_t>> cortes(num_partes + 1, std::vector<size_t>(k, 0));
+    for (size_t r = 0; r < k; r++) {
+        for (size_t j = 0; j < separadores.size(); j++) {
+            cortes[j + 1][r] = ubicar(r, separadores[j]);
+        }
+        cortes[num_partes][r] = tamanos[r];
+    }
+    archivos.clear();
+    
+    // Archivo de salida con su tamaño final; cada parte lo abre en actualizacion y escribe su rango
+    if (!reservarArchivo(archivo_salida, static_cast<uint64_t>(total) * sizeof(T))) {
+        std::cerr << "Error al reservar el archivo de salida: " << archivo_salida << std::endl;
+        errorIO = true;
+        return false;
+    }
+    
+    planMezcla = planificarBuffers(M / num_partes, B, k, 1, 2, 2);
+    uint64_t offset = 0;
+    std::atomic<bool> correcta{true};
+    for (size_t j = 0; j < num_partes; j++) {
+        std::vector<TramoRun> tramos;
+        size_t elementos_parte = 0;
+        for (size_t r = 0; r < k; r++) {
+            tramos.push_back({runs[r], cortes[j][r], cortes[j + 1][r]});
+            elementos_parte += cortes[j + 1][r] - cortes[j][r];
+        }
+        pool->encolar([this, tramos, offset, &archivo_salida, &correcta]() {
+            std::unique_ptr<ArchivoBloques> salida = abrirArchivoBloques(dispositivo, archivo_salida, ModoApertura::Actualizacion);
+            if (!salida) {
+                std::cerr << "Error al abrir archivo de salida: " << archivo_salida << std::endl;
+                errorIO = true;
+                correcta = false;
+                return;
+            }
+            if (!mergeTramos(tramos, salida.get(), offset, planMezcla)) correcta = false;
+        });
+        offset += elementos_parte * sizeof(T);
+    }
+    pool->esperarTodas();
+    return correcta;
+}
+
+/**
+ * Genera los runs ordenados leyendo ventanas consecutivas de hasta M bytes directamente desde el archivo de entrada,
+ * y ordenando cada ventana con ordenarEnMemoria. Las ventanas se alinean a bloques, por lo que cada bloque de la
+ * entrada se lee una sola vez y no hay pasadas de copia previas a la mezcla. Cada run terminado se registra en el
+ * manifiesto, y al retomar se saltan las ventanas cuyo run ya estaba registrado. Si una ventana falla (errorIO) su
+ * run se borra sin registrarlo y no se generan los siguientes
+ * @param archivo_entrada Nombre del archivo a ordenar
+ * @param archivo_salida Nombre del archivo de salida, usado como prefijo de los temporales
+ * @param num_elementos Numero de elementos del archivo de entrada
+ * @param contador_temp Contador para generar nombres únicos para archivos temporales
+ * @return vector con los nombres de los runs ordenados, en orden de creacion; vacio si hubo un error de I/O
+ */
+template <typename T, typename Clave>
+std::vector<std::string> MergesortExterno<T, Clave>::generarRunsVentanas(const std::string& archivo_entrada, const std::string& archivo_salida, size_t num_elementos, int& contador_temp) {
+    std::vector<std::string> archivos_ordenados;
+    
+    // Tamaño de ventana: la mayor cantidad de bloques completos que cabe en M (al menos un bloque)
+    size_t elementos_por_bloque = registrosPorBloque();
+    size_t elementos_por_ventana = std::max<size_t>(M / B, 1) * elementos_por_bloque;
+    
+    // Si todo cabe en una ventana el run es el resultado final, y no se comprime
+    bool comprimir = comprimeRuns() && num_elementos > elementos_por_ventana;
+    
+    for (size_t inicio = 0; inicio < num_elementos; inicio += elementos_por_ventana) {
+        size_t fin = std::min(inicio + elementos_por_ventana, num_elementos);
+        std::string archivo_ordenado = temporales.ruta(archivo_salida, ".sorted_" + std::to_string(contador_temp++), &manifiesto);
+        PasoManifiesto paso;
+        if (!manifiesto.buscar(clavePaso("run", archivo_ordenado), paso)) {
+            uint64_t suma;
+            if (!ordenarEnMemoria(archivo_entrada, archivo_ordenado, inicio, fin, suma, comprimir)) {
+                // Los runs registrados quedan para retomar; sin manifiesto ya no sirven
+                remove(archivo_ordenado.c_str());
+                if (!manifiesto.activo()) {
+                    for (const auto& nombre : archivos_ordenados) {
+                        remove(nombre.c_str());
+                    }
+                }
+                return {};
+            }
+            manifiesto.registrar(clavePaso("run", archivo_ordenado), contador_temp, {describirArchivo(archivo_ordenado, suma)});
+        }
+        archivos_ordenados.push_back(archivo_ordenado);
+    }
+    
+    return archivos_ordenados;
+}
+
+/**
+ * Genera los runs ordenados por seleccion con reemplazo. El archivo de entrada se recorre una sola vez a traves de
+ * un heap de minimos que ocupa la memoria disponible: cada elemento que sale del heap se escribe en el run actual,
+ * y el siguiente elemento de la entrada lo reemplaza si todavia puede ir en ese run; si es menor que el ultimo
+ * escrito queda reservado al final del arreglo para el run siguiente. Con entrada aleatoria los runs miden
+ * cerca de 2M, y con entrada ya ordenada se genera un solo run. Como los runs dependen de todo lo leido antes,
+ * se registran juntos en el manifiesto al terminar, y al retomar se reutilizan todos o se generan de nuevo.
+ * Si falla una apertura, una lectura o una escritura marca errorIO, borra los runs de esta llamada y no registra nada.
+ * @param archivo_entrada Nombre del archivo a ordenar
+ * @param archivo_salida Nombre del archivo de salida, usado como prefijo de los temporales
+ * @param num_elementos Numero de elementos del archivo de entrada
+ * @param contador_temp Contador para generar nombres únicos para archivos temporales
+ * @return vector con los nombres de los runs ordenados, en orden de creacion; vacio si hubo un error de I/O
+ */
+template <typename T, typename Clave>
+std::vector<std::string> MergesortExterno<T, Clave>::generarRunsSeleccionReemplazo(const std::string& archivo_entrada, const std::string& archivo_salida, size_t num_elementos, int& contador_temp) {
+    std::vector<std::string> runs;
+    if (num_elementos == 0) return runs;
+
+    PasoManifiesto paso;
+    if (manifiesto.buscar("runs", paso)) {
+        for (const auto& archivo : paso.archivos) {
+            runs.push_back(archivo.nombre);
+        }
+        contador_temp = static_cast<int>(paso.contador);
+        return runs;
+    }
+    std::vector<ArchivoVerificado> archivos_runs;
+
+    const size_t elementos_por_bloque = registrosPorBloque();
+
+    // El heap usa la memoria que queda despues de reservar un bloque de lectura y uno de escritura
+    size_t capacidad = M / sizeof(T);
+    capacidad = (capacidad > 2 * elementos_por_bloque) ? capacidad - 2 * elementos_por_bloque : elementos_por_bloque;
+
+    // Los runs de una generacion que falla quedan incompletos y no se registran, asi que se borran
+    auto fallar = [&](const std::string& mensaje) {
+        std::cerr << mensaje << std::endl;
+        errorIO = true;
+        for (const auto& nombre : runs) {
+            remove(nombre.c_str());
+        }
+        runs.clear();
+        return runs;
+    };
+
+    std::unique_ptr<ArchivoBloques> entrada = abrirArchivoBloques(dispositivo, archivo_entrada, ModoApertura::Lectura);
+    if (!entrada) return fallar("Error: No se pudo abrir el archivo de entrada");
+
+    // Lectura secuencial de la entrada de a un bloque; una lectura corta antes del final es un error
+    bool lectura_corta = false;
+    uint64_t offset_entrada = 0;
+    size_t pos_entrada = 0;       // Posición en el bloque de entrada (buffer)
+    size_t validos_entrada = 0;   // Elementos válidos en el bloque de entrada
+    size_t elementos_restantes = num_elementos;
+    auto siguiente = [&](T& valor) -> bool {
+        if (pos_entrada == validos_entrada) {
+            if (elementos_restantes == 0) return false;
+            size_t elementos_a_leer = std::min(elementos_por_bloque, elementos_restantes);
+            validos_entrada = entrada->leer(buffer, elementos_a_leer * sizeof(T), offset_entrada) / sizeof(T);
+            offset_entrada += validos_entrada * sizeof(T);
+            contadorIO++;
+            pos_entrada = 0;
+            if (validos_entrada < elementos_a_leer) lectura_corta = true;
+            if (validos_entrada == 0) {
+                elementos_restantes = 0;
+                return false;
+            }
+            elementos_restantes -= validos_entrada;
+        }
+        valor = buffer[pos_entrada++];
+        return true;
+    };
+
+    // Arreglo de trabajo: [0, tam_heap) es el heap del run actual y [tam_heap, fin_reservados)
+    // los elementos guardados para el run siguiente
+    std::vector<T> heap(capacidad);
+    size_t tam_heap = 0;
+    T valor;
+    while (tam_heap < capacidad && siguiente(valor)) {
+        heap[tam_heap++] = valor;
+    }
+    size_t fin_reservados = tam_heap;
+    Clave clave_de;
+    auto mayor = [&](const T& x, const T& y) { return clave_de(y) < clave_de(x); }; // Convierte los heaps de std en heaps de minimos
+    std::make_heap(heap.begin(), heap.begin() + tam_heap, mayor);
+
+    std::vector<T> buffer_salida(elementos_por_bloque);
+    size_t pos_salida = 0;
+    bool entrada_agotada = false;
+    std::unique_ptr<EscritorComprimido> comprimido; // Escritor del run actual si los runs se comprimen
+    bool escritura_corta = false;
+
+    while (tam_heap > 0) {
+        // Abrir un nuevo run
+        std::string nombre_run = temporales.ruta(archivo_salida, ".sorted_" + std::to_string(contador_temp++), &manifiesto);
+        std::unique_ptr<ArchivoBloques> salida = abrirArchivoBloques(dispositivo, nombre_run, ModoApertura::Escritura);
+        uint64_t offset_salida = 0;
+        if (!salida) return fallar("Error al abrir archivo de salida: " + nombre_run);
+        runs.push_back(nombre_run);
+        SumaVerificacion suma;
+        if (comprimeRuns()) comprimido.reset(new EscritorComprimido(*salida, B, contadorIO));
+
+        while (tam_heap > 0) {
+            // Sacar el minimo, queda en heap[tam_heap - 1]
+            std::pop_heap(heap.begin(), heap.begin() + tam_heap, mayor);
+            T minimo = heap[tam_heap - 1];
+
+            buffer_salida[pos_salida++] = minimo;
+            if (pos_salida == elementos_por_bloque) {
+                if (comprimido) {
+                    comprimido->agregar(reinterpret_cast<const int64_t*>(buffer_salida.data()), pos_salida);
+                } else {
+                    size_t escritos = salida->escribir(buffer_salida.data(), pos_salida * sizeof(T), offset_salida);
+                    escritura_corta = escritura_corta || escritos != pos_salida * sizeof(T);
+                    offset_salida += escritos;
+                    suma.agregar(buffer_salida.data(), pos_salida * sizeof(T));
+                    contadorIO++;
+                }
+                pos_salida = 0;
+            }
+
+            if (!entrada_agotada && siguiente(valor)) {
+                heap[tam_heap - 1] = valor;
+                if (!(clave_de(valor) < clave_de(minimo))) {
+                    // Todavia cabe en el run actual
+                    std::push_heap(heap.begin(), heap.begin() + tam_heap, mayor);
+                } else {
+                    // Se reserva para el run siguiente
+                    tam_heap--;
+                }
+            } else {
+                // Sin entrada, el hueco se rellena con el ultimo reservado para mantenerlos contiguos
+                entrada_agotada = true;
+                heap[tam_heap - 1] = heap[fin_reservados - 1];
+                fin_reservados--;
+                tam_heap--;
+            }
+        }
+
+        // Cerrar el run con el bloque parcial que quede
+        uint64_t suma_run;
+        if (comprimido) {
+            comprimido->agregar(reinterpret_cast<const int64_t*>(buffer_salida.data()), pos_salida);
+            comprimido->terminar();
+            suma_run = comprimido->obtenerSuma();
+            escritura_corta = escritura_corta || comprimido->fallo();
+            comprimido.reset();
+        } else {
+            if (pos_salida > 0) {
+                size_t escritos = salida->escribir(buffer_salida.data(), pos_salida * sizeof(T), offset_salida);
+                escritura_corta = escritura_corta || escritos != pos_salida * sizeof(T);
+                suma.agregar(buffer_salida.data(), pos_salida * sizeof(T));
+                contadorIO++;
+            }
+            suma_run = suma.valor();
+        }
+        pos_salida = 0;
+        salida.reset();
+        if (escritura_corta) return fallar("Error al escribir el run: " + nombre_run);
+        if (lectura_corta) return fallar("Error al leer el archivo de entrada: " + archivo_entrada);
+        archivos_runs.push_back(describirArchivo(nombre_run, suma_run));
+
+        // Los elementos reservados forman el heap del run siguiente
+        tam_heap = fin_reservados;
+        std::make_heap(heap.begin(), heap.begin() + tam_heap, mayor);
+    }
+    if (lectura_corta) return fallar("Error al leer el archivo de entrada: " + archivo_entrada);
+
+    manifiesto.registrar("runs", contador_temp, archivos_runs);
+    return runs;
+}
 
 /**
- * Implementación iterativa del algoritmo MergeSort externo. Se encarga de usar las funciones auxiliares para hacer divisiones del archivo y la posterior mezcla o fusion
- * en los archivos finales
+ * Implementación iterativa del algoritmo MergeSort externo. Se encarga de usar las funciones auxiliares para generar los runs ordenados
+ * y la posterior mezcla o fusion por niveles, terminando con una mezcla final escrita directamente en el archivo de salida.
+ * Con checkpoint activado los pasos terminados se registran en archivo_salida + ".manifiesto", y una ejecucion
+ * interrumpida se retoma desde el ultimo paso registrado si la entrada y los parametros no cambiaron
  * @param archivo_entrada Nombre del archivo a ordenar
  * @param archivo_salida Nombre del archivo de salida ordenado
  * @param N Tamaño del archivo en bytes
  */
-void MergesortExterno::mergesort(const std::string& archivo_entrada, const std::string& archivo_salida, size_t N) {
+template <typename T, typename Clave>
+void MergesortExterno<T, Clave>::mergesort(const std::string& archivo_entrada, const std::string& archivo_salida, size_t N) {
     // Verificar que el archivo existe y obtener su tamaño real si no se especificó
-    FILE* archivo = fopen(archivo_entrada.c_str(), "rb");
-    if (!archivo) {
+    if (!abrirArchivoBloques(dispositivo, archivo_entrada, ModoApertura::Lectura)) {
         std::cerr << "Error: No se pudo abrir el archivo de entrada" << std::endl;
         return;
     }
-    fclose(archivo);
     
-    // Calcular el número real de elementos (int64_t) en el archivo
-    size_t num_elementos = N / sizeof(int64_t);
-    
-    // Cola para almacenar los fragmentos del archivo que debemos procesar
-    std::queue<FragmentoArchivo> fragmentos_por_procesar;
+    if (checkpoint) {
+        std::ostringstream firma;
+        firma << "mergesort " << firmaArchivo(archivo_entrada) << " " << N << " " << B << " " << M << " " << a << " "
+              << sizeof(T) << " " << static_cast<int>(modo_runs) << " " << comprimeRuns();
+        manifiesto.abrir(archivo_salida + ".manifiesto", firma.str());
+    }
     
-    // Iniciar con el archivo completo
-    fragmentos_por_procesar.push({archivo_entrada, 0, num_elementos});
+    errorIO = false;
+    bool completo = ordenarPorPasos(archivo_entrada, archivo_salida, N);
+    if (!completo && !errorIO) {
+        // Un archivo heredado no coincide con el manifiesto: se descarta lo anterior y se ordena desde cero
+        std::cerr << "Advertencia: el manifiesto no coincide con los archivos temporales, se ordena desde cero" << std::endl;
+        manifiesto.reiniciar();
+        completo = ordenarPorPasos(archivo_entrada, archivo_salida, N);
+    }
+    if (!completo && errorIO) {
+        // Con checkpoint el manifiesto y los pasos terminados quedan para retomar el ordenamiento
+        std::cerr << "Error: se detiene el ordenamiento por un error de I/O" << std::endl;
+        manifiesto.soltar();
+        return;
+    }
+    manifiesto.cerrar();
+}
+
+/**
+ * Flujo sobre una mezcla del mergesort. Un hilo propio corre mergeTramos sobre sus runs y sobre las mezclas
+ * encadenadas que la alimentan, y entrega cada buffer de salida lleno por un CanalLotes en vez de escribirlo, asi la
+ * mezcla avanza mientras se consume el lote anterior y conserva la precarga asincrona y la mezcla vectorial de dos
+ * entradas. Los runs se borran al destruirlo.
+ */
+template <typename T, typename Clave>
+class FlujoMergesort : public FlujoOrdenado<T> {
+private:
+    MergesortExterno<T, Clave>& ordenador;
+    std::vector<std::string> runs;
+    std::vector<std::unique_ptr<FlujoOrdenado<T>>> encadenadas; // Se destruyen despues de terminar el hilo
+    CanalLotes<T> canal;
+    std::thread hilo;
+
+public:
+    /**
+     * @param ordenador mergesort cuya configuracion se usa
+     * @param runs runs a mezclar, pasan a ser del flujo
+     * @param comprimidos indica si los runs estan en el formato comprimido
+     * @param plan buffers de la mezcla, para los runs y la salida
+     * @param encadenadas mezclas que entregan su salida como entradas de esta, pasan a ser del flujo
+     */
+    FlujoMergesort(MergesortExterno<T, Clave>& ordenador, const std::vector<std::string>& runs, bool comprimidos,
+                   const PlanBuffers& plan, std::vector<std::unique_ptr<FlujoOrdenado<T>>> encadenadas = {})
+        : ordenador(ordenador), runs(runs), encadenadas(std::move(encadenadas)) {
+        hilo = std::thread([this, comprimidos, plan]() {
+            std::vector<TramoRun> tramos;
+            for (const auto& nombre : this->runs) {
+                tramos.push_back({nombre, 0, this->ordenador.elementosEnArchivo(nombre)});
+            }
+            std::vector<FlujoOrdenado<T>*> flujos;
+            for (const auto& flujo : this->encadenadas) {
+                flujos.push_back(flujo.get());
+            }
+            if (!tramos.empty() || !flujos.empty()) {
+                SumideroMezcla<T> sumidero = [this](const T* datos, size_t cantidad) { return canal.entregar(datos, cantidad); };
+                if (!this->ordenador.mergeTramos(tramos, nullptr, 0, plan, comprimidos, false, nullptr, &sumidero, &flujos)) {
+                    std::cerr << "Error: el flujo queda incompleto por un error de I/O en la mezcla" << std::endl;
+                }
+            }
+            canal.terminar();
+        });
+    }
+
+    ~FlujoMergesort() override {
+        canal.cancelar();
+        hilo.join();
+        for (const auto& nombre : runs) {
+            remove(nombre.c_str());
+        }
+    }
+
+    size_t siguienteLote(const T*& lote) override {
+        return canal.recibir(lote);
+    }
+};
+
+/**
+ * Genera los runs y los mezcla segun el plan de menor costo hasta que quedan a lo mas 'a', saltando los pasos que
+ * el manifiesto tiene terminados
+ * @param archivo_entrada Nombre del archivo a ordenar
+ * @param archivo_salida Nombre del archivo de salida ordenado, da nombre a los temporales
+ * @param N Tamaño del archivo en bytes
+ * @param nivel recibe los runs que quedan para la mezcla final, vacio si la entrada esta vacia
+ * @param runs_comprimidos recibe si esos runs estan comprimidos
+ * @param encadenadas recibe las mezclas encadenadas que completan la entrada de la mezcla final junto con 'nivel';
+ * en ese caso planMezcla queda con los buffers de la mezcla final
+ * @return false si un archivo heredado de una ejecucion anterior no paso la validacion o si una mezcla tuvo un
+ * error de I/O (errorIO)
+ */
+template <typename T, typename Clave>
+bool MergesortExterno<T, Clave>::generarNivelFinal(const std::string& archivo_entrada, const std::string& archivo_salida, size_t N,
+                                                   std::vector<std::string>& nivel, bool& runs_comprimidos,
+                                                   std::vector<std::unique_ptr<FlujoOrdenado<T>>>& encadenadas) {
+    // Calcular el número real de registros en el archivo
+    size_t num_elementos = N / sizeof(T);
     
     // Contador para generar nombres únicos para archivos temporales
     int contador_temp = 0;
     
-    // Cola para almacenar los archivos ya procesados (ordenados)
-    std::queue<std::string> archivos_ordenados;
+    // Generar los runs ordenados iniciales segun el modo configurado
+    std::vector<std::string> runs;
+    if (modo_runs == GeneracionRuns::SeleccionReemplazo) {
+        runs = generarRunsSeleccionReemplazo(archivo_entrada, archivo_salida, num_elementos, contador_temp);
+    } else {
+        runs = generarRunsVentanas(archivo_entrada, archivo_salida, num_elementos, contador_temp);
+    }
+    if (runs.empty() && num_elementos > 0) return false; // Error de I/O al generar los runs (errorIO)
     
-    // Procesar los fragmentos iterativamente
-    while (!fragmentos_por_procesar.empty()) {
-        FragmentoArchivo fragmento_actual = fragmentos_por_procesar.front();
-        fragmentos_por_procesar.pop();
-        
-        std::string archivo_actual = fragmento_actual.nombre;
-        size_t inicio = fragmento_actual.inicio;
-        size_t fin = fragmento_actual.fin;
-        size_t num_elementos_fragmento = fin - inicio;
-        
-        // Caso base: si el fragmento cabe en memoria, lo ordenamos directamente
-        if (num_elementos_fragmento * sizeof(int64_t) <= M) {
-            std::string archivo_ordenado = archivo_salida + ".sorted_" + std::to_string(contador_temp++);
-            ordenarEnMemoria(archivo_actual, archivo_ordenado, inicio, fin);
-            archivos_ordenados.push(archivo_ordenado);
-            
-            // Si el archivo actual es temporal (no es el original), lo eliminamos
-            if (archivo_actual != archivo_entrada) {
-                remove(archivo_actual.c_str());
+    // Con ventanas, un solo run es una sola ventana y se escribio sin comprimir
+    runs_comprimidos = comprimeRuns() && !(modo_runs == GeneracionRuns::VentanasMemoria && runs.size() == 1);
+    
+    // Mezclas intermedias segun el plan de menor costo (plan_mezclas.h). Las de una misma ronda son independientes
+    // y se mezclan en paralelo en el pool, repartiendo M entre las mezclas simultaneas. Los tamaños salen del
+    // manifiesto cuando un run ya se consumio en una ejecucion anterior, asi el plan al retomar es el mismo
+    size_t aridad = std::max<size_t>(a, 2);
+    std::vector<uint64_t> tamanos;
+    for (const auto& nombre : runs) {
+        uint64_t bytes;
+        if (!manifiesto.tamanoRegistrado(nombre, bytes)) bytes = elementosEnArchivo(nombre) * sizeof(T);
+        tamanos.push_back(bytes);
+    }
+    planMezclas = planificarMezclas(tamanos, aridad);
+    
+    // Nombre de cada entrada del plan: los runs y luego el resultado de cada mezcla
+    std::vector<std::string> archivos = runs;
+    for (size_t j = 0; j < planMezclas.mezclas.size(); j++) {
+        archivos.push_back(temporales.ruta(archivo_salida, ".merged_" + std::to_string(contador_temp++), &manifiesto));
+    }
+    
+    // Los niveles de arriba del arbol se encadenan con la mezcla final si M alcanza para correrlos a la vez
+    // (plan_mezclas.h); sus resultados no se escriben y por eso tampoco quedan en el manifiesto
+    EncadenamientoMezclas encadenamiento;
+    encadenamiento.profundidad.assign(planMezclas.mezclas.size(), SIZE_MAX);
+    if (mezclaEncadenada && !planMezclas.mezclas.empty()) {
+        size_t marco = comprimeRuns() ? maxElementosPorMarco(B) * sizeof(int64_t) : 0;
+        encadenamiento = planificarEncadenamiento(planMezclas, memoriaBuffersMezcla(M, 0), B, marco);
+    }
+    
+    for (size_t ronda = 0; ronda < planMezclas.rondas; ronda++) {
+        // Las mezclas que el manifiesto ya tiene terminadas no se repiten; las entradas del resto deben estar intactas
+        std::vector<std::pair<std::vector<std::string>, std::string>> grupos;
+        for (const auto& mezcla : planMezclas.mezclas) {
+            if (mezcla.ronda != ronda || encadenamiento.encadenada(&mezcla - planMezclas.mezclas.data())) continue;
+            std::vector<std::string> grupo_fusion;
+            for (size_t entrada : mezcla.entradas) {
+                grupo_fusion.push_back(archivos[entrada]);
             }
-        } else {
-            // Dividir el fragmento en subfragmentos según la aridad
-            std::string base_temporal = archivo_salida + ".temp_" + std::to_string(contador_temp++);
-            std::vector<std::string> nombres_temp = dividirArchivo(archivo_actual, base_temporal, inicio, fin);
+            std::string archivo_fusionado = archivos[runs.size() + (&mezcla - planMezclas.mezclas.data())];
             
-            // Si el archivo actual es temporal (no es el original), lo eliminamos
-            if (archivo_actual != archivo_entrada) {
-                remove(archivo_actual.c_str());
+            PasoManifiesto paso;
+            if (manifiesto.buscar(clavePaso("mezcla", archivo_fusionado), paso)) {
+                for (const auto& nombre : grupo_fusion) {
+                    remove(nombre.c_str());
+                }
+                continue;
             }
-            
-            // Calcular elementos por subfragmento
-            size_t elementos_por_subfragmento = (num_elementos_fragmento + a - 1) / a;
-            
-            // Añadir cada subfragmento a la cola para procesarlo
-            for (size_t i = 0; i < nombres_temp.size(); i++) {
-                size_t inicio_subfragmento = 0;
-                size_t fin_subfragmento;
-                
-                // Para el último subfragmento, verificar su tamaño real
-                if (i == nombres_temp.size() - 1) {
-                    FILE* temp_file = fopen(nombres_temp[i].c_str(), "rb");
-                    if (temp_file) {
-                        fseek(temp_file, 0, SEEK_END);
-                        fin_subfragmento = ftell(temp_file) / sizeof(int64_t);
-                        fclose(temp_file);
-                    } else {
-                        fin_subfragmento = elementos_por_subfragmento;
-                    }
-                } else {
-                    fin_subfragmento = elementos_por_subfragmento;
+            for (const auto& nombre : grupo_fusion) {
+                if (!validarHeredado(nombre)) return false;
+            }
+            grupos.emplace_back(grupo_fusion, archivo_fusionado);
+        }
+        
+        size_t concurrentes = std::max<size_t>(1, std::min<size_t>(pool->tamano(), grupos.size()));
+        std::atomic<bool> correcta{true};
+        for (const auto& grupo : grupos) {
+            pool->encolar([this, grupo, runs_comprimidos, concurrentes, &correcta]() {
+                // Mezclar(Fusionar) los archivos y eliminar los ya fusionados. Si falla, las entradas se conservan
+                // y el resultado incompleto no se registra
+                size_t k = grupo.first.size();
+                PlanBuffers plan = planificarBuffers(memoriaBuffersMezcla(M / concurrentes, k), B, k, 1, 2, 2);
+                SumaVerificacion suma;
+                if (!mergeArchivos(grupo.first, grupo.second, plan, runs_comprimidos, runs_comprimidos, &suma)) {
+                    remove(grupo.second.c_str());
+                    correcta = false;
+                    return;
+                }
+                manifiesto.registrar(clavePaso("mezcla", grupo.second), 0, {describirArchivo(grupo.second, suma.valor())});
+                for (const auto& nombre : grupo.first) {
+                    remove(nombre.c_str());
+                }
+            });
+        }
+        pool->esperarTodas();
+        if (!correcta) {
+            // Sin checkpoint nada de lo hecho se puede reutilizar
+            if (!manifiesto.activo()) {
+                for (const auto& nombre : archivos) {
+                    remove(nombre.c_str());
                 }
-                
-                fragmentos_por_procesar.push({nombres_temp[i], inicio_subfragmento, fin_subfragmento});
             }
+            return false;
         }
     }
     
-    // Ahora tenemos una cola de archivos ordenados, los mezclamos de a pares hasta que quede uno solo
-    while (archivos_ordenados.size() > 1) {
-        std::vector<std::string> grupo_fusion;
-        
-        // Tomamos hasta 'a' archivos para mezclarlos
-        for (size_t i = 0; i < a && !archivos_ordenados.empty(); i++) {
-            grupo_fusion.push_back(archivos_ordenados.front());
-            archivos_ordenados.pop();
+    // Cada mezcla encadenada es un flujo sobre los archivos que lee y las mezclas encadenadas de abajo
+    size_t bloques = encadenamiento.bloques_por_buffer;
+    std::function<std::unique_ptr<FlujoOrdenado<T>>(size_t)> encadenar = [&](size_t j) {
+        std::vector<std::string> propios;
+        std::vector<std::unique_ptr<FlujoOrdenado<T>>> hijos;
+        for (size_t entrada : planMezclas.mezclas[j].entradas) {
+            if (entrada >= runs.size() && encadenamiento.encadenada(entrada - runs.size())) {
+                hijos.push_back(encadenar(entrada - runs.size()));
+            } else {
+                propios.push_back(archivos[entrada]);
+            }
         }
-        
-        // Nombre del archivo resultante de la fusión
-        std::string archivo_fusionado = archivo_salida + ".merged_" + std::to_string(contador_temp++);
-        
-        // Mezclar(Fusionar) los archivos
-        mergeArchivos(grupo_fusion, archivo_fusionado);
-        
-        // Añadir el archivo fusionado a la cola
-        archivos_ordenados.push(archivo_fusionado);
-        
-        // Eliminar los archivos ya fusionados (o mezclados)
-        for (const auto& nombre : grupo_fusion) {
-            remove(nombre.c_str());
+        PlanBuffers plan = planificarBuffers((2 * propios.size() + 2) * bloques * B, B, propios.size(), 1, 2, 2);
+        return std::unique_ptr<FlujoOrdenado<T>>(
+            new FlujoMergesort<T, Clave>(*this, propios, runs_comprimidos, plan, std::move(hijos)));
+    };
+    
+    nivel.clear();
+    encadenadas.clear();
+    std::vector<std::string> leidos; // Archivos que lee el pipeline, incluida la mezcla final
+    for (size_t j = 0; j < planMezclas.mezclas.size(); j++) {
+        if (!encadenamiento.encadenada(j)) continue;
+        for (size_t entrada : planMezclas.mezclas[j].entradas) {
+            if (entrada < runs.size() || !encadenamiento.encadenada(entrada - runs.size())) leidos.push_back(archivos[entrada]);
         }
     }
+    for (size_t entrada : planMezclas.final) {
+        if (entrada >= runs.size() && encadenamiento.encadenada(entrada - runs.size())) continue;
+        nivel.push_back(archivos[entrada]);
+        leidos.push_back(archivos[entrada]);
+    }
     
-    // Al final solo queda un archivo ordenado, lo renombramos al nombre de salida deseado
-    if (!archivos_ordenados.empty()) {
-        std::string ultimo_archivo = archivos_ordenados.front();
-        
-        FILE* src = fopen(ultimo_archivo.c_str(), "rb");
-        FILE* dst = fopen(archivo_salida.c_str(), "wb");
-        
-        if (src && dst) {
-            // Copiar contenido
-            size_t elementos_por_bloque = B / sizeof(int64_t);
-            while (true) {
-                size_t leidos = fread(buffer, sizeof(int64_t), elementos_por_bloque, src);
-                if (leidos == 0) break;
-                
-                fwrite(buffer, sizeof(int64_t), leidos, dst);
-                contadorIO += 2; // Contar operaciones I/O (lectura y escritura)
+    for (const auto& nombre : leidos) {
+        if (!validarHeredado(nombre)) return false;
+    }
+    for (size_t entrada : planMezclas.final) {
+        if (entrada >= runs.size() && encadenamiento.encadenada(entrada - runs.size())) {
+            encadenadas.push_back(encadenar(entrada - runs.size()));
+        }
+    }
+    if (!encadenadas.empty()) {
+        planMezcla = planificarBuffers((2 * nivel.size() + 2) * bloques * B, B, nivel.size(), 1, 2, 2);
+    }
+    return true;
+}
+
+/**
+ * Genera los runs, los mezcla por niveles y termina con la mezcla final sobre el archivo de salida, saltando los
+ * pasos que el manifiesto tiene terminados
+ * @param archivo_entrada Nombre del archivo a ordenar
+ * @param archivo_salida Nombre del archivo de salida ordenado
+ * @param N Tamaño del archivo en bytes
+ * @return false si un archivo heredado de una ejecucion anterior no paso la validacion o si hubo un error de I/O
+ * en una mezcla (errorIO); en ese caso no queda archivo de salida
+ */
+template <typename T, typename Clave>
+bool MergesortExterno<T, Clave>::ordenarPorPasos(const std::string& archivo_entrada, const std::string& archivo_salida, size_t N) {
+    std::vector<std::string> nivel;
+    bool runs_comprimidos = false;
+    std::vector<std::unique_ptr<FlujoOrdenado<T>>> encadenadas;
+    if (!generarNivelFinal(archivo_entrada, archivo_salida, N, nivel, runs_comprimidos, encadenadas)) return false;
+    
+    // Si la mezcla final falla se borra la salida incompleta; los runs se conservan solo para retomar
+    auto descartar = [&]() {
+        remove(archivo_salida.c_str());
+        if (!manifiesto.activo()) {
+            for (const auto& nombre : nivel) {
+                remove(nombre.c_str());
             }
         }
-        
-        if (src) fclose(src);
-        if (dst) fclose(dst);
-        
-        // Eliminar el último archivo temporal
-        remove(ultimo_archivo.c_str());
+        return false;
+    };
+    
+    if (!encadenadas.empty()) {
+        // La mezcla final consume las encadenadas a medida que producen, por eso no se particiona
+        std::unique_ptr<ArchivoBloques> salida = abrirArchivoBloques(dispositivo, archivo_salida, ModoApertura::Escritura);
+        if (!salida) {
+            std::cerr << "Error al abrir archivo de salida: " << archivo_salida << std::endl;
+            errorIO = true;
+            encadenadas.clear();
+            return descartar();
+        }
+        std::vector<TramoRun> tramos;
+        for (const auto& nombre : nivel) {
+            tramos.push_back({nombre, 0, elementosEnArchivo(nombre)});
+        }
+        std::vector<FlujoOrdenado<T>*> flujos;
+        for (const auto& flujo : encadenadas) {
+            flujos.push_back(flujo.get());
+        }
+        mergeTramos(tramos, salida.get(), 0, planMezcla, runs_comprimidos, false, nullptr, nullptr, &flujos);
+        salida.reset();
+        encadenadas.clear();
+        // Un error en una mezcla encadenada corta su flujo, y se detecta con errorIO
+        if (errorIO) return descartar();
+        for (const auto& nombre : nivel) {
+            remove(nombre.c_str());
+        }
+        return true;
+    }
+    
+    // Mezcla final directo sobre el archivo de salida
+    if (nivel.empty()) {
+        // Entrada vacía, sin runs: el archivo de salida queda vacío
+        abrirArchivoBloques(dispositivo, archivo_salida, ModoApertura::Escritura);
+        return true;
+    }
+    
+    if (nivel.size() == 1 && !runs_comprimidos) {
+        // Un solo run ya es el resultado, se renombra; si no se puede (otro dispositivo) se copia.
+        // Un run comprimido en cambio se descomprime con la mezcla final de un solo archivo
+        if (rename(nivel[0].c_str(), archivo_salida.c_str()) == 0) return true;
+    }
+    
+    // Con pocos datos no vale la pena repartir la mezcla final. Los runs comprimidos no permiten ubicar un
+    // elemento por su posicion, por lo que se mezclan sin particionar
+    size_t total_elementos = 0;
+    for (const auto& nombre : nivel) {
+        total_elementos += elementosEnArchivo(nombre);
+    }
+    size_t particiones = pool->tamano();
+    size_t minimo_por_particion = 64 * registrosPorBloque();
+    bool correcta;
+    if (!runs_comprimidos && particiones > 1 && nivel.size() > 1 && total_elementos >= particiones * minimo_por_particion) {
+        correcta = mergeFinalParticionado(nivel, archivo_salida, particiones);
+    } else {
+        planMezcla = planificarBuffers(memoriaBuffersMezcla(M, nivel.size()), B, nivel.size(), 1, 2, 2);
+        correcta = mergeArchivos(nivel, archivo_salida, planMezcla, runs_comprimidos, false);
+    }
+    if (!correcta) return descartar();
+    for (const auto& nombre : nivel) {
+        remove(nombre.c_str());
     }
+    return true;
+}
+
+/**
+ * Ordena un archivo sin escribir el resultado: genera los runs y las mezclas intermedias igual que mergesort() y
+ * deja la mezcla final para que avance a medida que se consume el flujo. No usa el manifiesto de checkpoint
+ * @param archivo_entrada Nombre del archivo a ordenar
+ * @param N Tamaño del archivo en bytes
+ * @return flujo con los registros ordenados, o nullptr si no se pudo abrir la entrada o una mezcla tuvo un
+ * error de I/O
+ */
+template <typename T, typename Clave>
+std::unique_ptr<FlujoOrdenado<T>> MergesortExterno<T, Clave>::abrirFlujo(const std::string& archivo_entrada, size_t N) {
+    if (!abrirArchivoBloques(dispositivo, archivo_entrada, ModoApertura::Lectura)) {
+        std::cerr << "Error: No se pudo abrir el archivo de entrada" << std::endl;
+        return nullptr;
+    }
+    
+    // Sin archivo de salida, los temporales se nombran por la entrada y un identificador del flujo
+    static std::atomic<unsigned> flujos{0};
+    std::string base = archivo_entrada + ".flujo_" + std::to_string(getpid()) + "_" + std::to_string(flujos++);
+    std::vector<std::string> nivel;
+    bool runs_comprimidos = false;
+    std::vector<std::unique_ptr<FlujoOrdenado<T>>> encadenadas;
+    if (!generarNivelFinal(archivo_entrada, base, N, nivel, runs_comprimidos, encadenadas)) {
+        std::cerr << "Error: no se pudo abrir el flujo por un error de I/O" << std::endl;
+        return nullptr;
+    }
+    if (encadenadas.empty()) return flujoSobreRuns(nivel, runs_comprimidos);
+    return std::unique_ptr<FlujoOrdenado<T>>(
+        new FlujoMergesort<T, Clave>(*this, nivel, runs_comprimidos, planMezcla, std::move(encadenadas)));
+}
+
+/**
+ * Crea el flujo de la mezcla final de un conjunto de runs, que pasan a ser del flujo
+ * @param runs runs ordenados, a lo mas 'a'
+ * @param comprimidos indica si los runs estan en el formato comprimido
+ */
+template <typename T, typename Clave>
+std::unique_ptr<FlujoOrdenado<T>> MergesortExterno<T, Clave>::flujoSobreRuns(const std::vector<std::string>& runs, bool comprimidos) {
+    size_t k = runs.size();
+    PlanBuffers plan = planificarBuffers(memoriaBuffersMezcla(M, k), B, k, 1, 2, 2);
+    return std::unique_ptr<FlujoOrdenado<T>>(new FlujoMergesort<T, Clave>(*this, runs, comprimidos, plan));
+}
+
+/**
+ * Valida un archivo temporal antes de reutilizarlo, contando los bloques releidos
+ * @param nombre archivo temporal
+ * @return true si el archivo es de esta ejecucion o coincide con lo registrado en el manifiesto
+ */
+template <typename T, typename Clave>
+bool MergesortExterno<T, Clave>::validarHeredado(const std::string& nombre) {
+    size_t bloques = 0;
+    bool valido = manifiesto.validar(nombre, B, bloques);
+    contadorIO += static_cast<int>(bloques);
+    return valido;
+}
+
+/**
+ * Memoria que queda para los buffers del plan de una mezcla. Con runs comprimidos cada entrada descomprime un marco
+ * fuera de su buffer y la salida junta valores hasta completar marcos, lo que se descuenta de la memoria disponible
+ * @param memoria memoria de la mezcla en bytes
+ * @param entradas runs que se mezclan
+ * @return bytes para repartir con planificarBuffers
+ */
+template <typename T, typename Clave>
+size_t MergesortExterno<T, Clave>::memoriaBuffersMezcla(size_t memoria, size_t entradas) const {
+    if (!comprimeRuns()) return memoria;
+    size_t marcos = (entradas + 4) * maxElementosPorMarco(B) * sizeof(int64_t);
+    return (memoria > 2 * marcos) ? memoria - marcos : memoria / 2;
+}
+
+/**
+ * Obtiene el número de registros de un archivo
+ * @param nombre nombre del archivo
+ * @return elementos del archivo, 0 si no existe
+ */
+template <typename T, typename Clave>
+size_t MergesortExterno<T, Clave>::elementosEnArchivo(const std::string& nombre) {
+    struct stat info;
+    if (stat(nombre.c_str(), &info) != 0) return 0;
+    return static_cast<size_t>(info.st_size) / sizeof(T);
 }
 
 /**
  * Obtiene el contador de I/O
  * @return contador de I/O
  */
-int MergesortExterno::obtenerContadorIO() {
+template <typename T, typename Clave>
+int MergesortExterno<T, Clave>::obtenerContadorIO() {
     return contadorIO;
 }
 
 /**
  * Reinicia el contador de IO
  */
-void MergesortExterno::resetContadorIO() {
+template <typename T, typename Clave>
+void MergesortExterno<T, Clave>::resetContadorIO() {
     contadorIO = 0;
 }
 
 /**
  * Actualiza la aridad del mergesort
  */
-void MergesortExterno::updateAridad(size_t new_a){
+template <typename T, typename Clave>
+void MergesortExterno<T, Clave>::updateAridad(size_t new_a){
     this->a = new_a;
 }
 
+/**
+ * Obtiene el reparto de memoria usado en la última mezcla
+ * @return plan de buffers de la última llamada a mergeArchivos
+ */
+template <typename T, typename Clave>
+const PlanBuffers& MergesortExterno<T, Clave>::obtenerPlanMezcla() const {
+    return planMezcla;
+}
+
+/**
+ * Obtiene el orden de mezclas que uso el último ordenamiento
+ * @return plan con las mezclas intermedias, la mezcla final y los bytes movidos
+ */
+template <typename T, typename Clave>
+const PlanMezclas& MergesortExterno<T, Clave>::obtenerPlanMezclas() const {
+    return planMezclas;
+}
+
+/**
+ * Planifica las mezclas de un archivo de N bytes antes de ordenarlo, con los runs sin comprimir que se esperan:
+ * ventanas de M, o de cerca de 2M con seleccion con reemplazo sobre una entrada aleatoria
+ * @param N Tamaño del archivo en bytes
+ * @return plan de mezclas previsto
+ */
+template <typename T, typename Clave>
+PlanMezclas MergesortExterno<T, Clave>::planMezclasPrevisto(size_t N) const {
+    size_t num_elementos = N / sizeof(T);
+    size_t largo = std::max<size_t>(M / B, 1) * registrosPorBloque();
+    if (modo_runs == GeneracionRuns::SeleccionReemplazo) largo *= 2;
+    std::vector<uint64_t> tamanos;
+    for (size_t inicio = 0; inicio < num_elementos; inicio += largo) {
+        tamanos.push_back(std::min(largo, num_elementos - inicio) * sizeof(T));
+    }
+    return planificarMezclas(tamanos, a);
+}
+
+/**
+ * Cambia la cantidad de hilos que ordenan los runs en ordenarEnMemoria y mezclan en paralelo
+ * @param hilos hilos del pool, con 0 se lee, ordena, mezcla y escribe en secuencia
+ */
+template <typename T, typename Clave>
+void MergesortExterno<T, Clave>::updateHilos(unsigned hilos){
+    pool.reset(new PoolHilos(hilos));
+}
+
+/**
+ * Cambia las instrucciones con que se mezclan dos tramos. Por defecto se usa el mejor nivel que soporta la CPU
+ * @param nivel Escalar, AVX2 o AVX512, debe estar soportado por la CPU
+ */
+template <typename T, typename Clave>
+void MergesortExterno<T, Clave>::updateNivelSimd(NivelSimd nivel){
+    this->nivelSimd = nivel;
+}
+
+/**
+ * Activa o desactiva la compresion de los runs intermedios (.sorted_ y .merged_) con el formato de compresion_runs.h.
+ * Solo aplica a int64_t; los marcos comprimidos ocupan bloques completos, asi contadorIO cuenta los bloques fisicos
+ * @param comprimir true para escribir y leer los runs comprimidos
+ */
+template <typename T, typename Clave>
+void MergesortExterno<T, Clave>::updateCompresionRuns(bool comprimir){
+    this->compresionRuns = comprimir;
+}
+
+/**
+ * Activa o desactiva el encadenamiento de los niveles de arriba del arbol de mezclas con la mezcla final. Sin el,
+ * todas las mezclas intermedias escriben su resultado, como antes; sirve para comparar y para que un checkpoint
+ * pueda retomar cualquier mezcla
+ * @param activar true para encadenar los niveles que quepan en M
+ */
+template <typename T, typename Clave>
+void MergesortExterno<T, Clave>::updateMezclaEncadenada(bool activar){
+    mezclaEncadenada = activar;
+}
+
+/**
+ * Activa o desactiva el registro de los pasos terminados en un manifiesto junto al archivo de salida, para retomar
+ * un ordenamiento interrumpido. Los temporales de una ejecucion interrumpida se reutilizan solo si pasan la validacion
+ * @param activar true para registrar y retomar los pasos
+ */
+template <typename T, typename Clave>
+void MergesortExterno<T, Clave>::updateCheckpoint(bool activar){
+    this->checkpoint = activar;
+}
+
+/**
+ * Cambia los directorios donde se crean los runs y las mezclas intermedias. Con varios directorios en discos
+ * distintos, los runs que se mezclan juntos quedan repartidos y se leen en paralelo desde todos los discos
+ * @param directorios directorios de los temporales; vacio para dejarlos junto al archivo de salida
+ * @param politica Rotacion o EspacioLibre
+ */
+template <typename T, typename Clave>
+void MergesortExterno<T, Clave>::updateDirectoriosTemporales(const std::vector<std::string>& directorios, PoliticaTemporales politica){
+    temporales.configurar(directorios, politica);
+}
+
+/**
+ * Cambia el algoritmo que ordena cada run en memoria
+ * @param algoritmo Comparacion (std::sort) o Radix
+ * @param memoria_auxiliar bytes extra permitidos para el buffer auxiliar de radix sort, un run de M bytes necesita M;
+ * si no alcanza se usa std::sort
+ */
+template <typename T, typename Clave>
+void MergesortExterno<T, Clave>::updateOrdenamiento(OrdenamientoMemoria algoritmo, size_t memoria_auxiliar){
+    this->ordenamiento = algoritmo;
+    this->memoriaAuxiliar = memoria_auxiliar;
+}
+
+/**
+ * Cambia el backend del motor de I/O asincrono usado en la mezcla
+ * @param backend Sincrono, Hilos o IoUring
+ */
+template <typename T, typename Clave>
+void MergesortExterno<T, Clave>::updateBackendIO(BackendIO backend){
+    this->backendIO = backend;
+}
+
+/**
+ * Actualiza la forma en que se generan los runs ordenados iniciales
+ * @param modo VentanasMemoria (por defecto) o SeleccionReemplazo
+ */
+template <typename T, typename Clave>
+void MergesortExterno<T, Clave>::updateGeneracionRuns(GeneracionRuns modo){
+    this->modo_runs = modo;
+}
+
 
 /** 
  * limpia el buffer de la estructura de datos
  */
-void MergesortExterno::limpiarBuffer(){
+template <typename T, typename Clave>
+void MergesortExterno<T, Clave>::limpiarBuffer(){
     if (buffer != nullptr) {
-        size_t tamano_buffer = B / sizeof(int64_t);
-        std::fill(buffer, buffer + tamano_buffer, 0);
+        size_t tamano_buffer = registrosPorBloque();
+        std::fill(buffer, buffer + tamano_buffer, T());
     }
-}
\ No newline at end of file
+}
+
+// Instancias para los tipos de registro soportados (registro.h)
+#define INSTANCIAR_MERGESORT(T) template class MergesortExterno<T>;
+PARA_CADA_REGISTRO(INSTANCIAR_MERGESORT)
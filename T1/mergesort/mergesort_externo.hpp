@@ -6,37 +6,146 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include "../misc/io_asincrono.h"
+#include "../misc/dispositivo_bloques.h"
+#include "../misc/plan_buffers.h"
+#include "../misc/plan_mezclas.h"
+#include "../misc/ordenamiento_paralelo.h"
+#include "../misc/mezcla_simd.h"
+#include "../misc/compresion_runs.h"
+#include "../misc/manifiesto.h"
+#include "../misc/directorios_temporales.h"
+#include "../misc/flujo_ordenado.h"
+#include "../misc/registro.h"
 
+/**
+ * Forma de generar los runs ordenados iniciales del mergesort
+ */
+enum class GeneracionRuns {
+    VentanasMemoria,    // Ordena ventanas consecutivas de tamaño M leidas directo desde la entrada
+    SeleccionReemplazo  // Recorre la entrada con un heap de tamaño M, runs de largo ~2M
+};
+
+/**
+ * Rango [inicio, fin) de registros de un archivo ordenado que participa en una mezcla
+ */
+struct TramoRun {
+    std::string nombre;
+    size_t inicio;
+    size_t fin;
+};
+
+/**
+ * Destino de la salida de una mezcla que no se escribe en un archivo: recibe cada buffer de salida lleno y lo puede
+ * usar hasta que se le entrega el siguiente. Devuelve false para detener la mezcla
+ */
+template <typename T>
+using SumideroMezcla = std::function<bool(const T* datos, size_t cantidad)>;
+
+template <typename T, typename Clave>
+class FlujoMergesort;
+
+template <typename T, typename Clave>
+class OrdenadorIncremental;
+
+/**
+ * Mergesort externo sobre archivos de registros de tamaño fijo, ordenados por la clave de 64 bits que entrega 'Clave'.
+ * Un bloque contiene B / sizeof(T) registros completos; si el registro no divide a B, el resto del bloque no se usa.
+ * Las mezclas intermedias siguen el plan de Huffman de plan_mezclas.h, y sus niveles de arriba se encadenan con la
+ * mezcla final cuando caben en M; esas mezclas no se escriben y por eso no quedan en el manifiesto.
+ * Esta instanciado en mergesort_externo.cpp para los tipos de PARA_CADA_REGISTRO (registro.h).
+ */
+template <typename T = int64_t, typename Clave = ClaveRegistro<T>>
 class MergesortExterno {
 private:
+    friend class FlujoMergesort<T, Clave>;
+    friend class OrdenadorIncremental<T, Clave>;
+
     size_t B;           // Tamaño de bloque en bytes
     size_t M;           // Tamaño de memoria principal en bytes
     size_t a;           // Aridad del mergesort
-    int contadorIO;     // Contador de operaciones I/O
-    int64_t* buffer;    // Buffer de lectura/escritura
+    std::atomic<int> contadorIO; // Contador de operaciones I/O, las mezclas en paralelo lo incrementan a la vez
+    std::atomic<bool> errorIO;   // Una mezcla fallo al leer o escribir desde que empezo el ordenamiento
+    T* buffer;          // Buffer de lectura/escritura de un bloque
+    GeneracionRuns modo_runs; // Forma de generar los runs iniciales
+    TipoDispositivo dispositivo; // Forma de leer y escribir bloques, tambien en la mezcla asincrona
+    BackendIO backendIO;      // Backend de I/O asincrono para la mezcla
+    PlanBuffers planMezcla;   // Reparto de M usado en la última mezcla
+    PlanMezclas planMezclas;  // Orden de las mezclas del último ordenamiento
+    std::unique_ptr<PoolHilos> pool; // Hilos que ordenan y mezclan los runs
+    OrdenamientoMemoria ordenamiento; // Algoritmo que ordena cada run en memoria
+    size_t memoriaAuxiliar;   // Bytes extra permitidos para el buffer auxiliar de radix sort
+    NivelSimd nivelSimd;      // Instrucciones de la mezcla de dos tramos
+    bool compresionRuns;      // Indica si los runs intermedios se guardan comprimidos (compresion_runs.h)
+    bool checkpoint;          // Indica si los pasos terminados se registran en un manifiesto para retomarlos
+    bool mezclaEncadenada;    // Indica si los niveles de arriba del arbol de mezclas se encadenan con la mezcla final
+    Manifiesto manifiesto;    // Runs y mezclas terminados del ordenamiento en curso
+    DirectoriosTemporales temporales; // Directorios donde se reparten los runs y las mezclas intermedias
 
     // Métodos auxiliares
-    void leerBloque(FILE* archivo, int64_t* bloque, size_t posicion);
-    void escribirBloque(FILE* archivo, int64_t* bloque, size_t posicion);
+    size_t registrosPorBloque() const { return std::max<size_t>(B / sizeof(T), 1); }
+    bool comprimeRuns() const { return compresionRuns && std::is_same<T, int64_t>::value; }
+    size_t memoriaBuffersMezcla(size_t memoria, size_t entradas) const;
+    bool validarHeredado(const std::string& nombre);
+    size_t leerBloque(ArchivoBloques& archivo, T* bloque, size_t posicion);
+    bool escribirBloque(ArchivoBloques& archivo, const T* bloque, size_t posicion, size_t elementos);
     
-    std::vector<std::string> dividirArchivo(const std::string& archivo_entrada, const std::string& archivo_salida, size_t inicio, size_t fin);
-    void mergeArchivos(const std::vector<std::string>& archivos_temp, const std::string& archivo_salida);
+    bool mergeTramos(const std::vector<TramoRun>& tramos, ArchivoBloques* salida, uint64_t offset_salida, const PlanBuffers& plan,
+                     bool entrada_comprimida = false, bool salida_comprimida = false, SumaVerificacion* suma = nullptr,
+                     const SumideroMezcla<T>* sumidero = nullptr, const std::vector<FlujoOrdenado<T>*>* flujos = nullptr);
+    bool mergeArchivos(const std::vector<std::string>& archivos_temp, const std::string& archivo_salida, const PlanBuffers& plan,
+                     bool entrada_comprimida = false, bool salida_comprimida = false, SumaVerificacion* suma = nullptr);
+    bool mergeFinalParticionado(const std::vector<std::string>& runs, const std::string& archivo_salida, size_t particiones);
+    size_t elementosEnArchivo(const std::string& nombre);
     
     // Nuevo método para ordenar fragmentos que caben en memoria
-    void ordenarEnMemoria(const std::string& archivo_entrada, const std::string& archivo_salida, size_t inicio, size_t fin);
+    bool ordenarEnMemoria(const std::string& archivo_entrada, const std::string& archivo_salida, size_t inicio, size_t fin, uint64_t& suma_salida,
+                          bool comprimir = false);
+
+    // Generadores de los runs ordenados iniciales
+    std::vector<std::string> generarRunsVentanas(const std::string& archivo_entrada, const std::string& archivo_salida, size_t num_elementos, int& contador_temp);
+    std::vector<std::string> generarRunsSeleccionReemplazo(const std::string& archivo_entrada, const std::string& archivo_salida, size_t num_elementos, int& contador_temp);
+
+    // Runs y mezclas, saltando los pasos que el manifiesto ya tiene terminados
+    bool generarNivelFinal(const std::string& archivo_entrada, const std::string& archivo_salida, size_t N,
+                           std::vector<std::string>& nivel, bool& runs_comprimidos,
+                           std::vector<std::unique_ptr<FlujoOrdenado<T>>>& encadenadas);
+    bool ordenarPorPasos(const std::string& archivo_entrada, const std::string& archivo_salida, size_t N);
+    std::unique_ptr<FlujoOrdenado<T>> flujoSobreRuns(const std::vector<std::string>& runs, bool comprimidos);
 
 public:
-    MergesortExterno(size_t tamano_bloque, size_t tamano_memoria, size_t aridad);
+    MergesortExterno(size_t tamano_bloque, size_t tamano_memoria, size_t aridad,
+                     TipoDispositivo dispositivo = TipoDispositivo::Posicional);
     ~MergesortExterno();
     
     // Método principal de ordenamiento (ahora iterativo)
     void mergesort(const std::string& archivo_entrada, const std::string& archivo_salida, size_t N);
     
+    // Ordena sin archivo de salida, la mezcla final avanza a medida que se consume el flujo
+    std::unique_ptr<FlujoOrdenado<T>> abrirFlujo(const std::string& archivo_entrada, size_t N);
+    
     // Métodos auxiliares
     int obtenerContadorIO();
     void resetContadorIO();
     void updateAridad(size_t new_a);
+    void updateGeneracionRuns(GeneracionRuns modo);
+    void updateBackendIO(BackendIO backend);
+    void updateHilos(unsigned hilos);
+    void updateOrdenamiento(OrdenamientoMemoria algoritmo, size_t memoria_auxiliar);
+    void updateNivelSimd(NivelSimd nivel);
+    void updateCompresionRuns(bool comprimir);
+    void updateCheckpoint(bool activar);
+    void updateMezclaEncadenada(bool activar);
+    void updateDirectoriosTemporales(const std::vector<std::string>& directorios,
+                                     PoliticaTemporales politica = PoliticaTemporales::Rotacion);
+    const PlanBuffers& obtenerPlanMezcla() const;
+    const PlanMezclas& obtenerPlanMezclas() const;
+    PlanMezclas planMezclasPrevisto(size_t N) const;
     void limpiarBuffer();
 };
 
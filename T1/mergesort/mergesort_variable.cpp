@@ -0,0 +1,438 @@
+#include "mergesort_variable.hpp"
+#include <new>
+#include "arbol_perdedores.hpp"
+
+/**
+ * Lector secuencial de registros de largo variable. Lee el archivo en pedazos de bloques completos; un registro
+ * que cabe entero en el pedazo actual se entrega apuntando al pedazo, y uno que cruza el limite se arma en un
+ * buffer propio. El registro entregado es valido hasta la siguiente llamada a siguiente(). Una lectura corta antes
+ * del final del archivo, o un registro truncado, terminan la lectura y quedan marcados en fallo()
+ */
+class LectorVariable {
+private:
+    ArchivoBloques& archivo;
+    size_t B;
+    std::atomic<int>& contadorIO;
+    std::vector<unsigned char> pedazo;      // Bloques leidos del archivo
+    size_t pos = 0;                         // Próximo byte del pedazo a consumir
+    size_t disponibles = 0;                 // Bytes validos del pedazo
+    uint64_t offset = 0;                    // Byte del archivo donde comienza el próximo pedazo
+    uint64_t tamano;                        // Bytes del archivo
+    bool fin = false;                       // Indica si ya se leyo el ultimo pedazo
+    bool error = false;                     // Una lectura quedo corta o el ultimo registro esta truncado
+    std::vector<unsigned char> ensamblado;  // Registro que cruza el limite del pedazo
+
+    bool cargar() {
+        if (fin) return false;
+        size_t leidos = archivo.leer(pedazo.data(), pedazo.size(), offset);
+        contadorIO += bloquesTransferidos(leidos, B);
+        offset += leidos;
+        pos = 0;
+        disponibles = leidos;
+        if (leidos < pedazo.size()) {
+            fin = true;
+            error = offset < tamano;
+        }
+        return leidos > 0;
+    }
+
+    /**
+     * Copia los siguientes 'bytes' bytes del archivo en 'destino', cargando pedazos si hace falta
+     * @return false si el archivo se acabo antes
+     */
+    bool copiar(unsigned char* destino, size_t bytes) {
+        while (bytes > 0) {
+            if (pos == disponibles && !cargar()) return false;
+            size_t n = std::min(bytes, disponibles - pos);
+            memcpy(destino, pedazo.data() + pos, n);
+            pos += n;
+            destino += n;
+            bytes -= n;
+        }
+        return true;
+    }
+
+public:
+    /**
+     * @param bytes_por_pedazo bytes de cada lectura, multiplo de B
+     */
+    LectorVariable(ArchivoBloques& archivo, size_t bytes_por_pedazo, size_t B, std::atomic<int>& contador)
+        : archivo(archivo), B(B), contadorIO(contador), pedazo(bytes_por_pedazo), tamano(archivo.tamano()) {}
+
+    /**
+     * @return true si la lectura termino por un error y no por el fin del archivo
+     */
+    bool fallo() const { return error; }
+
+    /**
+     * Lee el siguiente registro
+     * @param ref referencia al registro leido, con su prefijo normalizado
+     * @return false al llegar al fin del archivo, o si el ultimo registro esta truncado
+     */
+    bool siguiente(RefRegistro& ref) {
+        if (pos == disponibles && !cargar()) return false;
+        uint32_t largo;
+        if (!copiar(reinterpret_cast<unsigned char*>(&largo), sizeof(largo))) {
+            std::cerr << "Error: registro truncado al final del archivo" << std::endl;
+            error = true;
+            return false;
+        }
+        if (disponibles - pos >= largo) {
+            ref.datos = pedazo.data() + pos;
+            pos += largo;
+        } else {
+            ensamblado.resize(largo);
+            if (!copiar(ensamblado.data(), largo)) {
+                std::cerr << "Error: registro truncado al final del archivo" << std::endl;
+                error = true;
+                return false;
+            }
+            ref.datos = ensamblado.data();
+        }
+        ref.largo = largo;
+        ref.prefijo = prefijoNormalizado(ref.datos, largo);
+        return true;
+    }
+};
+
+/**
+ * Escritor secuencial de registros de largo variable. Empaqueta los registros uno tras otro en un pedazo de
+ * bloques completos y lo escribe cuando se llena, por lo que los registros cruzan los limites de bloque. Una
+ * escritura corta queda marcada en fallo()
+ */
+class EscritorVariable {
+private:
+    ArchivoBloques& archivo;
+    size_t B;
+    std::atomic<int>& contadorIO;
+    std::vector<unsigned char> pedazo;  // Bytes pendientes de escribir
+    size_t pos = 0;                     // Bytes ocupados del pedazo
+    uint64_t offset = 0;                // Byte del archivo donde se escribe el pedazo
+    bool error = false;                 // Alguna escritura quedo incompleta
+
+    void vaciar() {
+        if (pos == 0) return;
+        size_t escritos = archivo.escribir(pedazo.data(), pos, offset);
+        error = error || escritos != pos;
+        offset += escritos;
+        contadorIO += bloquesTransferidos(pos, B);
+        pos = 0;
+    }
+
+    void agregar(const unsigned char* origen, size_t bytes) {
+        while (bytes > 0) {
+            size_t n = std::min(bytes, pedazo.size() - pos);
+            memcpy(pedazo.data() + pos, origen, n);
+            pos += n;
+            origen += n;
+            bytes -= n;
+            if (pos == pedazo.size()) vaciar();
+        }
+    }
+
+public:
+    /**
+     * @param bytes_por_pedazo bytes de cada escritura, multiplo de B
+     */
+    EscritorVariable(ArchivoBloques& archivo, size_t bytes_por_pedazo, size_t B, std::atomic<int>& contador)
+        : archivo(archivo), B(B), contadorIO(contador), pedazo(bytes_por_pedazo) {}
+
+    /**
+     * Agrega un registro, con su largo, a la salida
+     */
+    void escribir(const RefRegistro& ref) {
+        agregar(reinterpret_cast<const unsigned char*>(&ref.largo), sizeof(ref.largo));
+        agregar(ref.datos, ref.largo);
+    }
+
+    /**
+     * Escribe el pedazo parcial que quede; el ultimo bloque del archivo puede quedar incompleto
+     */
+    void terminar() {
+        vaciar();
+    }
+
+    /**
+     * @return true si alguna escritura quedo incompleta
+     */
+    bool fallo() const { return error; }
+};
+
+/**
+ * Constructor del mergesort de registros de largo variable, con el tamaño de bloque, el tamaño de memoria, la aridad
+ * y el dispositivo con que se leen y escriben los bloques. Crea un pool con un hilo por nucleo para las mezclas.
+ */
+MergesortVariable::MergesortVariable(size_t tamano_bloque, size_t tamano_memoria, size_t aridad, TipoDispositivo dispositivo)
+    : B(tamano_bloque), M(tamano_memoria), a(aridad), contadorIO(0), errorIO(false), dispositivo(dispositivo) {
+    pool.reset(new PoolHilos(hilosDisponibles()));
+}
+
+/**
+ * Genera los runs ordenados iniciales. Los registros se copian al inicio de un buffer de M bytes (descontando un
+ * bloque de lectura y uno de escritura) y sus referencias de prefijo y puntero se ubican desde el final del mismo
+ * buffer, de modo que bytes y referencias comparten la memoria; se ordenan las referencias y los registros se
+ * escriben empaquetados en un run. Un registro que no cabe en el buffer forma un run por si solo. Ante un error de
+ * I/O se borran los runs creados y se marca errorIO
+ * @param archivo_entrada Nombre del archivo a ordenar
+ * @param archivo_salida Nombre base para los archivos temporales
+ * @param contador_temp Contador para nombres únicos de los runs
+ * @return nombres de los runs generados, en orden; vacio si hubo un error
+ */
+std::vector<std::string> MergesortVariable::generarRuns(const std::string& archivo_entrada, const std::string& archivo_salida, int& contador_temp) {
+    std::vector<std::string> runs;
+    std::unique_ptr<ArchivoBloques> entrada = abrirArchivoBloques(dispositivo, archivo_entrada, ModoApertura::Lectura);
+    if (!entrada) {
+        std::cerr << "Error: No se pudo abrir el archivo de entrada" << std::endl;
+        errorIO = true;
+        return runs;
+    }
+    LectorVariable lector(*entrada, B, B, contadorIO);
+
+    auto fallar = [&](const std::string& mensaje) {
+        std::cerr << mensaje << std::endl;
+        errorIO = true;
+        for (const auto& nombre : runs) {
+            remove(nombre.c_str());
+        }
+        return std::vector<std::string>();
+    };
+
+    // Los bytes crecen desde el inicio y las referencias desde el final alineado del mismo buffer
+    size_t memoria_registros = (M > 2 * B) ? M - 2 * B : B;
+    memoria_registros -= memoria_registros % alignof(RefRegistro);
+    std::vector<unsigned char> buffer(std::max(memoria_registros, sizeof(RefRegistro)));
+    unsigned char* memoria = buffer.data();
+    RefRegistro* fin_refs = reinterpret_cast<RefRegistro*>(memoria + buffer.size());
+
+    RefRegistro actual;
+    bool hay_actual = lector.siguiente(actual);
+    while (hay_actual) {
+        size_t usados = 0;
+        RefRegistro* refs = fin_refs;
+        do {
+            size_t libres = reinterpret_cast<unsigned char*>(refs) - (memoria + usados);
+            if (actual.largo + sizeof(RefRegistro) > libres) break;
+            RefRegistro* copia = new (refs - 1) RefRegistro(actual);
+            copia->datos = memoria + usados;
+            std::memcpy(memoria + usados, actual.datos, actual.largo);
+            usados += actual.largo;
+            refs = copia;
+            hay_actual = lector.siguiente(actual);
+        } while (hay_actual);
+
+        // Sin referencias el registro actual no cabe en el buffer y se escribe desde el lector como run propio
+        bool solo = refs == fin_refs;
+        if (solo) {
+            refs = &actual;
+        } else {
+            std::sort(refs, fin_refs, MenorRefRegistro());
+        }
+
+        std::string nombre_run = temporales.ruta(archivo_salida, ".sorted_" + std::to_string(contador_temp++));
+        std::unique_ptr<ArchivoBloques> salida = abrirArchivoBloques(dispositivo, nombre_run, ModoApertura::Escritura);
+        if (!salida) {
+            return fallar("Error al abrir archivo de salida: " + nombre_run);
+        }
+        runs.push_back(nombre_run);
+        EscritorVariable escritor(*salida, B, B, contadorIO);
+        for (const RefRegistro* ref = refs; ref != (solo ? refs + 1 : fin_refs); ref++) {
+            escritor.escribir(*ref);
+        }
+        escritor.terminar();
+        if (escritor.fallo()) {
+            return fallar("Error: no se pudo escribir el run " + nombre_run);
+        }
+        if (solo) hay_actual = lector.siguiente(actual);
+    }
+    if (lector.fallo()) {
+        return fallar("Error: no se pudo leer el archivo de entrada " + archivo_entrada);
+    }
+    return runs;
+}
+
+/**
+ * Mezcla archivos ordenados de registros de largo variable con un arbol de perdedores sobre las referencias de
+ * las cabezas, por lo que casi todas las comparaciones son entre prefijos
+ * @param archivos_temp archivos a mezclar, cada uno ordenado
+ * @param archivo_salida archivo donde se escribe la mezcla
+ * @param plan reparto de memoria entre los buffers de entrada y el de salida
+ * @return false si hubo un error de I/O; la salida parcial se borra y las entradas quedan intactas
+ */
+bool MergesortVariable::mergeArchivos(const std::vector<std::string>& archivos_temp, const std::string& archivo_salida, const PlanBuffers& plan) {
+    std::vector<std::unique_ptr<ArchivoBloques>> entradas;
+    std::vector<std::unique_ptr<LectorVariable>> lectores;
+    for (const auto& nombre : archivos_temp) {
+        entradas.push_back(abrirArchivoBloques(dispositivo, nombre, ModoApertura::Lectura));
+        if (!entradas.back()) {
+            std::cerr << "Error al abrir archivo temporal: " << nombre << std::endl;
+            errorIO = true;
+            return false;
+        }
+        lectores.emplace_back(new LectorVariable(*entradas.back(), plan.bytesPorBuffer(), B, contadorIO));
+    }
+
+    std::unique_ptr<ArchivoBloques> salida = abrirArchivoBloques(dispositivo, archivo_salida, ModoApertura::Escritura);
+    if (!salida) {
+        std::cerr << "Error al abrir archivo de salida: " << archivo_salida << std::endl;
+        errorIO = true;
+        return false;
+    }
+    EscritorVariable escritor(*salida, plan.bytesPorBuffer(), B, contadorIO);
+
+    ArbolPerdedores<RefRegistro, MenorRefRegistro> arbol(lectores.size());
+    RefRegistro ref;
+    for (size_t i = 0; i < lectores.size(); i++) {
+        if (lectores[i]->siguiente(ref)) {
+            arbol.fijarHoja(i, ref);
+        }
+    }
+    arbol.construir();
+
+    // El ganador se escribe antes de avanzar su lector, que invalida la referencia
+    while (!arbol.vacio()) {
+        size_t i = arbol.ganador();
+        escritor.escribir(arbol.valorGanador());
+        if (lectores[i]->siguiente(ref)) {
+            arbol.reemplazarGanador(ref);
+        } else {
+            arbol.agotarGanador();
+        }
+    }
+    escritor.terminar();
+
+    bool fallo = escritor.fallo();
+    for (const auto& lector : lectores) {
+        fallo = fallo || lector->fallo();
+    }
+    if (fallo) {
+        std::cerr << "Error: la mezcla en " << archivo_salida << " quedo incompleta" << std::endl;
+        errorIO = true;
+        salida.reset();
+        remove(archivo_salida.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Ordena un archivo de registros de largo variable: genera los runs, los mezcla por niveles de aridad a (los grupos
+ * de un nivel en paralelo en el pool) y termina con una mezcla directa sobre el archivo de salida
+ * @param archivo_entrada Nombre del archivo a ordenar
+ * @param archivo_salida Nombre del archivo de salida ordenado
+ * @return false si un error de I/O detuvo el ordenamiento; los runs de la mezcla que fallo se conservan
+ */
+bool MergesortVariable::mergesort(const std::string& archivo_entrada, const std::string& archivo_salida) {
+    if (!abrirArchivoBloques(dispositivo, archivo_entrada, ModoApertura::Lectura)) {
+        std::cerr << "Error: No se pudo abrir el archivo de entrada" << std::endl;
+        return false;
+    }
+
+    errorIO = false;
+    int contador_temp = 0;
+    std::vector<std::string> runs = generarRuns(archivo_entrada, archivo_salida, contador_temp);
+    if (errorIO) {
+        std::cerr << "Error: se detiene el ordenamiento por un error de I/O" << std::endl;
+        return false;
+    }
+
+    // Mezclar por niveles, repartiendo M entre las mezclas simultaneas
+    size_t aridad = std::max<size_t>(a, 2);
+    std::vector<std::string> nivel = runs;
+    while (nivel.size() > aridad) {
+        std::vector<std::string> siguiente_nivel;
+        std::vector<std::pair<std::vector<std::string>, std::string>> grupos;
+        for (size_t i = 0; i < nivel.size(); i += aridad) {
+            std::vector<std::string> grupo_fusion(nivel.begin() + i, nivel.begin() + std::min(i + aridad, nivel.size()));
+
+            // Un run que queda solo pasa al siguiente nivel sin reescribirse
+            if (grupo_fusion.size() == 1) {
+                siguiente_nivel.push_back(grupo_fusion[0]);
+                continue;
+            }
+
+            std::string archivo_fusionado = temporales.ruta(archivo_salida, ".merged_" + std::to_string(contador_temp++));
+            grupos.emplace_back(grupo_fusion, archivo_fusionado);
+            siguiente_nivel.push_back(archivo_fusionado);
+        }
+
+        size_t concurrentes = std::max<size_t>(1, std::min<size_t>(pool->tamano(), grupos.size()));
+        PlanBuffers plan = planificarBuffers(M / concurrentes, B, aridad, 1);
+        for (const auto& grupo : grupos) {
+            pool->encolar([this, grupo, plan]() {
+                if (!mergeArchivos(grupo.first, grupo.second, plan)) return;
+                for (const auto& nombre : grupo.first) {
+                    remove(nombre.c_str());
+                }
+            });
+        }
+        pool->esperarTodas();
+        if (errorIO) {
+            std::cerr << "Error: se detiene el ordenamiento por un error de I/O" << std::endl;
+            return false;
+        }
+        nivel = siguiente_nivel;
+    }
+
+    // Mezcla final directo sobre el archivo de salida
+    if (nivel.empty()) {
+        // Entrada vacía, sin runs: el archivo de salida queda vacío
+        if (!abrirArchivoBloques(dispositivo, archivo_salida, ModoApertura::Escritura)) {
+            std::cerr << "Error al abrir archivo de salida: " << archivo_salida << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    if (nivel.size() == 1) {
+        // Un solo run ya es el resultado, se renombra; si no se puede (otro dispositivo) se copia
+        if (rename(nivel[0].c_str(), archivo_salida.c_str()) == 0) return true;
+    }
+
+    if (!mergeArchivos(nivel, archivo_salida, planificarBuffers(M, B, nivel.size(), 1))) {
+        std::cerr << "Error: se detiene el ordenamiento por un error de I/O" << std::endl;
+        return false;
+    }
+    for (const auto& nombre : nivel) {
+        remove(nombre.c_str());
+    }
+    return true;
+}
+
+/**
+ * Obtiene el contador de I/O
+ * @return bloques transferidos desde el último reinicio
+ */
+int MergesortVariable::obtenerContadorIO() {
+    return contadorIO;
+}
+
+/**
+ * Reinicia el contador de IO
+ */
+void MergesortVariable::resetContadorIO() {
+    contadorIO = 0;
+}
+
+/**
+ * Actualiza la aridad del mergesort
+ */
+void MergesortVariable::updateAridad(size_t new_a) {
+    this->a = new_a;
+}
+
+/**
+ * Cambia la cantidad de hilos que mezclan en paralelo los grupos de un nivel
+ * @param hilos hilos del pool, con 0 las mezclas se hacen en secuencia
+ */
+void MergesortVariable::updateHilos(unsigned hilos) {
+    pool.reset(new PoolHilos(hilos));
+}
+
+/**
+ * Cambia los directorios donde se crean los runs y las mezclas intermedias
+ * @param directorios directorios de los temporales; vacio para dejarlos junto al archivo de salida
+ * @param politica Rotacion o EspacioLibre
+ */
+void MergesortVariable::updateDirectoriosTemporales(const std::vector<std::string>& directorios, PoliticaTemporales politica) {
+    temporales.configurar(directorios, politica);
+}
@@ -0,0 +1,97 @@
+#ifndef MERGESORT_VARIABLE_HPP
+#define MERGESORT_VARIABLE_HPP
+
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include "../misc/dispositivo_bloques.h"
+#include "../misc/plan_buffers.h"
+#include "../misc/pool_hilos.h"
+#include "../misc/directorios_temporales.h"
+
+/**
+ * Referencia en memoria a un registro de largo variable. Junto al puntero se guarda el prefijo normalizado de los
+ * datos, asi la mayoria de las comparaciones son una comparacion de enteros sin tocar el registro.
+ */
+struct RefRegistro {
+    uint64_t prefijo;            // Primeros 8 bytes en orden big-endian, rellenos con ceros si el registro es mas corto
+    const unsigned char* datos;  // Bytes del registro, sin el largo
+    uint32_t largo;              // Largo del registro en bytes
+};
+
+/**
+ * Prefijo normalizado de un registro: sus primeros 8 bytes leidos como entero big-endian, de modo que el orden de los
+ * enteros sin signo coincide con el orden lexicografico de los bytes
+ * @param datos bytes del registro
+ * @param largo largo del registro
+ * @return prefijo del registro
+ */
+inline uint64_t prefijoNormalizado(const unsigned char* datos, uint32_t largo) {
+    unsigned char bytes[8] = {0};
+    memcpy(bytes, datos, std::min<size_t>(largo, sizeof(bytes)));
+    uint64_t prefijo;
+    memcpy(&prefijo, bytes, sizeof(prefijo));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    prefijo = __builtin_bswap64(prefijo);
+#endif
+    return prefijo;
+}
+
+/**
+ * Orden lexicografico de bytes entre registros; un registro que es prefijo de otro va primero.
+ * Solo si los prefijos empatan se comparan los bytes que siguen a los primeros 8
+ */
+struct MenorRefRegistro {
+    bool operator()(const RefRegistro& x, const RefRegistro& y) const {
+        if (x.prefijo != y.prefijo) return x.prefijo < y.prefijo;
+        uint32_t comun = std::min(x.largo, y.largo);
+        if (comun > 8) {
+            int cmp = memcmp(x.datos + 8, y.datos + 8, comun - 8);
+            if (cmp != 0) return cmp < 0;
+        }
+        return x.largo < y.largo;
+    }
+};
+
+/**
+ * Mergesort externo de registros de largo variable, por ejemplo lineas de log o URLs. Cada registro del archivo es
+ * un largo uint32_t (en el orden de bytes de la maquina) seguido de sus bytes, sin relleno: los registros cruzan los
+ * limites de bloque, asi ningun bloque desperdicia espacio. Usa la misma estructura que MergesortExterno: runs que
+ * caben en M, mezclas por niveles de aridad a en paralelo y una mezcla final sobre el archivo de salida.
+ */
+class MergesortVariable {
+private:
+    size_t B;           // Tamaño de bloque en bytes
+    size_t M;           // Tamaño de memoria principal en bytes
+    size_t a;           // Aridad del mergesort
+    std::atomic<int> contadorIO; // Contador de bloques transferidos, las mezclas en paralelo lo incrementan a la vez
+    std::atomic<bool> errorIO;   // Una lectura o escritura fallo desde que empezo el ordenamiento
+    TipoDispositivo dispositivo; // Forma de leer y escribir bloques
+    std::unique_ptr<PoolHilos> pool; // Hilos que mezclan los grupos de un mismo nivel
+    DirectoriosTemporales temporales; // Directorios donde se reparten los runs y las mezclas intermedias
+
+    std::vector<std::string> generarRuns(const std::string& archivo_entrada, const std::string& archivo_salida, int& contador_temp);
+    bool mergeArchivos(const std::vector<std::string>& archivos_temp, const std::string& archivo_salida, const PlanBuffers& plan);
+
+public:
+    MergesortVariable(size_t tamano_bloque, size_t tamano_memoria, size_t aridad,
+                      TipoDispositivo dispositivo = TipoDispositivo::Posicional);
+
+    // Método principal de ordenamiento
+    bool mergesort(const std::string& archivo_entrada, const std::string& archivo_salida);
+
+    // Métodos auxiliares
+    int obtenerContadorIO();
+    void resetContadorIO();
+    void updateAridad(size_t new_a);
+    void updateHilos(unsigned hilos);
+    void updateDirectoriosTemporales(const std::vector<std::string>& directorios,
+                                     PoliticaTemporales politica = PoliticaTemporales::Rotacion);
+};
+
+#endif // MERGESORT_VARIABLE_HPP
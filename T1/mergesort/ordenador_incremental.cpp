@@ -0,0 +1,240 @@
+#include "ordenador_incremental.hpp"
+#include <cstdio>
+#include <new>
+
+/**
+ * Constructor del ordenador incremental. Reserva el primer buffer de ingesta; el segundo y los hilos escritor y
+ * mezclador se crean recien cuando los datos no caben en uno
+ */
+template <typename T, typename Clave>
+OrdenadorIncremental<T, Clave>::OrdenadorIncremental(MergesortExterno<T, Clave>& mergesort, const std::string& nombre)
+    : mergesort(mergesort), nombre(nombre) {
+    capacidad = std::max<size_t>(mergesort.M / 4 / sizeof(T), 1);
+    buffers[0].resize(capacidad);
+}
+
+/**
+ * Destructor, espera a los dos hilos y borra los runs que no alcanzaron a pasar a un flujo. El escritor se espera
+ * primero porque es el que encola las mezclas
+ */
+template <typename T, typename Clave>
+OrdenadorIncremental<T, Clave>::~OrdenadorIncremental() {
+    if (escritor) escritor->esperarTodas();
+    if (mezclador) mezclador->esperarTodas();
+    for (const auto& nivel : niveles) {
+        for (const auto& run : nivel) {
+            remove(run.c_str());
+        }
+    }
+}
+
+/**
+ * Copia los registros al buffer actual y entrega cada buffer lleno al hilo escritor
+ */
+template <typename T, typename Clave>
+void OrdenadorIncremental<T, Clave>::agregar(const T* datos, size_t cantidad) {
+    if (terminado) {
+        std::cerr << "Error: no se pueden agregar registros despues de terminar" << std::endl;
+        return;
+    }
+    while (cantidad > 0) {
+        // El buffer se entrega recien cuando llega un registro que no cabe, asi una entrada de exactamente
+        // un buffer todavia se resuelve en memoria
+        if (en_actual == capacidad) {
+            derramar(actual, en_actual);
+            actual = 1 - actual;
+            en_actual = 0;
+        }
+        size_t copiar = std::min(cantidad, capacidad - en_actual);
+        memcpy(buffers[actual].data() + en_actual, datos, copiar * sizeof(T));
+        en_actual += copiar;
+        datos += copiar;
+        cantidad -= copiar;
+    }
+}
+
+/**
+ * Entrega un buffer lleno al hilo escritor, que lo ordena, lo escribe como run y le pasa la cascada al hilo
+ * mezclador. Antes espera a que el otro buffer este libre, porque es donde sigue la ingesta
+ * @param indice buffer a entregar
+ * @param cantidad registros del buffer
+ */
+template <typename T, typename Clave>
+void OrdenadorIncremental<T, Clave>::derramar(size_t indice, size_t cantidad) {
+    if (!escritor) {
+        escritor.reset(new PoolHilos(1));
+        mezclador.reset(new PoolHilos(1));
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        liberado.wait(lock, [&]() { return !ocupado[1 - indice]; });
+        ocupado[indice] = true;
+    }
+    if (buffers[1 - indice].size() < capacidad) buffers[1 - indice].resize(capacidad);
+    derramados++;
+
+    escritor->encolar([this, indice, cantidad]() {
+        T* datos = buffers[indice].data();
+        std::unique_ptr<T[]> auxiliar;
+        if (mergesort.ordenamiento == OrdenamientoMemoria::Radix && cantidad * sizeof(T) <= mergesort.memoriaAuxiliar) {
+            auxiliar.reset(new (std::nothrow) T[cantidad]);
+        }
+        ordenarArreglo<T, Clave>(datos, cantidad, auxiliar.get(), mergesort.ordenamiento);
+        auxiliar.reset();
+
+        std::string nombre_run = mergesort.temporales.ruta(nombre, ".sorted_" + std::to_string(contador_temp++));
+        if (!escribirRun(datos, cantidad, nombre_run)) fallo = true;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ocupado[indice] = false;
+            if (niveles.empty()) niveles.emplace_back();
+            niveles[0].push_back(nombre_run);
+        }
+        liberado.notify_all();
+        mezclador->encolar([this]() { mezclarCascada(); });
+    });
+}
+
+/**
+ * Cascada: mientras algun nivel junte 'a' runs, mezcla los 'a' mas antiguos del nivel mas bajo en uno del nivel
+ * siguiente. Corre en el hilo mezclador; la lista de niveles se toca solo con el mutex, porque el escritor sigue
+ * agregando runs al nivel 0 durante la mezcla
+ */
+template <typename T, typename Clave>
+void OrdenadorIncremental<T, Clave>::mezclarCascada() {
+    size_t aridad = std::max<size_t>(mergesort.a, 2);
+    while (true) {
+        std::vector<std::string> grupo;
+        size_t i = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (i < niveles.size() && niveles[i].size() < aridad) i++;
+            if (i == niveles.size()) return;
+            grupo.assign(niveles[i].begin(), niveles[i].begin() + aridad);
+            niveles[i].erase(niveles[i].begin(), niveles[i].begin() + aridad);
+        }
+        std::string fusionado = mezclar(grupo);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (i + 1 == niveles.size()) niveles.emplace_back();
+            niveles[i + 1].push_back(fusionado);
+        }
+    }
+}
+
+/**
+ * Escribe un arreglo ordenado como run, por bloques o en el formato comprimido si el mergesort comprime sus runs
+ * @param datos registros ordenados
+ * @param cantidad cantidad de registros
+ * @param nombre_run archivo del run
+ * @return false si no se pudo abrir el run o una escritura quedo incompleta
+ */
+template <typename T, typename Clave>
+bool OrdenadorIncremental<T, Clave>::escribirRun(const T* datos, size_t cantidad, const std::string& nombre_run) {
+    std::unique_ptr<ArchivoBloques> salida = abrirArchivoBloques(mergesort.dispositivo, nombre_run, ModoApertura::Escritura);
+    if (!salida) {
+        std::cerr << "Error al abrir archivo de salida: " << nombre_run << std::endl;
+        return false;
+    }
+    bool completo = true;
+    if (mergesort.comprimeRuns()) {
+        EscritorComprimido comprimido(*salida, mergesort.B, mergesort.contadorIO);
+        comprimido.agregar(reinterpret_cast<const int64_t*>(datos), cantidad);
+        comprimido.terminar();
+        completo = !comprimido.fallo();
+    } else {
+        size_t por_bloque = mergesort.registrosPorBloque();
+        for (size_t i = 0; i * por_bloque < cantidad; i++) {
+            completo = mergesort.escribirBloque(*salida, datos + i * por_bloque, i, std::min(por_bloque, cantidad - i * por_bloque)) && completo;
+        }
+    }
+    if (!completo) std::cerr << "Error al escribir el run: " << nombre_run << std::endl;
+    return completo;
+}
+
+/**
+ * Mezcla runs en uno nuevo con la mitad de M que le corresponde al hilo mezclador, y borra los mezclados. Si la
+ * mezcla falla se marca 'fallo' y terminar() no entrega el resultado incompleto
+ * @param runs runs a mezclar
+ * @return nombre del run resultante
+ */
+template <typename T, typename Clave>
+std::string OrdenadorIncremental<T, Clave>::mezclar(const std::vector<std::string>& runs) {
+    std::string fusionado = mergesort.temporales.ruta(nombre, ".merged_" + std::to_string(contador_temp++));
+    size_t k = runs.size();
+    bool comprimidos = mergesort.comprimeRuns();
+    PlanBuffers plan = planificarBuffers(mergesort.memoriaBuffersMezcla(mergesort.M / 2, k), mergesort.B, k, 1, 2, 2);
+    if (!mergesort.mergeArchivos(runs, fusionado, plan, comprimidos, comprimidos)) fallo = true;
+    for (const auto& run : runs) {
+        remove(run.c_str());
+    }
+    return fusionado;
+}
+
+/**
+ * Si nunca se lleno un buffer, lo ordena y lo entrega desde memoria. Si no, escribe el resto como ultimo run,
+ * espera las mezclas en cascada y reduce los runs que quedan a lo mas 'a' con el plan de menor costo de
+ * planificarMezclas, para que la mezcla final avance a medida que se consume el flujo
+ */
+template <typename T, typename Clave>
+std::unique_ptr<FlujoOrdenado<T>> OrdenadorIncremental<T, Clave>::terminar() {
+    if (terminado) {
+        std::cerr << "Error: el ordenamiento incremental ya se termino" << std::endl;
+        return nullptr;
+    }
+    terminado = true;
+
+    if (derramados == 0) {
+        std::vector<T> datos;
+        datos.swap(buffers[actual]);
+        datos.resize(en_actual);
+        std::unique_ptr<T[]> auxiliar;
+        if (mergesort.ordenamiento == OrdenamientoMemoria::Radix && en_actual * sizeof(T) <= mergesort.memoriaAuxiliar) {
+            auxiliar.reset(new (std::nothrow) T[en_actual]);
+        }
+        ordenarArreglo<T, Clave>(datos.data(), datos.size(), auxiliar.get(), mergesort.ordenamiento);
+        return std::unique_ptr<FlujoOrdenado<T>>(new FlujoMemoria<T>(std::move(datos)));
+    }
+
+    if (en_actual > 0) derramar(actual, en_actual);
+    escritor->esperarTodas();
+    mezclador->esperarTodas();
+    for (auto& buffer : buffers) {
+        std::vector<T>().swap(buffer);
+    }
+
+    // Del nivel mas alto al 0 los runs quedan del mas antiguo al mas nuevo
+    std::vector<std::string> runs;
+    for (size_t i = niveles.size(); i-- > 0;) {
+        runs.insert(runs.end(), niveles[i].begin(), niveles[i].end());
+    }
+    niveles.clear();
+    std::vector<uint64_t> tamanos;
+    for (const auto& run : runs) {
+        tamanos.push_back(mergesort.elementosEnArchivo(run) * sizeof(T));
+    }
+    PlanMezclas plan = planificarMezclas(tamanos, mergesort.a);
+    for (const auto& mezcla : plan.mezclas) {
+        std::vector<std::string> grupo;
+        for (size_t entrada : mezcla.entradas) {
+            grupo.push_back(runs[entrada]);
+        }
+        runs.push_back(mezclar(grupo));
+    }
+    if (fallo) {
+        std::cerr << "Error: se detiene el ordenamiento incremental por un error de I/O" << std::endl;
+        for (const auto& run : runs) {
+            remove(run.c_str());
+        }
+        return nullptr;
+    }
+    std::vector<std::string> finales;
+    for (size_t entrada : plan.final) {
+        finales.push_back(runs[entrada]);
+    }
+    return mergesort.flujoSobreRuns(finales, mergesort.comprimeRuns());
+}
+
+// Instancias para los tipos de registro soportados (registro.h)
+#define INSTANCIAR_INCREMENTAL(T) template class OrdenadorIncremental<T>;
+PARA_CADA_REGISTRO(INSTANCIAR_INCREMENTAL)
@@ -0,0 +1,75 @@
+#ifndef ORDENADOR_INCREMENTAL_HPP
+#define ORDENADOR_INCREMENTAL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "mergesort_externo.hpp"
+#include "../misc/flujo_ordenado.h"
+#include "../misc/pool_hilos.h"
+
+/**
+ * Ordenamiento externo de registros que llegan de a lotes, sin conocer el total de antemano. Usa la configuracion
+ * y la maquinaria de un MergesortExterno (runs comprimidos, directorios temporales, algoritmo en memoria, mezcla).
+ *
+ * La memoria M se reparte en dos mitades. La primera son dos buffers de ingesta de M/4: mientras se llena uno, un
+ * hilo escritor ordena el otro y lo escribe como run. La segunda es para un hilo mezclador, que mezcla en cascada
+ * los runs terminados apenas se juntan 'a' del mismo nivel, mientras sigue la ingesta. Como son hilos distintos,
+ * escribir un run nunca espera a que termine una mezcla. Asi al terminar quedan pocos runs y el tiempo entre el
+ * ultimo registro recibido y el primero entregado es casi solo la mezcla final.
+ * Si todo cupo en un buffer no se escribe nada y el resultado se entrega desde memoria.
+ */
+template <typename T = int64_t, typename Clave = ClaveRegistro<T>>
+class OrdenadorIncremental {
+private:
+    MergesortExterno<T, Clave>& mergesort;
+    std::string nombre;            // Nombre base de los temporales
+    size_t capacidad;              // Registros de cada buffer de ingesta
+    std::vector<T> buffers[2];     // Buffers de ingesta
+    bool ocupado[2] = {false, false}; // Indica si el hilo escritor todavia esta escribiendo el buffer
+    size_t actual = 0;             // Buffer que se esta llenando
+    size_t en_actual = 0;          // Registros en el buffer actual
+    bool terminado = false;
+    std::atomic<bool> fallo{false}; // Un run o una mezcla tuvo un error de I/O; lo marcan los dos hilos
+    size_t derramados = 0;         // Buffers entregados al hilo escritor
+    std::atomic<int> contador_temp{0}; // Numera los temporales, lo usan los dos hilos
+    std::vector<std::vector<std::string>> niveles; // Runs de cada nivel de la cascada, del mas antiguo al mas nuevo; con mutex
+    std::mutex mutex;
+    std::condition_variable liberado;
+    std::unique_ptr<PoolHilos> escritor;  // Un hilo que ordena y escribe los runs, en orden
+    std::unique_ptr<PoolHilos> mezclador; // Un hilo que hace las mezclas en cascada
+
+    void derramar(size_t indice, size_t cantidad);
+    bool escribirRun(const T* datos, size_t cantidad, const std::string& nombre_run);
+    void mezclarCascada();
+    std::string mezclar(const std::vector<std::string>& runs);
+
+public:
+    /**
+     * @param mergesort ordenador configurado cuya memoria, aridad y opciones se usan; debe vivir mas que este objeto
+     * y que el flujo que entrega terminar()
+     * @param nombre nombre base de los archivos temporales, por ejemplo la ruta donde iria la salida
+     */
+    OrdenadorIncremental(MergesortExterno<T, Clave>& mergesort, const std::string& nombre);
+    ~OrdenadorIncremental();
+
+    /**
+     * Agrega registros en cualquier orden. Solo espera si los dos buffers estan llenos y el hilo escritor no
+     * termino de escribir el anterior
+     * @param datos registros a agregar
+     * @param cantidad cantidad de registros
+     */
+    void agregar(const T* datos, size_t cantidad);
+
+    /**
+     * Termina la ingesta y entrega el resultado ordenado
+     * @return flujo con todos los registros agregados, en orden, o nullptr si una mezcla tuvo un error de I/O
+     */
+    std::unique_ptr<FlujoOrdenado<T>> terminar();
+};
+
+#endif // ORDENADOR_INCREMENTAL_HPP
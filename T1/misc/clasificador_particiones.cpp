@@ -0,0 +1,162 @@
+#include "clasificador_particiones.h"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CLASIFICADOR_X86 1
+#include <immintrin.h>
+#endif
+
+// Claves que bajan juntas por el árbol en la versión escalar
+static constexpr size_t DESENROLLADO = 8;
+
+/**
+ * Copia los límites completados a 'arbol' en orden de Eytzinger: recorrer el árbol en inorden los entrega ordenados
+ */
+static void llenarEytzinger(const std::vector<int64_t>& ordenados, size_t& siguiente, std::vector<int64_t>& arbol,
+                            size_t nodo) {
+    if (nodo >= arbol.size()) return;
+    llenarEytzinger(ordenados, siguiente, arbol, 2 * nodo);
+    arbol[nodo] = ordenados[siguiente++];
+    llenarEytzinger(ordenados, siguiente, arbol, 2 * nodo + 1);
+}
+
+ClasificadorParticiones::ClasificadorParticiones(const std::vector<int64_t>& limites, NivelSimd nivel)
+    : niveles(0), cantidad_limites(limites.size()), nivel(nivel) {
+    while ((size_t(1) << niveles) - 1 < limites.size()) {
+        niveles++;
+    }
+    size_t nodos = (size_t(1) << niveles) - 1;
+    std::vector<int64_t> completados(limites);
+    completados.resize(nodos, limites.empty() ? 0 : limites.back());
+    arbol.assign(nodos + 1, 0);
+    size_t siguiente = 0;
+    llenarEytzinger(completados, siguiente, arbol, 1);
+}
+
+/**
+ * Baja DESENROLLADO claves a la vez, nivel por nivel; la comparación se suma al índice en vez de elegir una rama
+ */
+void ClasificadorParticiones::clasificarEscalar(const int64_t* claves, size_t n, uint32_t* salida) const {
+    const int64_t* nodos = arbol.data();
+    const size_t hojas = size_t(1) << niveles;
+    const size_t k = cantidad_limites;
+    size_t i = 0;
+    for (; i + DESENROLLADO <= n; i += DESENROLLADO) {
+        size_t j[DESENROLLADO];
+        for (size_t u = 0; u < DESENROLLADO; u++) {
+            j[u] = 1;
+        }
+        for (size_t h = 0; h < niveles; h++) {
+            for (size_t u = 0; u < DESENROLLADO; u++) {
+                j[u] = 2 * j[u] + (claves[i + u] >= nodos[j[u]]);
+            }
+        }
+        for (size_t u = 0; u < DESENROLLADO; u++) {
+            size_t rango = j[u] - hojas;
+            salida[i + u] = static_cast<uint32_t>(rango < k ? rango : k);
+        }
+    }
+    for (; i < n; i++) {
+        size_t j = 1;
+        for (size_t h = 0; h < niveles; h++) {
+            j = 2 * j + (claves[i] >= nodos[j]);
+        }
+        size_t rango = j - hojas;
+        salida[i] = static_cast<uint32_t>(rango < k ? rango : k);
+    }
+}
+
+#ifdef CLASIFICADOR_X86
+
+/**
+ * Dos vectores de 4 claves por iteración. AVX2 solo compara mayor que: clave >= nodo es lo contrario de
+ * nodo > clave, y esa comparación vale -1, así el hijo es 2j + 1 + (nodo > clave)
+ * @return claves clasificadas, el resto queda para la versión escalar
+ */
+__attribute__((target("avx2")))
+static size_t clasificarAVX2(const int64_t* nodos, size_t niveles, size_t k, const int64_t* claves, size_t n,
+                             uint32_t* salida) {
+    const long long* base = reinterpret_cast<const long long*>(nodos);
+    const __m256i uno = _mm256_set1_epi64x(1);
+    const size_t hojas = size_t(1) << niveles;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(claves + i));
+        __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(claves + i + 4));
+        __m256i j0 = uno;
+        __m256i j1 = uno;
+        for (size_t h = 0; h < niveles; h++) {
+            __m256i s0 = _mm256_i64gather_epi64(base, j0, 8);
+            __m256i s1 = _mm256_i64gather_epi64(base, j1, 8);
+            j0 = _mm256_add_epi64(_mm256_add_epi64(_mm256_slli_epi64(j0, 1), uno), _mm256_cmpgt_epi64(s0, c0));
+            j1 = _mm256_add_epi64(_mm256_add_epi64(_mm256_slli_epi64(j1, 1), uno), _mm256_cmpgt_epi64(s1, c1));
+        }
+        alignas(32) uint64_t j[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(j), j0);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(j + 4), j1);
+        for (size_t u = 0; u < 8; u++) {
+            size_t rango = j[u] - hojas;
+            salida[i + u] = static_cast<uint32_t>(rango < k ? rango : k);
+        }
+    }
+    return i;
+}
+
+// GCC 12 avisa falsamente de valores sin inicializar dentro de los intrinsecos de AVX-512 al usarlos
+// en funciones con atributo target
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+/**
+ * Dos vectores de 8 claves por iteración; la comparación da una máscara que suma 1 a los que van a la derecha
+ * @return claves clasificadas, el resto queda para la versión escalar
+ */
+__attribute__((target("avx512f")))
+static size_t clasificarAVX512(const int64_t* nodos, size_t niveles, size_t k, const int64_t* claves, size_t n,
+                               uint32_t* salida) {
+    const __m512i uno = _mm512_set1_epi64(1);
+    const __m512i hojas = _mm512_set1_epi64(static_cast<long long>(size_t(1) << niveles));
+    const __m512i limite = _mm512_set1_epi64(static_cast<long long>(k));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i c0 = _mm512_loadu_si512(claves + i);
+        __m512i c1 = _mm512_loadu_si512(claves + i + 8);
+        __m512i j0 = uno;
+        __m512i j1 = uno;
+        for (size_t h = 0; h < niveles; h++) {
+            __m512i s0 = _mm512_i64gather_epi64(j0, nodos, 8);
+            __m512i s1 = _mm512_i64gather_epi64(j1, nodos, 8);
+            __mmask8 derecha0 = _mm512_cmpge_epi64_mask(c0, s0);
+            __mmask8 derecha1 = _mm512_cmpge_epi64_mask(c1, s1);
+            j0 = _mm512_slli_epi64(j0, 1);
+            j1 = _mm512_slli_epi64(j1, 1);
+            j0 = _mm512_mask_add_epi64(j0, derecha0, j0, uno);
+            j1 = _mm512_mask_add_epi64(j1, derecha1, j1, uno);
+        }
+        __m512i r0 = _mm512_min_epi64(_mm512_sub_epi64(j0, hojas), limite);
+        __m512i r1 = _mm512_min_epi64(_mm512_sub_epi64(j1, hojas), limite);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(salida + i), _mm512_cvtepi64_epi32(r0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(salida + i + 8), _mm512_cvtepi64_epi32(r1));
+    }
+    return i;
+}
+
+#pragma GCC diagnostic pop
+
+#endif // CLASIFICADOR_X86
+
+void ClasificadorParticiones::clasificar(const int64_t* claves, size_t n, uint32_t* salida) const {
+    size_t hechas = 0;
+#ifdef CLASIFICADOR_X86
+    // Con un árbol vacío todas van a la partición 0, no hay nada que vectorizar
+    if (niveles > 0) {
+        if (nivel == NivelSimd::AVX512) {
+            hechas = clasificarAVX512(arbol.data(), niveles, cantidad_limites, claves, n, salida);
+        } else if (nivel == NivelSimd::AVX2) {
+            hechas = clasificarAVX2(arbol.data(), niveles, cantidad_limites, claves, n, salida);
+        }
+    }
+#endif
+    clasificarEscalar(claves + hechas, n - hechas, salida + hechas);
+}
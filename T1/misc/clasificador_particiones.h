@@ -0,0 +1,52 @@
+#ifndef CLASIFICADOR_PARTICIONES_H
+#define CLASIFICADOR_PARTICIONES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "mezcla_simd.h"
+
+// Claves que se clasifican juntas: el llamador las copia a un arreglo de este largo antes de repartir los registros
+constexpr size_t LOTE_CLASIFICACION = 256;
+
+/**
+ * Clasifica claves en las particiones definidas por límites ordenados sin repetir: la partición i tiene las claves
+ * de [limites[i-1], limites[i]), la 0 las menores que limites[0] y la última las mayores o iguales al último límite.
+ *
+ * Los límites se guardan como un árbol binario implícito en orden de Eytzinger (la raíz en 1 y los hijos de j en
+ * 2j y 2j + 1), completado hasta 2^h - 1 nodos repitiendo el último límite. Cada clave baja h niveles con
+ * j = 2j + (clave >= arbol[j]), sin saltos que dependan de la clave; al final j - 2^h cuenta los límites menores o
+ * iguales a la clave y, acotado a los límites reales, es la partición. Varias claves bajan a la vez, nivel por
+ * nivel, para que sus lecturas del árbol se solapen en vez de esperarse una a otra
+ */
+class ClasificadorParticiones {
+public:
+    /**
+     * @param limites límites ordenados sin repetir, puede estar vacío
+     * @param nivel instrucciones a usar, debe estar soportado por la CPU
+     */
+    explicit ClasificadorParticiones(const std::vector<int64_t>& limites, NivelSimd nivel = nivelSimdDisponible());
+
+    /**
+     * @return cantidad de particiones, una más que los límites
+     */
+    size_t particiones() const { return cantidad_limites + 1; }
+
+    /**
+     * Clasifica 'n' claves; con AVX2 o AVX-512 se recorre el árbol con gathers de 4 u 8 claves por vector
+     * @param claves claves a clasificar
+     * @param n cantidad de claves
+     * @param salida recibe la partición de cada clave
+     */
+    void clasificar(const int64_t* claves, size_t n, uint32_t* salida) const;
+
+private:
+    std::vector<int64_t> arbol; // Límites en orden de Eytzinger desde la posición 1
+    size_t niveles;             // Altura h del árbol
+    size_t cantidad_limites;    // Límites reales, sin el relleno
+    NivelSimd nivel;
+
+    void clasificarEscalar(const int64_t* claves, size_t n, uint32_t* salida) const;
+};
+
+#endif // CLASIFICADOR_PARTICIONES_H
@@ -0,0 +1,131 @@
+#include "compresion_runs.h"
+#include <algorithm>
+#include <cstring>
+
+/**
+ * Cabecera de un marco, ocupa BYTES_CABECERA_MARCO bytes
+ */
+struct CabeceraMarco {
+    uint32_t cantidad; // Valores del marco, incluyendo el primero
+    uint32_t bits;     // Ancho de cada diferencia, de 0 a 64
+    int64_t base;      // Primer valor
+};
+static_assert(sizeof(CabeceraMarco) == BYTES_CABECERA_MARCO, "la cabecera del marco debe medir 16 bytes");
+
+/**
+ * @return bits necesarios para representar 'x', 0 si x es 0
+ */
+static unsigned anchoBits(uint64_t x) {
+    return (x == 0) ? 0 : 64 - static_cast<unsigned>(__builtin_clzll(x));
+}
+
+size_t comprimirMarco(const int64_t* valores, size_t n, unsigned char* bloque, size_t B) {
+    // Mayor prefijo de valores cuyas diferencias, con el ancho de la mayor de ellas, caben en el bloque
+    const size_t bits_disponibles = (B - BYTES_CABECERA_MARCO) * 8;
+    const size_t limite = std::min(n, maxElementosPorMarco(B));
+    unsigned bits = 0;
+    size_t cantidad = 1;
+    while (cantidad < limite) {
+        uint64_t diferencia = static_cast<uint64_t>(valores[cantidad]) - static_cast<uint64_t>(valores[cantidad - 1]);
+        unsigned ancho = std::max(bits, anchoBits(diferencia));
+        if (cantidad * ancho > bits_disponibles) break;
+        bits = ancho;
+        cantidad++;
+    }
+
+    CabeceraMarco cabecera{static_cast<uint32_t>(cantidad), bits, valores[0]};
+    memcpy(bloque, &cabecera, sizeof(cabecera));
+
+    // Empaquetar las diferencias de a palabras de 64 bits
+    unsigned char* destino = bloque + BYTES_CABECERA_MARCO;
+    uint64_t acumulado = 0;
+    unsigned ocupados = 0;
+    if (bits > 0) {
+        for (size_t i = 1; i < cantidad; i++) {
+            uint64_t diferencia = static_cast<uint64_t>(valores[i]) - static_cast<uint64_t>(valores[i - 1]);
+            acumulado |= diferencia << ocupados;
+            if (ocupados + bits >= 64) {
+                memcpy(destino, &acumulado, sizeof(acumulado));
+                destino += sizeof(acumulado);
+                unsigned sobran = ocupados + bits - 64; // Bits altos de la diferencia que no entraron
+                acumulado = (sobran > 0) ? diferencia >> (bits - sobran) : 0;
+                ocupados = sobran;
+            } else {
+                ocupados += bits;
+            }
+        }
+    }
+    size_t bytes_cola = (ocupados + 7) / 8;
+    memcpy(destino, &acumulado, bytes_cola);
+    destino += bytes_cola;
+    memset(destino, 0, B - static_cast<size_t>(destino - bloque));
+    return cantidad;
+}
+
+size_t descomprimirMarco(const unsigned char* bloque, int64_t* destino) {
+    CabeceraMarco cabecera;
+    memcpy(&cabecera, bloque, sizeof(cabecera));
+    const unsigned bits = cabecera.bits;
+    const uint64_t mascara = (bits == 64) ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+
+    const unsigned char* origen = bloque + BYTES_CABECERA_MARCO;
+    uint64_t valor = static_cast<uint64_t>(cabecera.base);
+    uint64_t acumulado = 0;
+    unsigned en_acumulado = 0; // Bits sin consumir de 'acumulado'
+    destino[0] = cabecera.base;
+    for (size_t i = 1; i < cabecera.cantidad; i++) {
+        uint64_t diferencia;
+        if (bits == 0) {
+            diferencia = 0;
+        } else if (en_acumulado >= bits) {
+            diferencia = acumulado & mascara;
+            acumulado = (bits == 64) ? 0 : acumulado >> bits;
+            en_acumulado -= bits;
+        } else {
+            // La diferencia sigue en la siguiente palabra
+            uint64_t palabra;
+            memcpy(&palabra, origen, sizeof(palabra));
+            origen += sizeof(palabra);
+            diferencia = (acumulado | (palabra << en_acumulado)) & mascara;
+            unsigned usados = bits - en_acumulado;
+            acumulado = (usados == 64) ? 0 : palabra >> usados;
+            en_acumulado = 64 - usados;
+        }
+        valor += diferencia;
+        destino[i] = static_cast<int64_t>(valor);
+    }
+    return cabecera.cantidad;
+}
+
+EscritorComprimido::EscritorComprimido(ArchivoBloques& archivo, size_t B, std::atomic<int>& contador)
+    : archivo(archivo), B(B), contadorIO(contador), bloque(B) {}
+
+/**
+ * Escribe los marcos llenos que se puedan formar con los valores pendientes, y con 'final' tambien el ultimo
+ */
+void EscritorComprimido::escribirMarcos(bool final) {
+    size_t usados = 0;
+    while (usados < pendientes.size()) {
+        size_t restantes = pendientes.size() - usados;
+        // Sin una ventana completa el marco podria no quedar lleno, salvo al terminar
+        if (!final && restantes < maxElementosPorMarco(B)) break;
+        usados += comprimirMarco(pendientes.data() + usados, restantes, bloque.data(), B);
+        size_t escritos = archivo.escribir(bloque.data(), B, offset);
+        error = error || escritos != B;
+        offset += escritos;
+        suma.agregar(bloque.data(), B);
+        contadorIO++;
+    }
+    pendientes.erase(pendientes.begin(), pendientes.begin() + usados);
+}
+
+void EscritorComprimido::agregar(const int64_t* valores, size_t n) {
+    pendientes.insert(pendientes.end(), valores, valores + n);
+    if (pendientes.size() >= 2 * maxElementosPorMarco(B)) {
+        escribirMarcos(false);
+    }
+}
+
+void EscritorComprimido::terminar() {
+    escribirMarcos(true);
+}
@@ -0,0 +1,98 @@
+#ifndef COMPRESION_RUNS_H
+#define COMPRESION_RUNS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "dispositivo_bloques.h"
+#include "manifiesto.h"
+
+/**
+ * Formato comprimido de los runs de int64_t. Cada bloque de B bytes es un marco que se decodifica por si solo:
+ * una cabecera con la cantidad de valores, el ancho en bits de las diferencias y el primer valor, seguida de las
+ * diferencias entre valores consecutivos empaquetadas con ese ancho. En un run ordenado las diferencias son
+ * pequeñas, por lo que un bloque guarda varias veces los B/8 valores que cabrian sin comprimir. Un marco guarda a
+ * lo mas 8 * B/8 valores, asi el marco descomprimido ocupa a lo mas 8 bloques. Los marcos requieren B multiplo de 8.
+ */
+
+/**
+ * Bytes de la cabecera de cada marco
+ */
+constexpr size_t BYTES_CABECERA_MARCO = 16;
+
+/**
+ * @return mayor cantidad de valores de un marco de B bytes
+ */
+inline size_t maxElementosPorMarco(size_t B) {
+    return 8 * (B / sizeof(int64_t));
+}
+
+/**
+ * @return menor cantidad de valores de un marco lleno de B bytes, con diferencias de 64 bits
+ */
+inline size_t minElementosPorMarco(size_t B) {
+    return (B - BYTES_CABECERA_MARCO) / sizeof(int64_t) + 1;
+}
+
+/**
+ * Comprime en un marco tantos valores del comienzo de 'valores' como quepan en B bytes. Los bytes que sobran
+ * del bloque se rellenan con ceros
+ * @param valores valores a comprimir, en orden ascendente para que las diferencias sean pequeñas
+ * @param n cantidad de valores disponibles, al menos 1
+ * @param bloque destino de B bytes
+ * @param B tamaño de bloque en bytes
+ * @return cantidad de valores guardados en el marco; si es menor a 'n' el marco quedo lleno
+ */
+size_t comprimirMarco(const int64_t* valores, size_t n, unsigned char* bloque, size_t B);
+
+/**
+ * Descomprime un marco
+ * @param bloque marco de B bytes
+ * @param destino arreglo de al menos maxElementosPorMarco(B) valores
+ * @return cantidad de valores del marco
+ */
+size_t descomprimirMarco(const unsigned char* bloque, int64_t* destino);
+
+/**
+ * Escritor secuencial de un run comprimido. Acumula los valores que recibe y escribe cada marco apenas se
+ * llena, un bloque por escritura; al terminar escribe el ultimo marco aunque no este lleno
+ */
+class EscritorComprimido {
+private:
+    ArchivoBloques& archivo;
+    size_t B;
+    std::atomic<int>& contadorIO;
+    std::vector<int64_t> pendientes;    // Valores que todavia no completan un marco
+    std::vector<unsigned char> bloque;  // Marco que se esta escribiendo
+    uint64_t offset = 0;                // Byte del archivo donde va el próximo marco
+    SumaVerificacion suma;              // Suma de los marcos escritos
+    bool error = false;                 // Alguna escritura quedo incompleta
+
+    void escribirMarcos(bool final);
+
+public:
+    EscritorComprimido(ArchivoBloques& archivo, size_t B, std::atomic<int>& contador);
+
+    /**
+     * Agrega valores al run, deben venir en orden ascendente
+     */
+    void agregar(const int64_t* valores, size_t n);
+
+    /**
+     * Escribe los valores pendientes
+     */
+    void terminar();
+
+    /**
+     * @return suma de verificacion de los bytes escritos
+     */
+    uint64_t obtenerSuma() const { return suma.valor(); }
+
+    /**
+     * @return true si alguna escritura de un marco quedo incompleta
+     */
+    bool fallo() const { return error; }
+};
+
+#endif // COMPRESION_RUNS_H
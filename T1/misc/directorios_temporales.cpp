@@ -0,0 +1,74 @@
+#include "directorios_temporales.h"
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+void DirectoriosTemporales::configurar(const std::vector<std::string>& directorios, PoliticaTemporales politica) {
+    this->directorios.clear();
+    for (const auto& directorio : directorios) {
+        struct stat info;
+        if (stat(directorio.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+            std::cerr << "Aviso: se ignora el directorio de temporales " << directorio << std::endl;
+            continue;
+        }
+        this->directorios.push_back(directorio);
+    }
+    this->politica = politica;
+    siguiente = 0;
+}
+
+/**
+ * Elige el directorio del siguiente temporal segun la politica. Con EspacioLibre los empates se resuelven por turnos
+ */
+std::string DirectoriosTemporales::elegirDirectorio() {
+    size_t turno = siguiente++ % directorios.size();
+    if (politica == PoliticaTemporales::Rotacion) return directorios[turno];
+
+    size_t elegido = turno;
+    unsigned long long mayor = 0;
+    for (size_t k = 0; k < directorios.size(); k++) {
+        size_t i = (turno + k) % directorios.size();
+        struct statvfs info;
+        if (statvfs(directorios[i].c_str(), &info) != 0) continue;
+        unsigned long long libres = static_cast<unsigned long long>(info.f_bavail) * info.f_frsize;
+        if (libres > mayor) {
+            mayor = libres;
+            elegido = i;
+        }
+    }
+    return directorios[elegido];
+}
+
+/**
+ * Prefijo de los temporales de un ordenamiento: el nombre del archivo de salida y un hash FNV-1a de su ruta
+ * absoluta, que distingue salidas con el mismo nombre en directorios distintos
+ */
+static std::string prefijoTemporales(const std::string& archivo_salida) {
+    size_t barra = archivo_salida.find_last_of('/');
+    std::string directorio = (barra == std::string::npos) ? "." : archivo_salida.substr(0, barra + 1);
+    std::string nombre = (barra == std::string::npos) ? archivo_salida : archivo_salida.substr(barra + 1);
+
+    char absoluto[PATH_MAX];
+    std::string ruta = (realpath(directorio.c_str(), absoluto) ? std::string(absoluto) : directorio) + "/" + nombre;
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (unsigned char c : ruta) {
+        hash ^= c;
+        hash *= 0x100000001B3ULL;
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return nombre + "." + hex;
+}
+
+std::string DirectoriosTemporales::ruta(const std::string& archivo_salida, const std::string& sufijo, Manifiesto* manifiesto) {
+    if (directorios.empty()) return archivo_salida + sufijo;
+
+    std::string nombre = prefijoTemporales(archivo_salida) + sufijo;
+    std::string previa;
+    if (manifiesto && manifiesto->ubicacionPrevia(nombre, previa)) return previa;
+    return elegirDirectorio() + "/" + nombre;
+}
@@ -0,0 +1,58 @@
+#ifndef DIRECTORIOS_TEMPORALES_H
+#define DIRECTORIOS_TEMPORALES_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "manifiesto.h"
+
+/**
+ * Forma de elegir el directorio de cada archivo temporal
+ */
+enum class PoliticaTemporales {
+    Rotacion,    // Los temporales se reparten por turnos entre los directorios
+    EspacioLibre // Cada temporal va al directorio con mas espacio libre en ese momento
+};
+
+/**
+ * Reparto de los archivos temporales (runs, mezclas intermedias y particiones) entre varios directorios, idealmente
+ * cada uno en un disco distinto. Como los runs consecutivos quedan en discos distintos, las lecturas en paralelo de
+ * una mezcla (precarga asincrona, mezcla final particionada) suman el ancho de banda de todos los discos.
+ * Sin directorios configurados los temporales quedan junto al archivo de salida, como antes.
+ * Los nombres llevan un prefijo derivado de la ruta absoluta del archivo de salida, asi dos ordenamientos simultaneos
+ * con distinta salida nunca comparten temporales aunque usen los mismos directorios. Es seguro usarlo desde varios hilos.
+ */
+class DirectoriosTemporales {
+private:
+    std::vector<std::string> directorios;
+    PoliticaTemporales politica = PoliticaTemporales::Rotacion;
+    std::atomic<size_t> siguiente{0}; // Turno de la rotacion
+
+    std::string elegirDirectorio();
+
+public:
+    /**
+     * Cambia los directorios de los temporales. Los que no existen o no son directorios se descartan con un aviso
+     * @param directorios directorios a usar; vacio para dejar los temporales junto al archivo de salida
+     * @param politica forma de elegir el directorio de cada temporal
+     */
+    void configurar(const std::vector<std::string>& directorios, PoliticaTemporales politica);
+
+    /**
+     * @return cantidad de directorios configurados
+     */
+    size_t cantidad() const { return directorios.size(); }
+
+    /**
+     * Ruta de un archivo temporal nuevo de un ordenamiento
+     * @param archivo_salida archivo de salida del ordenamiento
+     * @param sufijo parte del nombre que distingue al temporal dentro del ordenamiento, por ejemplo ".sorted_3"
+     * @param manifiesto si un paso registrado ya ubico un temporal con el mismo nombre se reutiliza su ruta, asi un
+     * ordenamiento retomado encuentra sus temporales aunque la politica hoy eligiera otro directorio
+     * @return ruta del temporal
+     */
+    std::string ruta(const std::string& archivo_salida, const std::string& sufijo, Manifiesto* manifiesto = nullptr);
+};
+
+#endif // DIRECTORIOS_TEMPORALES_H
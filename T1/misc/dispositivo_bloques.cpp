@@ -0,0 +1,309 @@
+#include "dispositivo_bloques.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Completa una lectura o escritura posicional, que el kernel puede entregar por partes
+ * @return bytes transferidos; en lectura, menos que 'bytes' si se llego al fin del archivo
+ */
+static size_t transferirPosicional(int fd, char* buffer, size_t bytes, uint64_t offset, bool escritura) {
+    size_t hechos = 0;
+    while (hechos < bytes) {
+        ssize_t r = escritura ? pwrite(fd, buffer + hechos, bytes - hechos, offset + hechos)
+                              : pread(fd, buffer + hechos, bytes - hechos, offset + hechos);
+        if (r <= 0) break;
+        hechos += static_cast<size_t>(r);
+    }
+    return hechos;
+}
+
+static int flagsApertura(ModoApertura modo) {
+    switch (modo) {
+        case ModoApertura::Lectura:       return O_RDONLY;
+        case ModoApertura::Actualizacion: return O_WRONLY;
+        default:                          return O_WRONLY | O_CREAT | O_TRUNC;
+    }
+}
+
+/**
+ * stdio: solo se reposiciona cuando la transferencia no continua donde termino la anterior
+ */
+class ArchivoStdio : public ArchivoBloques {
+private:
+    FILE* archivo;
+    uint64_t posicion = 0;
+
+public:
+    explicit ArchivoStdio(FILE* f) : archivo(f) {}
+    ~ArchivoStdio() override { fclose(archivo); }
+
+    size_t leer(void* destino, size_t bytes, uint64_t offset) override {
+        if (offset != posicion) fseek(archivo, static_cast<long>(offset), SEEK_SET);
+        size_t leidos = fread(destino, 1, bytes, archivo);
+        posicion = offset + leidos;
+        return leidos;
+    }
+
+    size_t escribir(const void* origen, size_t bytes, uint64_t offset) override {
+        if (offset != posicion) fseek(archivo, static_cast<long>(offset), SEEK_SET);
+        size_t escritos = fwrite(origen, 1, bytes, archivo);
+        posicion = offset + escritos;
+        return escritos;
+    }
+
+    uint64_t tamano() override {
+        fflush(archivo);
+        struct stat info;
+        return (fstat(fileno(archivo), &info) == 0) ? static_cast<uint64_t>(info.st_size) : 0;
+    }
+};
+
+/**
+ * pread/pwrite sobre el descriptor
+ */
+class ArchivoPosicional : public ArchivoBloques {
+private:
+    int fd;
+
+public:
+    explicit ArchivoPosicional(int descriptor) : fd(descriptor) {}
+    ~ArchivoPosicional() override { close(fd); }
+
+    size_t leer(void* destino, size_t bytes, uint64_t offset) override {
+        return transferirPosicional(fd, static_cast<char*>(destino), bytes, offset, false);
+    }
+
+    size_t escribir(const void* origen, size_t bytes, uint64_t offset) override {
+        return transferirPosicional(fd, const_cast<char*>(static_cast<const char*>(origen)), bytes, offset, true);
+    }
+
+    uint64_t tamano() override {
+        struct stat info;
+        return (fstat(fd, &info) == 0) ? static_cast<uint64_t>(info.st_size) : 0;
+    }
+
+    int descriptorLectura(uint64_t, size_t, const void*) override { return fd; }
+    int descriptorEscritura(uint64_t, size_t, const void*) override { return fd; }
+};
+
+/**
+ * mmap: en lectura se proyecta el archivo completo al abrirlo. En escritura la proyeccion crece al doble
+ * cuando una escritura pasa de su capacidad, y al cerrar el archivo se recorta al tamaño escrito. En actualizacion
+ * se proyecta el archivo completo para escribir y el tamaño de partida es el del archivo
+ */
+class ArchivoMmap : public ArchivoBloques {
+private:
+    int fd;
+    bool escritura;
+    char* mapa = nullptr;
+    uint64_t capacidad = 0; // Bytes proyectados
+    uint64_t logico = 0;    // Tamaño visible del archivo
+
+    bool proyectar(uint64_t bytes) {
+        if (mapa) munmap(mapa, capacidad);
+        mapa = nullptr;
+        capacidad = 0;
+        if (bytes == 0) return true;
+        void* p = mmap(nullptr, bytes, escritura ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) return false;
+        mapa = static_cast<char*>(p);
+        capacidad = bytes;
+        madvise(mapa, capacidad, MADV_SEQUENTIAL);
+        return true;
+    }
+
+public:
+    ArchivoMmap(int descriptor, ModoApertura modo) : fd(descriptor), escritura(modo != ModoApertura::Lectura) {
+        if (modo != ModoApertura::Escritura) {
+            struct stat info;
+            logico = (fstat(fd, &info) == 0) ? static_cast<uint64_t>(info.st_size) : 0;
+            proyectar(logico);
+        }
+    }
+
+    ~ArchivoMmap() override {
+        if (mapa) munmap(mapa, capacidad);
+        if (escritura && ftruncate(fd, static_cast<off_t>(logico)) != 0) {
+            perror("ftruncate");
+        }
+        close(fd);
+    }
+
+    size_t leer(void* destino, size_t bytes, uint64_t offset) override {
+        if (offset >= logico || !mapa) return 0;
+        size_t cantidad = static_cast<size_t>(std::min<uint64_t>(bytes, logico - offset));
+        memcpy(destino, mapa + offset, cantidad);
+        return cantidad;
+    }
+
+    size_t escribir(const void* origen, size_t bytes, uint64_t offset) override {
+        uint64_t fin = offset + bytes;
+        if (fin > capacidad) {
+            uint64_t pagina = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+            uint64_t nueva = std::max<uint64_t>(fin, 2 * capacidad);
+            nueva = (nueva + pagina - 1) / pagina * pagina;
+            if (ftruncate(fd, static_cast<off_t>(nueva)) != 0 || !proyectar(nueva)) return 0;
+        }
+        memcpy(mapa + offset, origen, bytes);
+        logico = std::max(logico, fin);
+        return bytes;
+    }
+
+    uint64_t tamano() override { return logico; }
+};
+
+/**
+ * O_DIRECT: las transferencias con offset, largo y buffer alineados van directo al disco. Un largo no alineado
+ * se completa con un buffer alineado propio; un offset no alineado (solo ocurre despues de una cola parcial) usa un
+ * segundo descriptor sin O_DIRECT. Las escrituras se rellenan hasta el alineamiento y al cerrar se recorta el archivo.
+ * En actualizacion no se rellena, porque pisaria lo que otro escritor dejo despues: una escritura no alineada usa
+ * el segundo descriptor, y al cerrar el archivo no se recorta
+ */
+class ArchivoDirecto : public ArchivoBloques {
+private:
+    static const size_t ALINEAMIENTO = ALINEAMIENTO_DIRECTO;
+    int fd_directo;
+    int fd_normal;
+    bool escritura;
+    bool rellenar;              // Indica si las escrituras no alineadas se pueden rellenar hasta el alineamiento
+    uint64_t logico = 0;
+    char* rebote = nullptr;     // Buffer alineado para transferencias que no lo estan
+    size_t capacidad_rebote = 0;
+
+    static bool alineado(uint64_t x) { return x % ALINEAMIENTO == 0; }
+    static uint64_t redondear(uint64_t x) { return (x + ALINEAMIENTO - 1) / ALINEAMIENTO * ALINEAMIENTO; }
+
+    char* bufferRebote(size_t bytes) {
+        if (bytes > capacidad_rebote) {
+            free(rebote);
+            rebote = static_cast<char*>(aligned_alloc(ALINEAMIENTO, bytes));
+            capacidad_rebote = rebote ? bytes : 0;
+        }
+        return rebote;
+    }
+
+public:
+    ArchivoDirecto(int directo, int normal, ModoApertura modo)
+        : fd_directo(directo), fd_normal(normal), escritura(modo == ModoApertura::Escritura),
+          rellenar(modo == ModoApertura::Escritura) {
+        if (modo != ModoApertura::Escritura) {
+            struct stat info;
+            logico = (fstat(fd_normal, &info) == 0) ? static_cast<uint64_t>(info.st_size) : 0;
+        }
+    }
+
+    ~ArchivoDirecto() override {
+        if (escritura && ftruncate(fd_normal, static_cast<off_t>(logico)) != 0) {
+            perror("ftruncate");
+        }
+        free(rebote);
+        close(fd_directo);
+        close(fd_normal);
+    }
+
+    size_t leer(void* destino, size_t bytes, uint64_t offset) override {
+        if (offset >= logico) return 0;
+        bytes = static_cast<size_t>(std::min<uint64_t>(bytes, logico - offset));
+        if (!alineado(offset)) {
+            return transferirPosicional(fd_normal, static_cast<char*>(destino), bytes, offset, false);
+        }
+        if (alineado(bytes) && alineado(reinterpret_cast<uintptr_t>(destino))) {
+            return transferirPosicional(fd_directo, static_cast<char*>(destino), bytes, offset, false);
+        }
+        size_t largo = static_cast<size_t>(redondear(bytes));
+        char* buffer = bufferRebote(largo);
+        if (!buffer) return transferirPosicional(fd_normal, static_cast<char*>(destino), bytes, offset, false);
+        size_t leidos = std::min(transferirPosicional(fd_directo, buffer, largo, offset, false), bytes);
+        memcpy(destino, buffer, leidos);
+        return leidos;
+    }
+
+    size_t escribir(const void* origen, size_t bytes, uint64_t offset) override {
+        size_t escritos;
+        if (!alineado(offset) || (!rellenar && !alineado(bytes))) {
+            escritos = transferirPosicional(fd_normal, const_cast<char*>(static_cast<const char*>(origen)), bytes, offset, true);
+        } else if (alineado(bytes) && alineado(reinterpret_cast<uintptr_t>(origen))) {
+            escritos = transferirPosicional(fd_directo, const_cast<char*>(static_cast<const char*>(origen)), bytes, offset, true);
+        } else {
+            size_t largo = static_cast<size_t>(redondear(bytes));
+            char* buffer = bufferRebote(largo);
+            if (!buffer) {
+                escritos = transferirPosicional(fd_normal, const_cast<char*>(static_cast<const char*>(origen)), bytes, offset, true);
+            } else {
+                memcpy(buffer, origen, bytes);
+                memset(buffer + bytes, 0, largo - bytes);
+                escritos = std::min(transferirPosicional(fd_directo, buffer, largo, offset, true), bytes);
+            }
+        }
+        logico = std::max<uint64_t>(logico, offset + escritos);
+        return escritos;
+    }
+
+    uint64_t tamano() override { return logico; }
+
+    // Solo lo alineado va al descriptor directo: una transferencia pedida desde afuera no se puede rellenar con el
+    // buffer de rebote, asi que el resto, en la practica la cola del archivo, pasa por el descriptor normal
+    int descriptorLectura(uint64_t offset, size_t bytes, const void* destino) override {
+        bool directa = alineado(offset) && alineado(bytes) && alineado(reinterpret_cast<uintptr_t>(destino));
+        return directa ? fd_directo : fd_normal;
+    }
+
+    int descriptorEscritura(uint64_t offset, size_t bytes, const void* origen) override {
+        logico = std::max<uint64_t>(logico, offset + bytes);
+        return descriptorLectura(offset, bytes, origen);
+    }
+};
+
+std::unique_ptr<ArchivoBloques> abrirArchivoBloques(TipoDispositivo tipo, const std::string& nombre, ModoApertura modo) {
+    if (tipo == TipoDispositivo::Stdio) {
+        const char* modo_stdio = (modo == ModoApertura::Lectura) ? "rb" : (modo == ModoApertura::Actualizacion) ? "r+b" : "wb";
+        FILE* f = fopen(nombre.c_str(), modo_stdio);
+        if (!f) return nullptr;
+        return std::unique_ptr<ArchivoBloques>(new ArchivoStdio(f));
+    }
+
+    int flags = flagsApertura(modo);
+    if (tipo == TipoDispositivo::Mmap) {
+        // Proyectar para escritura requiere poder leer el archivo
+        if (modo == ModoApertura::Escritura) flags = O_RDWR | O_CREAT | O_TRUNC;
+        if (modo == ModoApertura::Actualizacion) flags = O_RDWR;
+        int fd = open(nombre.c_str(), flags, 0644);
+        if (fd < 0) return nullptr;
+        return std::unique_ptr<ArchivoBloques>(new ArchivoMmap(fd, modo));
+    }
+
+    int fd = open(nombre.c_str(), flags, 0644);
+    if (fd < 0) return nullptr;
+    if (tipo == TipoDispositivo::Directo) {
+        // El descriptor directo se abre despues, sin O_TRUNC para no truncar dos veces
+        int fd_directo = open(nombre.c_str(), (flags & ~(O_CREAT | O_TRUNC)) | O_DIRECT);
+        if (fd_directo >= 0) {
+            return std::unique_ptr<ArchivoBloques>(new ArchivoDirecto(fd_directo, fd, modo));
+        }
+    }
+    return std::unique_ptr<ArchivoBloques>(new ArchivoPosicional(fd));
+}
+
+bool reservarArchivo(const std::string& nombre, uint64_t bytes) {
+    int fd = open(nombre.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = (bytes == 0) || fallocate(fd, 0, 0, static_cast<off_t>(bytes)) == 0 ||
+              ftruncate(fd, static_cast<off_t>(bytes)) == 0;
+    close(fd);
+    return ok;
+}
+
+const char* nombreDispositivo(TipoDispositivo tipo) {
+    switch (tipo) {
+        case TipoDispositivo::Stdio:   return "stdio";
+        case TipoDispositivo::Mmap:    return "mmap";
+        case TipoDispositivo::Directo: return "O_DIRECT";
+        default:                       return "pread/pwrite";
+    }
+}
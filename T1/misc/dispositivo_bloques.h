@@ -0,0 +1,142 @@
+#ifndef DISPOSITIVO_BLOQUES_H
+#define DISPOSITIVO_BLOQUES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+
+/**
+ * Formas de transferir bloques entre un archivo y la memoria
+ */
+enum class TipoDispositivo {
+    Stdio,      // fseek + fread/fwrite, con el buffer de stdio entre el programa y el cache de paginas
+    Posicional, // pread/pwrite directo sobre el descriptor, sin buffer de stdio
+    Mmap,       // El archivo se proyecta en memoria y cada transferencia es una copia
+    Directo     // O_DIRECT con buffers alineados, sin pasar por el cache de paginas
+};
+
+// Alineamiento que O_DIRECT exige al offset, al largo y a la direccion del buffer de cada transferencia
+constexpr size_t ALINEAMIENTO_DIRECTO = 4096;
+
+/**
+ * Modo en que se abre un archivo
+ */
+enum class ModoApertura {
+    Lectura,      // El archivo debe existir
+    Escritura,    // Se crea o se trunca
+    Actualizacion // El archivo debe existir; se escribe en su lugar, sin truncarlo al abrir ni recortarlo al cerrar,
+                  // asi varios escritores pueden llenar zonas disjuntas de un archivo reservado con reservarArchivo
+};
+
+/**
+ * Archivo abierto sobre el que se leen y escriben bloques en posiciones arbitrarias. Las transferencias
+ * se completan enteras salvo al llegar al fin del archivo. Al destruirse se cierra el archivo.
+ */
+class ArchivoBloques {
+public:
+    virtual ~ArchivoBloques() = default;
+
+    /**
+     * Lee hasta 'bytes' bytes desde 'offset' hacia 'destino'
+     * @return bytes leidos, menos que 'bytes' solo al llegar al fin del archivo o con error
+     */
+    virtual size_t leer(void* destino, size_t bytes, uint64_t offset) = 0;
+
+    /**
+     * Escribe 'bytes' bytes desde 'origen' en la posicion 'offset'
+     * @return bytes escritos
+     */
+    virtual size_t escribir(const void* origen, size_t bytes, uint64_t offset) = 0;
+
+    /**
+     * @return tamaño del archivo en bytes, contando lo escrito hasta ahora
+     */
+    virtual uint64_t tamano() = 0;
+
+    /**
+     * Descriptor sobre el que una lectura con estos parametros se puede pedir con pread, por ejemplo a un MotorIO,
+     * con el mismo efecto que leer(). Con O_DIRECT es el descriptor directo si todo esta alineado, si no el normal
+     * @return descriptor, o -1 si el dispositivo no trabaja sobre un descriptor y hay que usar leer()
+     */
+    virtual int descriptorLectura(uint64_t offset, size_t bytes, const void* destino) {
+        (void)offset; (void)bytes; (void)destino;
+        return -1;
+    }
+
+    /**
+     * Igual que descriptorLectura para una escritura con pwrite. Si entrega un descriptor, la escritura ya cuenta
+     * en el tamaño del archivo
+     * @return descriptor, o -1 si hay que usar escribir()
+     */
+    virtual int descriptorEscritura(uint64_t offset, size_t bytes, const void* origen) {
+        (void)offset; (void)bytes; (void)origen;
+        return -1;
+    }
+};
+
+/**
+ * Arreglo de registros alineado a ALINEAMIENTO_DIRECTO, para que las transferencias desde y hacia el puedan ir
+ * directo al disco. Solo para tipos triviales: resize no conserva el contenido ni inicializa
+ */
+template <typename T>
+class BufferAlineado {
+private:
+    T* datos = nullptr;
+    size_t cantidad = 0;
+
+public:
+    BufferAlineado() = default;
+    explicit BufferAlineado(size_t n) { resize(n); }
+    BufferAlineado(BufferAlineado&& otro) noexcept
+        : datos(std::exchange(otro.datos, nullptr)), cantidad(std::exchange(otro.cantidad, 0)) {}
+    BufferAlineado& operator=(BufferAlineado&& otro) noexcept {
+        std::swap(datos, otro.datos);
+        std::swap(cantidad, otro.cantidad);
+        return *this;
+    }
+    BufferAlineado(const BufferAlineado&) = delete;
+    BufferAlineado& operator=(const BufferAlineado&) = delete;
+    ~BufferAlineado() { free(datos); }
+
+    void resize(size_t n) {
+        free(datos);
+        // aligned_alloc pide un largo multiplo del alineamiento
+        size_t bytes = (n * sizeof(T) + ALINEAMIENTO_DIRECTO - 1) / ALINEAMIENTO_DIRECTO * ALINEAMIENTO_DIRECTO;
+        datos = (bytes > 0) ? static_cast<T*>(aligned_alloc(ALINEAMIENTO_DIRECTO, bytes)) : nullptr;
+        cantidad = datos ? n : 0;
+    }
+
+    T* data() { return datos; }
+    const T* data() const { return datos; }
+    size_t size() const { return cantidad; }
+    T& operator[](size_t i) { return datos[i]; }
+    const T& operator[](size_t i) const { return datos[i]; }
+};
+
+/**
+ * Abre un archivo con el dispositivo pedido. Si el sistema de archivos no acepta O_DIRECT se abre como Posicional
+ * @param tipo dispositivo con que se hacen las transferencias
+ * @param nombre ruta del archivo
+ * @param modo lectura, escritura creando o truncando el archivo, o actualizacion de un archivo existente
+ * @return archivo abierto, o nullptr si no se pudo abrir
+ */
+std::unique_ptr<ArchivoBloques> abrirArchivoBloques(TipoDispositivo tipo, const std::string& nombre, ModoApertura modo);
+
+/**
+ * Crea o trunca un archivo y le reserva 'bytes' bytes en disco (fallocate; si el sistema de archivos no lo permite,
+ * solo se fija el tamaño), para escribirlo despues por zonas en modo Actualizacion
+ * @param nombre ruta del archivo
+ * @param bytes tamaño final del archivo
+ * @return false si no se pudo crear o fijar su tamaño
+ */
+bool reservarArchivo(const std::string& nombre, uint64_t bytes);
+
+/**
+ * @return nombre del dispositivo, para reportar en la salida del programa
+ */
+const char* nombreDispositivo(TipoDispositivo tipo);
+
+#endif // DISPOSITIVO_BLOQUES_H
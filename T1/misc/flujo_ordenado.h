@@ -0,0 +1,185 @@
+#ifndef FLUJO_ORDENADO_H
+#define FLUJO_ORDENADO_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "dispositivo_bloques.h"
+#include "plan_buffers.h"
+
+/**
+ * Resultado de un ordenamiento externo que se consume por lotes en vez de escribirse en un archivo de salida.
+ * Los lotes llegan en orden y el ultimo paso del ordenamiento (la mezcla final o la concatenacion de particiones)
+ * avanza a medida que se piden, asi quien consume no necesita un archivo de salida ni una pasada de copia.
+ * Se obtiene con abrirFlujo de cada algoritmo y no debe sobrevivir al ordenador que lo creo. Destruirlo antes de
+ * agotarlo detiene el ordenamiento y borra sus temporales.
+ */
+template <typename T>
+class FlujoOrdenado {
+private:
+    const T* pendiente = nullptr; // Resto del ultimo lote que leer() no alcanzo a copiar
+    size_t en_pendiente = 0;
+
+public:
+    virtual ~FlujoOrdenado() = default;
+
+    /**
+     * Entrega el siguiente lote de registros ordenados. El lote sigue siendo valido hasta la siguiente llamada
+     * @param lote recibe el comienzo del lote
+     * @return cantidad de registros del lote, 0 cuando ya no quedan
+     */
+    virtual size_t siguienteLote(const T*& lote) = 0;
+
+    /**
+     * Copia los siguientes registros ordenados en un buffer propio; no se debe mezclar con siguienteLote
+     * @param destino buffer de al menos 'maximo' registros
+     * @param maximo cantidad maxima de registros a copiar
+     * @return registros copiados, 0 cuando ya no quedan
+     */
+    size_t leer(T* destino, size_t maximo) {
+        size_t copiados = 0;
+        while (copiados < maximo) {
+            if (en_pendiente == 0) {
+                en_pendiente = siguienteLote(pendiente);
+                if (en_pendiente == 0) break;
+            }
+            size_t cantidad = std::min(en_pendiente, maximo - copiados);
+            memcpy(destino + copiados, pendiente, cantidad * sizeof(T));
+            pendiente += cantidad;
+            en_pendiente -= cantidad;
+            copiados += cantidad;
+        }
+        return copiados;
+    }
+};
+
+/**
+ * Flujo de un resultado que cupo completo en memoria, se entrega como un solo lote
+ */
+template <typename T>
+class FlujoMemoria : public FlujoOrdenado<T> {
+private:
+    std::vector<T> datos;
+    bool entregado = false;
+
+public:
+    explicit FlujoMemoria(std::vector<T>&& datos) : datos(std::move(datos)) {}
+
+    size_t siguienteLote(const T*& lote) override {
+        if (entregado || datos.empty()) return 0;
+        entregado = true;
+        lote = datos.data();
+        return datos.size();
+    }
+};
+
+/**
+ * Escribe un flujo completo en un archivo, de a un lote por escritura. Es la forma de obtener un archivo de salida
+ * a partir de un flujo
+ * @param flujo flujo a consumir
+ * @param archivo archivo de salida, se crea o se trunca
+ * @param dispositivo forma de escribir los bloques
+ * @param B tamaño de bloque en bytes, para contar los bloques escritos
+ * @return bloques escritos
+ */
+template <typename T>
+size_t escribirFlujo(FlujoOrdenado<T>& flujo, const std::string& archivo, TipoDispositivo dispositivo, size_t B) {
+    std::unique_ptr<ArchivoBloques> salida = abrirArchivoBloques(dispositivo, archivo, ModoApertura::Escritura);
+    if (!salida) {
+        std::cerr << "Error al abrir archivo de salida: " << archivo << std::endl;
+        return 0;
+    }
+    size_t bloques = 0;
+    uint64_t offset = 0;
+    const T* lote;
+    size_t cantidad;
+    while ((cantidad = flujo.siguienteLote(lote)) > 0) {
+        size_t bytes = salida->escribir(lote, cantidad * sizeof(T), offset);
+        offset += bytes;
+        bloques += bloquesTransferidos(bytes, B);
+    }
+    return bloques;
+}
+
+/**
+ * Entrega de lotes entre un hilo que produce registros ordenados en sus propios buffers y el hilo que consume el
+ * flujo. Hay a lo mas un lote entregado y uno en uso: el productor no recupera un buffer hasta que el consumidor
+ * pide el lote siguiente, por lo que con dos buffers de salida el productor llena uno mientras se consume el otro.
+ */
+template <typename T>
+class CanalLotes {
+private:
+    std::mutex mutex;
+    std::condition_variable cambio;
+    const T* lote = nullptr;
+    size_t cantidad = 0;
+    bool entregado = false;  // Hay un lote esperando al consumidor
+    bool tomado = false;     // El consumidor esta usando un lote
+    bool terminado = false;  // El productor ya no entrega mas lotes
+    bool cancelado = false;  // El consumidor ya no pide mas lotes
+
+public:
+    /**
+     * Entrega un lote, esperando a que el consumidor suelte el anterior. Con 0 registros marca el final y espera
+     * a que el consumidor suelte todos los lotes, asi el productor puede liberar sus buffers al volver
+     * @return false si el consumidor cancelo y no tiene sentido seguir produciendo
+     */
+    bool entregar(const T* datos, size_t n) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cambio.wait(lock, [&]() { return cancelado || (!entregado && !tomado); });
+        if (cancelado) return false;
+        if (n == 0) {
+            terminado = true;
+        } else {
+            lote = datos;
+            cantidad = n;
+            entregado = true;
+        }
+        cambio.notify_all();
+        return true;
+    }
+
+    /**
+     * Marca el final sin esperar, para cuando el productor termina sin haber entregado nada
+     */
+    void terminar() {
+        std::lock_guard<std::mutex> lock(mutex);
+        terminado = true;
+        cambio.notify_all();
+    }
+
+    /**
+     * Suelta el lote en uso y espera el siguiente
+     * @return registros del lote, 0 si el productor termino
+     */
+    size_t recibir(const T*& datos) {
+        std::unique_lock<std::mutex> lock(mutex);
+        tomado = false;
+        cambio.notify_all();
+        cambio.wait(lock, [&]() { return entregado || terminado; });
+        if (!entregado) return 0;
+        entregado = false;
+        tomado = true;
+        datos = lote;
+        return cantidad;
+    }
+
+    /**
+     * Avisa al productor que no se pediran mas lotes
+     */
+    void cancelar() {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelado = true;
+        cambio.notify_all();
+    }
+};
+
+#endif // FLUJO_ORDENADO_H
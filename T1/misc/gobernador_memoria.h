@@ -0,0 +1,97 @@
+#ifndef GOBERNADOR_MEMORIA_H
+#define GOBERNADOR_MEMORIA_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * Presupuesto de bytes compartido por tareas que corren a la vez: cada tarea reserva la memoria que va a usar antes
+ * de empezar y la devuelve al terminar, así la suma de lo reservado nunca pasa la capacidad. Las reservas que
+ * esperan se atienden en orden de llegada, para que una grande no quede postergada por muchas chicas.
+ * Es seguro usarlo desde varios hilos.
+ */
+class GobernadorMemoria {
+private:
+    std::mutex mutex;
+    std::condition_variable cambio;
+    size_t capacidad;
+    size_t reservado = 0;
+    uint64_t turnos = 0;     // Turnos entregados
+    uint64_t atendidos = 0;  // Turnos que ya obtuvieron su reserva
+
+public:
+    explicit GobernadorMemoria(size_t capacidad = 0) : capacidad(capacidad) {}
+
+    GobernadorMemoria(const GobernadorMemoria&) = delete;
+    GobernadorMemoria& operator=(const GobernadorMemoria&) = delete;
+
+    /**
+     * Cambia la capacidad; solo se debe llamar sin reservas vigentes
+     * @param bytes nueva capacidad
+     */
+    void configurar(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        capacidad = bytes;
+    }
+
+    /**
+     * Bloquea hasta que haya 'bytes' libres y le toque el turno. Un pedido mayor que la capacidad se acota a ella,
+     * así nunca espera para siempre
+     * @return bytes reservados, que se deben devolver con liberar
+     */
+    size_t reservar(size_t bytes) {
+        std::unique_lock<std::mutex> lock(mutex);
+        bytes = std::min(bytes, capacidad);
+        uint64_t turno = turnos++;
+        cambio.wait(lock, [&] { return atendidos == turno && reservado + bytes <= capacidad; });
+        reservado += bytes;
+        atendidos++;
+        cambio.notify_all();
+        return bytes;
+    }
+
+    /**
+     * Reserva 'bytes' solo si están libres y nadie espera, sin bloquear
+     * @return true si se reservaron
+     */
+    bool intentarReservar(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (atendidos != turnos || reservado + bytes > capacidad) return false;
+        reservado += bytes;
+        return true;
+    }
+
+    /**
+     * Devuelve bytes reservados
+     */
+    void liberar(size_t bytes) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            reservado -= bytes;
+        }
+        cambio.notify_all();
+    }
+};
+
+/**
+ * Reserva de un GobernadorMemoria que se devuelve al salir del ámbito
+ */
+class ReservaMemoria {
+private:
+    GobernadorMemoria& gobernador;
+    size_t bytes;
+
+public:
+    ReservaMemoria(GobernadorMemoria& gobernador, size_t bytes)
+        : gobernador(gobernador), bytes(gobernador.reservar(bytes)) {}
+
+    ~ReservaMemoria() { gobernador.liberar(bytes); }
+
+    ReservaMemoria(const ReservaMemoria&) = delete;
+    ReservaMemoria& operator=(const ReservaMemoria&) = delete;
+};
+
+#endif // GOBERNADOR_MEMORIA_H
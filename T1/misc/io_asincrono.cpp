@@ -0,0 +1,369 @@
+#include "io_asincrono.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * Datos de una operacion pedida, se guardan para poder completar transferencias parciales
+ */
+struct SolicitudIO {
+    int fd;
+    char* buffer;
+    size_t bytes;
+    uint64_t offset;
+    bool escritura;
+};
+
+/**
+ * Completa de forma sincrona una transferencia a partir de 'hechos' bytes ya transferidos.
+ * Una lectura que devuelve 0 bytes indica fin de archivo.
+ * @return bytes transferidos en total, o -1 si hubo error
+ */
+static long completarSincrono(const SolicitudIO& s, size_t hechos) {
+    while (hechos < s.bytes) {
+        ssize_t r = s.escritura
+            ? pwrite(s.fd, s.buffer + hechos, s.bytes - hechos, s.offset + hechos)
+            : pread(s.fd, s.buffer + hechos, s.bytes - hechos, s.offset + hechos);
+        if (r < 0) return -1;
+        if (r == 0) break;
+        hechos += static_cast<size_t>(r);
+    }
+    return static_cast<long>(hechos);
+}
+
+/**
+ * Backend sincrono: cada operacion se ejecuta en el momento en que se pide
+ */
+class MotorIOSincrono : public MotorIO {
+private:
+    uint64_t siguiente_ticket = 0;
+    std::unordered_map<uint64_t, long> resultados;
+
+    uint64_t ejecutar(const SolicitudIO& s) {
+        uint64_t ticket = siguiente_ticket++;
+        resultados[ticket] = completarSincrono(s, 0);
+        return ticket;
+    }
+
+public:
+    uint64_t leer(int fd, void* destino, size_t bytes, uint64_t offset) override {
+        return ejecutar({fd, static_cast<char*>(destino), bytes, offset, false});
+    }
+
+    uint64_t escribir(int fd, const void* origen, size_t bytes, uint64_t offset) override {
+        return ejecutar({fd, const_cast<char*>(static_cast<const char*>(origen)), bytes, offset, true});
+    }
+
+    long esperar(uint64_t ticket) override {
+        long r = resultados[ticket];
+        resultados.erase(ticket);
+        return r;
+    }
+
+    BackendIO backend() const override { return BackendIO::Sincrono; }
+};
+
+/**
+ * Backend de hilos: una cola de solicitudes atendida por un grupo de hilos con pread/pwrite
+ */
+class MotorIOHilos : public MotorIO {
+private:
+    std::mutex mutex;
+    std::condition_variable hay_trabajo;
+    std::condition_variable hay_resultado;
+    std::deque<std::pair<uint64_t, SolicitudIO>> cola;
+    std::unordered_map<uint64_t, long> resultados;
+    std::vector<std::thread> hilos;
+    uint64_t siguiente_ticket = 0;
+    bool terminar = false;
+
+    void trabajar() {
+        while (true) {
+            std::pair<uint64_t, SolicitudIO> tarea;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                hay_trabajo.wait(lock, [this] { return terminar || !cola.empty(); });
+                if (cola.empty()) return;
+                tarea = cola.front();
+                cola.pop_front();
+            }
+            long r = completarSincrono(tarea.second, 0);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                resultados[tarea.first] = r;
+            }
+            hay_resultado.notify_all();
+        }
+    }
+
+    uint64_t encolar(const SolicitudIO& s) {
+        uint64_t ticket;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ticket = siguiente_ticket++;
+            cola.emplace_back(ticket, s);
+        }
+        hay_trabajo.notify_one();
+        return ticket;
+    }
+
+public:
+    explicit MotorIOHilos(unsigned num_hilos) {
+        if (num_hilos == 0) num_hilos = 1;
+        for (unsigned i = 0; i < num_hilos; i++) {
+            hilos.emplace_back(&MotorIOHilos::trabajar, this);
+        }
+    }
+
+    ~MotorIOHilos() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            terminar = true;
+        }
+        hay_trabajo.notify_all();
+        for (auto& hilo : hilos) {
+            hilo.join();
+        }
+    }
+
+    uint64_t leer(int fd, void* destino, size_t bytes, uint64_t offset) override {
+        return encolar({fd, static_cast<char*>(destino), bytes, offset, false});
+    }
+
+    uint64_t escribir(int fd, const void* origen, size_t bytes, uint64_t offset) override {
+        return encolar({fd, const_cast<char*>(static_cast<const char*>(origen)), bytes, offset, true});
+    }
+
+    long esperar(uint64_t ticket) override {
+        std::unique_lock<std::mutex> lock(mutex);
+        hay_resultado.wait(lock, [&] { return resultados.count(ticket) > 0; });
+        long r = resultados[ticket];
+        resultados.erase(ticket);
+        return r;
+    }
+
+    BackendIO backend() const override { return BackendIO::Hilos; }
+};
+
+/**
+ * Backend io_uring, usando directamente las llamadas al sistema (sin liburing)
+ */
+class MotorIOIoUring : public MotorIO {
+private:
+    int fd_anillo = -1;
+    unsigned entradas = 0;
+
+    // Anillo de envio
+    void* sq_ptr = MAP_FAILED;
+    size_t sq_len = 0;
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_len = 0;
+
+    // Anillo de completacion
+    void* cq_ptr = MAP_FAILED;
+    size_t cq_len = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    bool operaciones = false; // El kernel soporta IORING_OP_READ e IORING_OP_WRITE (desde Linux 5.6)
+
+    uint64_t siguiente_ticket = 0;
+    unsigned en_vuelo = 0;
+    std::unordered_map<uint64_t, SolicitudIO> pendientes;
+    std::unordered_map<uint64_t, long> resultados;
+
+    static int llamarEnter(int fd, unsigned enviar, unsigned minimo, unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, enviar, minimo, flags, nullptr, 0));
+    }
+
+    /**
+     * Pregunta al kernel que operaciones soporta el anillo. Los kernels que tienen io_uring pero no
+     * IORING_OP_READ/WRITE (5.1 a 5.5) tampoco tienen IORING_REGISTER_PROBE, asi que un registro fallido
+     * tambien cuenta como no soportado
+     * @return true si se pueden pedir lecturas y escrituras
+     */
+    bool soportaLecturaEscritura() const {
+        const unsigned cantidad = 256;
+        std::vector<char> memoria(sizeof(io_uring_probe) + cantidad * sizeof(io_uring_probe_op), 0);
+        io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(memoria.data());
+        if (syscall(__NR_io_uring_register, fd_anillo, IORING_REGISTER_PROBE, probe, cantidad) < 0) return false;
+        auto soportada = [&](unsigned op) {
+            return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+        };
+        return soportada(IORING_OP_READ) && soportada(IORING_OP_WRITE);
+    }
+
+    /**
+     * Recoge las completaciones disponibles, completando de forma sincrona las transferencias parciales
+     * @return cantidad de completaciones recogidas
+     */
+    unsigned cosechar() {
+        unsigned cabeza = *cq_head;
+        unsigned cola = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        unsigned recogidas = 0;
+        while (cabeza != cola) {
+            const io_uring_cqe& cqe = cqes[cabeza & *cq_mask];
+            uint64_t ticket = cqe.user_data;
+            const SolicitudIO& s = pendientes[ticket];
+            long r = cqe.res;
+            if (r >= 0 && static_cast<size_t>(r) < s.bytes && (r > 0 || s.escritura)) {
+                r = completarSincrono(s, static_cast<size_t>(r));
+            }
+            resultados[ticket] = r;
+            pendientes.erase(ticket);
+            cabeza++;
+            recogidas++;
+        }
+        __atomic_store_n(cq_head, cabeza, __ATOMIC_RELEASE);
+        en_vuelo -= recogidas;
+        return recogidas;
+    }
+
+    /**
+     * Bloquea hasta que haya al menos una completacion, reenviando las entradas que el kernel aun no tomo
+     */
+    void esperarCompletacion() {
+        unsigned no_enviadas = *sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        llamarEnter(fd_anillo, no_enviadas, 1, IORING_ENTER_GETEVENTS);
+    }
+
+    uint64_t enviar(const SolicitudIO& s) {
+        // Si el anillo esta lleno, se espera a que termine alguna operacion
+        while (en_vuelo >= entradas) {
+            if (cosechar() == 0) {
+                esperarCompletacion();
+            }
+        }
+
+        uint64_t ticket = siguiente_ticket++;
+        pendientes[ticket] = s;
+
+        unsigned cola = *sq_tail;
+        unsigned indice = cola & *sq_mask;
+        io_uring_sqe& sqe = sqes[indice];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = s.escritura ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe.fd = s.fd;
+        sqe.addr = reinterpret_cast<uint64_t>(s.buffer);
+        sqe.len = static_cast<unsigned>(s.bytes);
+        sqe.off = s.offset;
+        sqe.user_data = ticket;
+        sq_array[indice] = indice;
+        __atomic_store_n(sq_tail, cola + 1, __ATOMIC_RELEASE);
+        en_vuelo++;
+
+        // Si el envio falla (por ejemplo EAGAIN) la entrada queda en el anillo y se reenvia al esperar
+        llamarEnter(fd_anillo, 1, 0, 0);
+        return ticket;
+    }
+
+public:
+    /**
+     * Inicializa el anillo, si falla disponible() retorna false
+     */
+    explicit MotorIOIoUring(unsigned profundidad) {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        fd_anillo = static_cast<int>(syscall(__NR_io_uring_setup, profundidad, &p));
+        if (fd_anillo < 0) return;
+        entradas = p.sq_entries;
+
+        sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool mapa_unico = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (mapa_unico) {
+            sq_len = cq_len = std::max(sq_len, cq_len);
+        }
+
+        sq_ptr = mmap(nullptr, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_anillo, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) return;
+        cq_ptr = mapa_unico ? sq_ptr
+                            : mmap(nullptr, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_anillo, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) return;
+        sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_anillo, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) return;
+
+        char* sq = static_cast<char*>(sq_ptr);
+        sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+
+        char* cq = static_cast<char*>(cq_ptr);
+        cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        operaciones = soportaLecturaEscritura();
+    }
+
+    ~MotorIOIoUring() override {
+        // No se puede liberar la memoria de operaciones que el kernel todavia esta usando
+        while (en_vuelo > 0) {
+            if (cosechar() == 0) {
+                esperarCompletacion();
+            }
+        }
+        if (sqes != MAP_FAILED) munmap(sqes, sqes_len);
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) munmap(cq_ptr, cq_len);
+        if (sq_ptr != MAP_FAILED) munmap(sq_ptr, sq_len);
+        if (fd_anillo >= 0) close(fd_anillo);
+    }
+
+    /**
+     * @return true si el anillo quedo inicializado y soporta lecturas y escrituras
+     */
+    bool disponible() const {
+        return fd_anillo >= 0 && cqes != nullptr && operaciones;
+    }
+
+    uint64_t leer(int fd, void* destino, size_t bytes, uint64_t offset) override {
+        return enviar({fd, static_cast<char*>(destino), bytes, offset, false});
+    }
+
+    uint64_t escribir(int fd, const void* origen, size_t bytes, uint64_t offset) override {
+        return enviar({fd, const_cast<char*>(static_cast<const char*>(origen)), bytes, offset, true});
+    }
+
+    long esperar(uint64_t ticket) override {
+        while (resultados.count(ticket) == 0) {
+            if (cosechar() == 0) {
+                esperarCompletacion();
+            }
+        }
+        long r = resultados[ticket];
+        resultados.erase(ticket);
+        return r;
+    }
+
+    BackendIO backend() const override { return BackendIO::IoUring; }
+};
+
+std::unique_ptr<MotorIO> crearMotorIO(BackendIO backend, unsigned profundidad, unsigned num_hilos) {
+    if (backend == BackendIO::Sincrono) {
+        return std::unique_ptr<MotorIO>(new MotorIOSincrono());
+    }
+    if (backend == BackendIO::IoUring) {
+        std::unique_ptr<MotorIOIoUring> motor(new MotorIOIoUring(profundidad));
+        if (motor->disponible()) {
+            return std::unique_ptr<MotorIO>(motor.release());
+        }
+    }
+    return std::unique_ptr<MotorIO>(new MotorIOHilos(num_hilos));
+}
@@ -0,0 +1,59 @@
+#ifndef IO_ASINCRONO_H
+#define IO_ASINCRONO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * Backends disponibles para las operaciones de I/O asincronas
+ */
+enum class BackendIO {
+    Sincrono, // Ejecuta cada operacion al pedirla, sirve como referencia para comparar tiempos
+    Hilos,    // Un grupo de hilos ejecuta pread/pwrite en segundo plano
+    IoUring   // io_uring de Linux, si el kernel no lo permite o no tiene IORING_OP_READ/WRITE se usa Hilos
+};
+
+/**
+ * Motor de I/O asincrono sobre descriptores de archivo. Las operaciones se piden con leer/escribir,
+ * que devuelven un ticket, y se completan con esperar(ticket). Mientras una operacion esta en curso
+ * el buffer asociado no se debe tocar.
+ */
+class MotorIO {
+public:
+    virtual ~MotorIO() = default;
+
+    /**
+     * Pide la lectura de 'bytes' bytes desde 'offset' hacia 'destino'
+     * @return ticket de la operacion
+     */
+    virtual uint64_t leer(int fd, void* destino, size_t bytes, uint64_t offset) = 0;
+
+    /**
+     * Pide la escritura de 'bytes' bytes desde 'origen' en la posicion 'offset'
+     * @return ticket de la operacion
+     */
+    virtual uint64_t escribir(int fd, const void* origen, size_t bytes, uint64_t offset) = 0;
+
+    /**
+     * Bloquea hasta que termine la operacion del ticket
+     * @return bytes transferidos, o un valor negativo si hubo error
+     */
+    virtual long esperar(uint64_t ticket) = 0;
+
+    /**
+     * @return backend que realmente esta en uso
+     */
+    virtual BackendIO backend() const = 0;
+};
+
+/**
+ * Crea un motor de I/O con el backend pedido. Si se pide IoUring y el kernel no lo soporta, o no soporta
+ * lecturas y escrituras en el anillo (se pregunta con IORING_REGISTER_PROBE), se entrega un motor de Hilos.
+ * @param backend backend preferido
+ * @param profundidad maximo de operaciones en curso simultaneamente para io_uring
+ * @param num_hilos numero de hilos del backend Hilos
+ */
+std::unique_ptr<MotorIO> crearMotorIO(BackendIO backend, unsigned profundidad = 64, unsigned num_hilos = 2);
+
+#endif // IO_ASINCRONO_H
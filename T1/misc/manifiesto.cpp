@@ -0,0 +1,325 @@
+#include "manifiesto.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void SumaVerificacion::agregar(const void* datos, size_t bytes) {
+    const unsigned char* p = static_cast<const unsigned char*>(datos);
+    total += bytes;
+    // Completar la palabra que quedo a medias
+    while (en_resto > 0 && en_resto < 8 && bytes > 0) {
+        resto[en_resto++] = *p++;
+        bytes--;
+    }
+    if (en_resto == 8) {
+        uint64_t palabra;
+        memcpy(&palabra, resto, sizeof(palabra));
+        mezclar(palabra);
+        en_resto = 0;
+    }
+    for (; bytes >= 8; p += 8, bytes -= 8) {
+        uint64_t palabra;
+        memcpy(&palabra, p, sizeof(palabra));
+        mezclar(palabra);
+    }
+    memcpy(resto + en_resto, p, bytes);
+    en_resto += bytes;
+}
+
+uint64_t SumaVerificacion::valor() const {
+    SumaVerificacion copia = *this;
+    uint64_t palabra = 0;
+    memcpy(&palabra, resto, en_resto);
+    copia.mezclar(palabra);
+    copia.mezclar(total);
+    return copia.estado;
+}
+
+/**
+ * Formato: una linea con la firma y luego un paso por linea,
+ * paso <clave> <contador> <cantidad> [<nombre> <bytes> <suma>]...
+ * con la clave y los nombres entre comillas. Si una clave se repite vale su ultima linea
+ */
+size_t Manifiesto::abrir(const std::string& ruta, const std::string& firma) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->ruta = ruta;
+    this->firma = firma;
+    abierto = true;
+    cerrarDescriptor();
+    pasos.clear();
+    heredados.clear();
+
+    std::ifstream entrada(ruta);
+    std::string linea;
+    if (!entrada || !std::getline(entrada, linea) || linea != firma) return 0;
+
+    // Una linea sin su salto final quedo cortada por una caida mientras se agregaba
+    while (std::getline(entrada, linea) && !entrada.eof()) {
+        std::istringstream campos(linea);
+        std::string etiqueta, clave;
+        PasoManifiesto paso;
+        size_t cantidad = 0;
+        if (!(campos >> etiqueta >> std::quoted(clave) >> paso.contador >> cantidad) || etiqueta != "paso") break;
+        for (size_t i = 0; i < cantidad; i++) {
+            ArchivoVerificado archivo;
+            if (!(campos >> std::quoted(archivo.nombre) >> archivo.bytes >> archivo.suma)) break;
+            paso.archivos.push_back(archivo);
+        }
+        if (paso.archivos.size() != cantidad) break;
+        paso.heredado = true;
+        for (const auto& archivo : paso.archivos) {
+            heredados[archivo.nombre] = archivo;
+        }
+        pasos[clave] = paso;
+    }
+    return pasos.size();
+}
+
+bool Manifiesto::buscar(const std::string& clave, PasoManifiesto& paso) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = pasos.find(clave);
+    if (it == pasos.end()) return false;
+    paso = it->second;
+    return true;
+}
+
+void Manifiesto::registrar(const std::string& clave, uint64_t contador, const std::vector<ArchivoVerificado>& archivos) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!abierto) return;
+    for (const auto& archivo : archivos) {
+        heredados.erase(archivo.nombre); // Se volvio a escribir en esta ejecucion
+    }
+    pasos[clave] = PasoManifiesto{contador, archivos, false};
+    agregar(clave, pasos[clave]);
+}
+
+/**
+ * Relee por bloques los bytes de 'archivo' desde 'inicio' que describe 'esperado' y compara su suma
+ */
+static bool releer(const std::string& archivo, uint64_t inicio, const ArchivoVerificado& esperado, size_t B,
+                   size_t& bloques_leidos) {
+    int fd = open(archivo.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    std::vector<unsigned char> pedazo(std::max<size_t>(B, 1) * 64);
+    SumaVerificacion suma;
+    uint64_t offset = 0;
+    while (offset < esperado.bytes) {
+        size_t pedir = static_cast<size_t>(std::min<uint64_t>(pedazo.size(), esperado.bytes - offset));
+        ssize_t leidos = pread(fd, pedazo.data(), pedir, static_cast<off_t>(inicio + offset));
+        if (leidos <= 0) break;
+        suma.agregar(pedazo.data(), static_cast<size_t>(leidos));
+        offset += static_cast<uint64_t>(leidos);
+        bloques_leidos += (static_cast<size_t>(leidos) + B - 1) / B;
+    }
+    close(fd);
+    return offset == esperado.bytes && suma.valor() == esperado.suma;
+}
+
+bool Manifiesto::validar(const std::string& nombre, size_t B, size_t& bloques_leidos) {
+    ArchivoVerificado esperado;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = heredados.find(nombre);
+        if (it == heredados.end()) return true;
+        esperado = it->second;
+    }
+
+    struct stat info;
+    if (stat(nombre.c_str(), &info) != 0 || static_cast<uint64_t>(info.st_size) != esperado.bytes) return false;
+
+    // Releer el archivo completo por bloques
+    if (!releer(nombre, 0, esperado, B, bloques_leidos)) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    heredados.erase(nombre); // Ya validado, no se vuelve a leer
+    return true;
+}
+
+bool Manifiesto::validarZona(const std::string& nombre, const std::string& archivo, uint64_t offset, size_t B,
+                             size_t& bloques_leidos) {
+    ArchivoVerificado esperado;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = heredados.find(nombre);
+        if (it == heredados.end()) return true;
+        esperado = it->second;
+    }
+
+    struct stat info;
+    if (stat(archivo.c_str(), &info) != 0 || static_cast<uint64_t>(info.st_size) < offset + esperado.bytes) return false;
+    if (!releer(archivo, offset, esperado, B, bloques_leidos)) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    heredados.erase(nombre);
+    return true;
+}
+
+bool Manifiesto::ubicacionPrevia(const std::string& nombre, std::string& ruta) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& par : pasos) {
+        for (const auto& archivo : par.second.archivos) {
+            size_t barra = archivo.nombre.find_last_of('/');
+            if (archivo.nombre.compare(barra == std::string::npos ? 0 : barra + 1, std::string::npos, nombre) == 0) {
+                ruta = archivo.nombre;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Manifiesto::tamanoRegistrado(const std::string& ruta, uint64_t& bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& par : pasos) {
+        for (const auto& archivo : par.second.archivos) {
+            if (archivo.nombre == ruta) {
+                bytes = archivo.bytes;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Linea de un paso en el manifiesto, con su salto de linea
+ */
+static std::string lineaPaso(const std::string& clave, const PasoManifiesto& paso) {
+    std::ostringstream linea;
+    linea << "paso " << std::quoted(clave) << " " << paso.contador << " " << paso.archivos.size();
+    for (const auto& archivo : paso.archivos) {
+        linea << " " << std::quoted(archivo.nombre) << " " << archivo.bytes << " " << archivo.suma;
+    }
+    linea << "\n";
+    return linea.str();
+}
+
+/**
+ * Escribe todos los bytes de 'texto' en 'fd' y los sincroniza
+ */
+static bool escribirSincronizado(int fd, const std::string& texto) {
+    size_t escritos = 0;
+    while (escritos < texto.size()) {
+        ssize_t r = write(fd, texto.data() + escritos, texto.size() - escritos);
+        if (r <= 0) break;
+        escritos += static_cast<size_t>(r);
+    }
+    return escritos == texto.size() && fsync(fd) == 0;
+}
+
+/**
+ * Escribe el manifiesto completo en un temporal, lo sincroniza y lo renombra sobre el anterior; luego sincroniza el
+ * directorio para que el renombre sobreviva a una caida y deja el archivo abierto para agregar los pasos
+ * siguientes. Se llama con el mutex tomado
+ */
+void Manifiesto::guardar() {
+    cerrarDescriptor();
+    std::string texto = firma + "\n";
+    for (const auto& par : pasos) {
+        texto += lineaPaso(par.first, par.second);
+    }
+
+    std::string temporal = ruta + ".tmp";
+    int fd = open(temporal.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Error al escribir el manifiesto: " << temporal << std::endl;
+        return;
+    }
+    bool completo = escribirSincronizado(fd, texto);
+    close(fd);
+    if (!completo || rename(temporal.c_str(), ruta.c_str()) != 0) {
+        std::cerr << "Error al escribir el manifiesto: " << ruta << std::endl;
+        return;
+    }
+
+    size_t barra = ruta.find_last_of('/');
+    std::string directorio = (barra == std::string::npos) ? "." : ruta.substr(0, barra + 1);
+    int fd_directorio = open(directorio.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd_directorio >= 0) {
+        fsync(fd_directorio);
+        close(fd_directorio);
+    }
+    descriptor = open(ruta.c_str(), O_WRONLY | O_APPEND);
+}
+
+/**
+ * Agrega la linea de un paso al final del manifiesto y la sincroniza; si el manifiesto todavia no se reescribio
+ * desde que se abrio, o una escritura anterior fallo, lo reescribe completo. Se llama con el mutex tomado
+ */
+void Manifiesto::agregar(const std::string& clave, const PasoManifiesto& paso) {
+    if (descriptor < 0) {
+        guardar();
+        return;
+    }
+    if (!escribirSincronizado(descriptor, lineaPaso(clave, paso))) {
+        // La linea pudo quedar a medias: se reescribe todo
+        guardar();
+    }
+}
+
+void Manifiesto::cerrarDescriptor() {
+    if (descriptor >= 0) close(descriptor);
+    descriptor = -1;
+}
+
+Manifiesto::~Manifiesto() {
+    cerrarDescriptor();
+}
+
+void Manifiesto::reiniciar() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& par : pasos) {
+        for (const auto& archivo : par.second.archivos) {
+            remove(archivo.nombre.c_str());
+        }
+    }
+    pasos.clear();
+    heredados.clear();
+    cerrarDescriptor();
+    if (abierto) remove(ruta.c_str());
+}
+
+void Manifiesto::soltar() {
+    std::lock_guard<std::mutex> lock(mutex);
+    cerrarDescriptor();
+    abierto = false;
+    pasos.clear();
+    heredados.clear();
+}
+
+void Manifiesto::cerrar() {
+    std::lock_guard<std::mutex> lock(mutex);
+    cerrarDescriptor();
+    if (abierto) remove(ruta.c_str());
+    abierto = false;
+    pasos.clear();
+    heredados.clear();
+}
+
+std::string clavePaso(const std::string& tipo, const std::string& archivo) {
+    size_t barra = archivo.find_last_of('/');
+    return tipo + " " + ((barra == std::string::npos) ? archivo : archivo.substr(barra + 1));
+}
+
+ArchivoVerificado describirArchivo(const std::string& nombre, uint64_t suma) {
+    struct stat info;
+    uint64_t bytes = (stat(nombre.c_str(), &info) == 0) ? static_cast<uint64_t>(info.st_size) : 0;
+    return ArchivoVerificado{nombre, bytes, suma};
+}
+
+std::string firmaArchivo(const std::string& nombre) {
+    struct stat info;
+    std::ostringstream firma;
+    firma << std::quoted(nombre);
+    if (stat(nombre.c_str(), &info) == 0) {
+        firma << " " << info.st_size << " " << info.st_mtim.tv_sec << "." << info.st_mtim.tv_nsec;
+    }
+    return firma.str();
+}
@@ -0,0 +1,191 @@
+#ifndef MANIFIESTO_H
+#define MANIFIESTO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Suma de verificacion de 64 bits de una secuencia de bytes, calculada a medida que se escriben. El resultado no
+ * depende de como se corte la secuencia entre llamadas a agregar(). No es criptografica: solo detecta archivos
+ * truncados o corruptos antes de reutilizarlos.
+ */
+class SumaVerificacion {
+private:
+    uint64_t estado = 0x9E3779B97F4A7C15ULL;
+    uint64_t total = 0;         // Bytes agregados
+    unsigned char resto[8] = {}; // Bytes que todavia no completan una palabra
+    size_t en_resto = 0;
+
+    void mezclar(uint64_t palabra) {
+        estado ^= palabra;
+        estado *= 0xFF51AFD7ED558CCDULL;
+        estado ^= estado >> 32;
+    }
+
+public:
+    void agregar(const void* datos, size_t bytes);
+
+    /**
+     * @return suma de los bytes agregados hasta ahora
+     */
+    uint64_t valor() const;
+};
+
+/**
+ * Archivo producido por un paso, con lo necesario para validarlo antes de reutilizarlo
+ */
+struct ArchivoVerificado {
+    std::string nombre;
+    uint64_t bytes;
+    uint64_t suma;
+};
+
+/**
+ * Paso terminado de un ordenamiento: los archivos que produjo y el contador de temporales al terminarlo
+ */
+struct PasoManifiesto {
+    uint64_t contador;
+    std::vector<ArchivoVerificado> archivos;
+    bool heredado;  // Indica si el paso viene de una ejecucion anterior
+};
+
+/**
+ * Registro en disco de los pasos terminados de un ordenamiento externo (runs, mezclas, particiones), para retomarlo
+ * despues de una caida. Cada paso se identifica con una clave. El primer registro despues de abrir o reiniciar
+ * reescribe el manifiesto completo de forma atomica (archivo temporal, fsync y renombre sobre el anterior); los
+ * siguientes agregan su linea al final y la sincronizan, y al cargar se ignora una ultima linea cortada por una caida.
+ * La firma describe la entrada y los parametros; un manifiesto con otra firma se descarta. Sin abrir, no hace nada.
+ * Es seguro registrar pasos desde varios hilos.
+ */
+class Manifiesto {
+private:
+    std::string ruta;     // Archivo del manifiesto
+    std::string firma;    // Entrada y parametros del ordenamiento
+    bool abierto = false;
+    std::map<std::string, PasoManifiesto> pasos;
+    std::map<std::string, ArchivoVerificado> heredados; // Archivos de pasos heredados, por nombre
+    std::mutex mutex;
+    int descriptor = -1;  // Manifiesto abierto para agregar lineas; -1 hasta que se reescribe completo
+
+    void guardar();
+    void agregar(const std::string& clave, const PasoManifiesto& paso);
+    void cerrarDescriptor();
+
+public:
+    Manifiesto() = default;
+    ~Manifiesto();
+
+    /**
+     * Abre el manifiesto de un ordenamiento, cargando los pasos guardados si la firma coincide
+     * @param ruta archivo del manifiesto
+     * @param firma descripcion de la entrada y los parametros
+     * @return cantidad de pasos heredados
+     */
+    size_t abrir(const std::string& ruta, const std::string& firma);
+
+    /**
+     * @return true si hay un manifiesto abierto
+     */
+    bool activo() const { return abierto; }
+
+    /**
+     * Busca un paso terminado
+     * @param clave identificador del paso
+     * @param paso copia del paso encontrado
+     * @return true si el paso ya se habia terminado
+     */
+    bool buscar(const std::string& clave, PasoManifiesto& paso);
+
+    /**
+     * Registra un paso terminado y guarda el manifiesto
+     * @param clave identificador del paso
+     * @param contador contador de temporales al terminar el paso
+     * @param archivos archivos que produjo el paso, ya escritos
+     */
+    void registrar(const std::string& clave, uint64_t contador, const std::vector<ArchivoVerificado>& archivos);
+
+    /**
+     * Valida un archivo antes de reutilizarlo. Solo se leen los archivos de pasos heredados; los producidos en esta
+     * ejecucion se dan por buenos
+     * @param nombre archivo a validar
+     * @param B tamaño de bloque, para contar las lecturas
+     * @param bloques_leidos se le suman los bloques leidos para validar
+     * @return false si el archivo es heredado y no existe, cambio de tamaño o su suma no coincide
+     */
+    bool validar(const std::string& nombre, size_t B, size_t& bloques_leidos);
+
+    /**
+     * Igual que validar, para un paso que no produjo un archivo propio sino una zona de otro archivo: 'nombre'
+     * identifica la zona en el paso y sus bytes se releen desde 'offset' en 'archivo'
+     * @param nombre nombre con que el paso registro la zona
+     * @param archivo archivo que contiene la zona
+     * @param offset posicion de la zona en el archivo
+     * @param B tamaño de bloque, para contar las lecturas
+     * @param bloques_leidos se le suman los bloques leidos para validar
+     * @return false si la zona es heredada y el archivo es mas corto o su suma no coincide
+     */
+    bool validarZona(const std::string& nombre, const std::string& archivo, uint64_t offset, size_t B,
+                     size_t& bloques_leidos);
+
+    /**
+     * Busca la ruta con que un paso registrado guardo un archivo, para ubicar los temporales en el mismo directorio
+     * al retomar
+     * @param nombre nombre del archivo sin directorio
+     * @param ruta ruta registrada del archivo
+     * @return true si algun paso registro un archivo con ese nombre
+     */
+    bool ubicacionPrevia(const std::string& nombre, std::string& ruta);
+
+    /**
+     * Busca el tamaño con que un paso registrado guardo un archivo, que sigue disponible aunque el archivo ya se
+     * haya consumido y borrado
+     * @param ruta ruta del archivo
+     * @param bytes tamaño registrado
+     * @return true si algun paso registro ese archivo
+     */
+    bool tamanoRegistrado(const std::string& ruta, uint64_t& bytes);
+
+    /**
+     * Olvida todos los pasos y borra el manifiesto guardado, sin cerrarlo. Los archivos que registraron los pasos
+     * se borran, ya no se van a reutilizar
+     */
+    void reiniciar();
+
+    /**
+     * Deja de usar el manifiesto sin borrarlo, cuando un error detiene el ordenamiento: el archivo queda para
+     * retomarlo en otra ejecucion y en memoria queda cerrado y sin pasos
+     */
+    void soltar();
+
+    /**
+     * Borra el manifiesto al terminar el ordenamiento
+     */
+    void cerrar();
+};
+
+/**
+ * Clave de un paso que produce o consume un archivo temporal. Solo se usa el nombre del archivo, sin su directorio,
+ * asi la clave no cambia si al retomar el temporal se ubicaria en otro directorio
+ * @param tipo tipo de paso, por ejemplo "run" o "mezcla"
+ * @param archivo ruta del archivo que identifica al paso
+ */
+std::string clavePaso(const std::string& tipo, const std::string& archivo);
+
+/**
+ * Describe un archivo recien escrito con su tamaño actual
+ * @param nombre archivo
+ * @param suma suma de verificacion de su contenido
+ */
+ArchivoVerificado describirArchivo(const std::string& nombre, uint64_t suma);
+
+/**
+ * Firma de un archivo de entrada: nombre, tamaño y fecha de modificacion
+ * @param nombre archivo de entrada
+ */
+std::string firmaArchivo(const std::string& nombre);
+
+#endif // MANIFIESTO_H
@@ -0,0 +1,221 @@
+#include "mezcla_simd.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MEZCLA_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * Mezcla escalar: la eleccion del menor se traduce en movimientos condicionales en vez de saltos,
+ * que con claves aleatorias se predicen mal la mitad de las veces
+ */
+static void mezclarEscalar(const int64_t* a, size_t& ia, size_t na,
+                           const int64_t* b, size_t& ib, size_t nb,
+                           int64_t* salida, size_t& is, size_t ns) {
+    size_t i = ia, j = ib, k = is;
+    while (i < na && j < nb && k < ns) {
+        int64_t x = a[i];
+        int64_t y = b[j];
+        bool tomar_a = (x <= y);
+        salida[k++] = tomar_a ? x : y;
+        i += tomar_a;
+        j += !tomar_a;
+    }
+    ia = i;
+    ib = j;
+    is = k;
+}
+
+/**
+ * Al salir del ciclo vectorial quedan en el registro los W mayores elementos consumidos, que aun no se escriben.
+ * Como cada entrada esta ordenada, esos W elementos son un sufijo de lo consumido de 'a' mas un sufijo de lo
+ * consumido de 'b'. Se devuelven los indices recorriendo ambos sufijos desde atras, y la mezcla escalar los
+ * vuelve a procesar. Con claves repetidas el reparto puede diferir, pero los valores escritos son los mismos
+ */
+static void devolverPendientes(const int64_t* a, size_t& ia, const int64_t* b, size_t& ib, size_t pendientes) {
+    for (size_t t = 0; t < pendientes; t++) {
+        if (ib == 0 || (ia > 0 && a[ia - 1] > b[ib - 1])) {
+            ia--;
+        } else {
+            ib--;
+        }
+    }
+}
+
+#ifdef MEZCLA_SIMD_X86
+
+// Minimo y maximo de enteros de 64 bits, AVX2 solo tiene la comparacion mayor que
+__attribute__((target("avx2")))
+static inline void minMax256(__m256i x, __m256i y, __m256i& menor, __m256i& mayor) {
+    __m256i gt = _mm256_cmpgt_epi64(x, y);
+    menor = _mm256_blendv_epi8(x, y, gt);
+    mayor = _mm256_blendv_epi8(y, x, gt);
+}
+
+/**
+ * Red bitonica para dos vectores ordenados de 4 elementos: 'bajo' queda con los 4 menores y 'alto' con los
+ * 4 mayores, ambos ordenados
+ */
+__attribute__((target("avx2")))
+static inline void mezclarRed256(__m256i& bajo, __m256i& alto) {
+    // Invertir 'alto' deja una secuencia bitonica de 8, el primer nivel separa menores y mayores
+    __m256i invertido = _mm256_permute4x64_epi64(alto, 0x1B);
+    __m256i l, h;
+    minMax256(bajo, invertido, l, h);
+
+    // Distancia 2: comparar cada mitad con la otra
+    __m256i l2 = _mm256_permute4x64_epi64(l, 0x4E);
+    __m256i h2 = _mm256_permute4x64_epi64(h, 0x4E);
+    __m256i lmin, lmax, hmin, hmax;
+    minMax256(l, l2, lmin, lmax);
+    minMax256(h, h2, hmin, hmax);
+    l = _mm256_blend_epi32(lmin, lmax, 0xF0);
+    h = _mm256_blend_epi32(hmin, hmax, 0xF0);
+
+    // Distancia 1: comparar elementos vecinos
+    l2 = _mm256_permute4x64_epi64(l, 0xB1);
+    h2 = _mm256_permute4x64_epi64(h, 0xB1);
+    minMax256(l, l2, lmin, lmax);
+    minMax256(h, h2, hmin, hmax);
+    bajo = _mm256_blend_epi32(lmin, lmax, 0xCC);
+    alto = _mm256_blend_epi32(hmin, hmax, 0xCC);
+}
+
+__attribute__((target("avx2")))
+static void mezclarAVX2(const int64_t* a, size_t& ia, size_t na,
+                        const int64_t* b, size_t& ib, size_t nb,
+                        int64_t* salida, size_t& is, size_t ns) {
+    const size_t W = 4;
+    if (ia + W <= na && ib + W <= nb && is + W <= ns) {
+        // El registro comienza con el primer vector de la entrada de menor cabeza
+        __m256i registro;
+        if (a[ia] <= b[ib]) {
+            registro = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + ia));
+            ia += W;
+        } else {
+            registro = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + ib));
+            ib += W;
+        }
+        // Cada vuelta carga el vector con la menor cabeza, escribe los 4 menores y guarda los 4 mayores
+        while (ia + W <= na && ib + W <= nb && is + W <= ns) {
+            // Eleccion sin saltos de la entrada que se carga
+            bool tomar_a = (a[ia] <= b[ib]);
+            __m256i nuevo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tomar_a ? a + ia : b + ib));
+            ia += tomar_a ? W : 0;
+            ib += tomar_a ? 0 : W;
+            mezclarRed256(nuevo, registro);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(salida + is), nuevo);
+            is += W;
+        }
+        devolverPendientes(a, ia, b, ib, W);
+    }
+    mezclarEscalar(a, ia, na, b, ib, nb, salida, is, ns);
+}
+
+// GCC 12 avisa falsamente de valores sin inicializar dentro de los intrinsecos de AVX-512 al usarlos
+// en funciones con atributo target
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+/**
+ * Red bitonica para dos vectores ordenados de 8 elementos, AVX-512 tiene minimo y maximo de 64 bits
+ */
+__attribute__((target("avx512f")))
+static inline void mezclarRed512(__m512i& bajo, __m512i& alto) {
+    const __m512i invertir = _mm512_set_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m512i cruzar4 = _mm512_set_epi64(3, 2, 1, 0, 7, 6, 5, 4);
+    const __m512i cruzar2 = _mm512_set_epi64(5, 4, 7, 6, 1, 0, 3, 2);
+    const __m512i cruzar1 = _mm512_set_epi64(6, 7, 4, 5, 2, 3, 0, 1);
+
+    __m512i invertido = _mm512_permutexvar_epi64(invertir, alto);
+    __m512i l = _mm512_min_epi64(bajo, invertido);
+    __m512i h = _mm512_max_epi64(bajo, invertido);
+
+    // Distancias 4, 2 y 1: el menor queda en la primera posicion de cada par comparado
+    const __m512i indices[3] = {cruzar4, cruzar2, cruzar1};
+    const __mmask8 mascaras_mayor[3] = {0xF0, 0xCC, 0xAA};
+    for (int nivel = 0; nivel < 3; nivel++) {
+        __m512i l2 = _mm512_permutexvar_epi64(indices[nivel], l);
+        __m512i h2 = _mm512_permutexvar_epi64(indices[nivel], h);
+        l = _mm512_mask_blend_epi64(mascaras_mayor[nivel], _mm512_min_epi64(l, l2), _mm512_max_epi64(l, l2));
+        h = _mm512_mask_blend_epi64(mascaras_mayor[nivel], _mm512_min_epi64(h, h2), _mm512_max_epi64(h, h2));
+    }
+    bajo = l;
+    alto = h;
+}
+
+__attribute__((target("avx512f")))
+static void mezclarAVX512(const int64_t* a, size_t& ia, size_t na,
+                          const int64_t* b, size_t& ib, size_t nb,
+                          int64_t* salida, size_t& is, size_t ns) {
+    const size_t W = 8;
+    if (ia + W <= na && ib + W <= nb && is + W <= ns) {
+        __m512i registro;
+        if (a[ia] <= b[ib]) {
+            registro = _mm512_loadu_si512(a + ia);
+            ia += W;
+        } else {
+            registro = _mm512_loadu_si512(b + ib);
+            ib += W;
+        }
+        while (ia + W <= na && ib + W <= nb && is + W <= ns) {
+            // Eleccion sin saltos de la entrada que se carga
+            bool tomar_a = (a[ia] <= b[ib]);
+            __m512i nuevo = _mm512_loadu_si512(tomar_a ? a + ia : b + ib);
+            ia += tomar_a ? W : 0;
+            ib += tomar_a ? 0 : W;
+            mezclarRed512(nuevo, registro);
+            _mm512_storeu_si512(salida + is, nuevo);
+            is += W;
+        }
+        devolverPendientes(a, ia, b, ib, W);
+    }
+    mezclarEscalar(a, ia, na, b, ib, nb, salida, is, ns);
+}
+
+#pragma GCC diagnostic pop
+
+#endif // MEZCLA_SIMD_X86
+
+NivelSimd nivelSimdDisponible() {
+#ifdef MEZCLA_SIMD_X86
+    static const NivelSimd nivel = __builtin_cpu_supports("avx512f") ? NivelSimd::AVX512
+                                 : __builtin_cpu_supports("avx2")    ? NivelSimd::AVX2
+                                                                     : NivelSimd::Escalar;
+    return nivel;
+#else
+    return NivelSimd::Escalar;
+#endif
+}
+
+const char* nombreNivelSimd(NivelSimd nivel) {
+    switch (nivel) {
+        case NivelSimd::AVX512: return "AVX-512";
+        case NivelSimd::AVX2:   return "AVX2";
+        default:                return "escalar";
+    }
+}
+
+void mezclarDos(const int64_t* a, size_t& ia, size_t na,
+                const int64_t* b, size_t& ib, size_t nb,
+                int64_t* salida, size_t& is, size_t ns, NivelSimd nivel) {
+#ifdef MEZCLA_SIMD_X86
+    if (nivel == NivelSimd::AVX512) {
+        mezclarAVX512(a, ia, na, b, ib, nb, salida, is, ns);
+        return;
+    }
+    if (nivel == NivelSimd::AVX2) {
+        mezclarAVX2(a, ia, na, b, ib, nb, salida, is, ns);
+        return;
+    }
+#else
+    (void)nivel;
+#endif
+    mezclarEscalar(a, ia, na, b, ib, nb, salida, is, ns);
+}
+
+void mezclarDos(const int64_t* a, size_t& ia, size_t na,
+                const int64_t* b, size_t& ib, size_t nb,
+                int64_t* salida, size_t& is, size_t ns) {
+    mezclarDos(a, ia, na, b, ib, nb, salida, is, ns, nivelSimdDisponible());
+}
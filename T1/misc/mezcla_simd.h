@@ -0,0 +1,47 @@
+#ifndef MEZCLA_SIMD_H
+#define MEZCLA_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Conjunto de instrucciones con que se ejecuta la mezcla de dos secuencias
+ */
+enum class NivelSimd {
+    Escalar, // Mezcla sin saltos, portable
+    AVX2,    // Red bitonica de 4 + 4 elementos
+    AVX512   // Red bitonica de 8 + 8 elementos
+};
+
+/**
+ * @return el mejor nivel que soporta la CPU, detectado una vez al primer uso
+ */
+NivelSimd nivelSimdDisponible();
+
+/**
+ * @return nombre del nivel, para reportar en la salida del programa
+ */
+const char* nombreNivelSimd(NivelSimd nivel);
+
+/**
+ * Mezcla dos secuencias ordenadas hasta agotar una de ellas o llenar la salida, lo que ocurra primero.
+ * Los indices avanzan en la cantidad de elementos consumidos y escritos, por lo que se puede llamar de nuevo
+ * despues de recargar la entrada agotada o vaciar la salida. Mientras a ambas entradas y a la salida les quede
+ * al menos un vector completo se usa una red de mezcla bitonica, y el resto se completa con la version escalar.
+ * @param a primera secuencia, 'ia' es la posicion actual y 'na' su largo
+ * @param b segunda secuencia, 'ib' es la posicion actual y 'nb' su largo
+ * @param salida arreglo de salida, 'is' es la posicion actual y 'ns' su capacidad
+ * @param nivel instrucciones a usar, debe estar soportado por la CPU
+ */
+void mezclarDos(const int64_t* a, size_t& ia, size_t na,
+                const int64_t* b, size_t& ib, size_t nb,
+                int64_t* salida, size_t& is, size_t ns, NivelSimd nivel);
+
+/**
+ * Igual que la anterior, con el nivel detectado por nivelSimdDisponible
+ */
+void mezclarDos(const int64_t* a, size_t& ia, size_t na,
+                const int64_t* b, size_t& ib, size_t nb,
+                int64_t* salida, size_t& is, size_t ns);
+
+#endif // MEZCLA_SIMD_H
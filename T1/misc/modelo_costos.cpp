@@ -0,0 +1,300 @@
+#include "modelo_costos.h"
+#include "plan_mezclas.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+std::string PrediccionIO::describir() const {
+    std::ostringstream out;
+    out << static_cast<size_t>(std::llround(bloques)) << " bloques, "
+        << static_cast<size_t>(std::llround(accesos_aleatorios)) << " accesos aleatorios, "
+        << pasadas << " pasada(s), " << segundos << " s estimados";
+    return out.str();
+}
+
+/**
+ * Saca un archivo del cache de paginas, para que la medicion siguiente lea desde el disco
+ */
+static void descartarCache(const std::string& archivo) {
+    int fd = open(archivo.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+CalibracionDispositivo calibrarDispositivo(const std::string& archivo_prueba, size_t B, TipoDispositivo dispositivo, size_t bytes) {
+    CalibracionDispositivo calibracion;
+    size_t bloques = std::max<size_t>(bytes / B, 1);
+    std::vector<char> bloque(B, 1);
+    {
+        std::unique_ptr<ArchivoBloques> archivo = abrirArchivoBloques(dispositivo, archivo_prueba, ModoApertura::Escritura);
+        if (!archivo) {
+            std::cerr << "Error al crear el archivo de calibracion: " << archivo_prueba << std::endl;
+            return calibracion;
+        }
+        for (size_t i = 0; i < bloques; i++) {
+            archivo->escribir(bloque.data(), B, static_cast<uint64_t>(i) * B);
+        }
+    }
+
+    using reloj = std::chrono::steady_clock;
+    std::unique_ptr<ArchivoBloques> archivo = abrirArchivoBloques(dispositivo, archivo_prueba, ModoApertura::Lectura);
+
+    // Lectura en orden de todo el archivo, de a un bloque por llamada
+    descartarCache(archivo_prueba);
+    auto inicio = reloj::now();
+    for (size_t i = 0; i < bloques; i++) {
+        archivo->leer(bloque.data(), B, static_cast<uint64_t>(i) * B);
+    }
+    double secuencial = std::chrono::duration<double>(reloj::now() - inicio).count();
+
+    // Lecturas de un bloque en posiciones al azar, a lo mas 1024 para que la medicion sea corta
+    size_t lecturas = std::min<size_t>(bloques, 1024);
+    std::mt19937_64 generador(bloques);
+    descartarCache(archivo_prueba);
+    inicio = reloj::now();
+    for (size_t i = 0; i < lecturas; i++) {
+        archivo->leer(bloque.data(), B, static_cast<uint64_t>(generador() % bloques) * B);
+    }
+    double aleatorio = std::chrono::duration<double>(reloj::now() - inicio).count();
+    archivo.reset();
+    remove(archivo_prueba.c_str());
+
+    calibracion.segundos_secuencial = secuencial / bloques;
+    calibracion.segundos_aleatorio = std::max(aleatorio / lecturas, calibracion.segundos_secuencial);
+    return calibracion;
+}
+
+/**
+ * Costo acumulado de una parte del ordenamiento
+ */
+struct Costo {
+    double bloques = 0;
+    double accesos = 0;
+
+    Costo& operator+=(const Costo& otro) {
+        bloques += otro.bloques;
+        accesos += otro.accesos;
+        return *this;
+    }
+};
+
+/**
+ * Bloques que cuenta bloquesTransferidos para 'elementos' registros transferidos de a 'por_transferencia', y
+ * cantidad de transferencias
+ */
+static Costo transferencias(double elementos, size_t por_transferencia, size_t tamano_registro, size_t B) {
+    Costo costo;
+    if (elementos <= 0) return costo;
+    por_transferencia = std::max<size_t>(por_transferencia, 1);
+    double completas = std::floor(elementos / por_transferencia);
+    double resto = elementos - completas * por_transferencia;
+    double bloques_completa = std::ceil(static_cast<double>(por_transferencia) * tamano_registro / B);
+    costo.bloques = completas * bloques_completa + std::ceil(resto * tamano_registro / B);
+    costo.accesos = completas + (resto > 0 ? 1 : 0);
+    return costo;
+}
+
+/**
+ * Completa la prediccion con las pasadas equivalentes y el tiempo estimado
+ */
+static PrediccionIO cerrarPrediccion(const Costo& costo, double bloques_entrada, const CalibracionDispositivo& calibracion) {
+    PrediccionIO prediccion;
+    prediccion.bloques = costo.bloques;
+    prediccion.accesos_aleatorios = costo.accesos;
+    prediccion.pasadas = (bloques_entrada > 0) ? static_cast<size_t>(std::llround(costo.bloques / (2 * bloques_entrada))) : 0;
+    prediccion.segundos = costo.accesos * calibracion.segundos_aleatorio +
+                          std::max(0.0, costo.bloques - costo.accesos) * calibracion.segundos_secuencial;
+    return prediccion;
+}
+
+PrediccionIO predecirMergesort(const ParametrosCosto& parametros, size_t a, const CalibracionDispositivo& calibracion) {
+    const size_t s = std::max<size_t>(parametros.tamano_registro, 1);
+    const size_t B = parametros.B;
+    const size_t M = parametros.M;
+    const size_t por_bloque = std::max<size_t>(B / s, 1);
+    const size_t n = parametros.N / s;
+    const size_t hilos = std::max<unsigned>(parametros.hilos, 1);
+    Costo costo;
+
+    // Runs: cada ventana se lee y se escribe de corrido, un posicionamiento por archivo
+    size_t ventana = std::max<size_t>(M / B, 1) * por_bloque;
+    size_t largo = std::max<size_t>(static_cast<size_t>(ventana * parametros.largo_runs), 1);
+    std::vector<double> nivel;
+    for (size_t inicio = 0; inicio < n; inicio += largo) {
+        double elementos = static_cast<double>(std::min(largo, n - inicio));
+        costo.bloques += 2 * std::ceil(elementos / por_bloque);
+        costo.accesos += 2;
+        nivel.push_back(elementos);
+    }
+    double bloques_entrada = std::ceil(static_cast<double>(n) / por_bloque);
+
+    // Un solo run se renombra como salida
+    if (nivel.size() <= 1) return cerrarPrediccion(costo, bloques_entrada, calibracion);
+
+    // Mezclas intermedias en el orden de planificarMezclas, M repartida entre las mezclas simultaneas de cada ronda
+    std::vector<uint64_t> tamanos;
+    for (double elementos : nivel) {
+        tamanos.push_back(static_cast<uint64_t>(elementos) * s);
+    }
+    PlanMezclas plan = planificarMezclas(tamanos, a);
+    std::vector<double> entradas = nivel;
+    for (const auto& mezcla : plan.mezclas) {
+        entradas.push_back(static_cast<double>(mezcla.bytes / s));
+    }
+    EncadenamientoMezclas encadenamiento;
+    encadenamiento.profundidad.assign(plan.mezclas.size(), SIZE_MAX);
+    if (parametros.encadenar && !plan.mezclas.empty()) encadenamiento = planificarEncadenamiento(plan, M, B);
+    auto encadenada = [&](size_t entrada) { return entrada >= plan.runs && encadenamiento.encadenada(entrada - plan.runs); };
+
+    for (size_t ronda = 0; ronda < plan.rondas; ronda++) {
+        size_t simultaneas = 0;
+        for (size_t j = 0; j < plan.mezclas.size(); j++) {
+            simultaneas += (plan.mezclas[j].ronda == ronda && !encadenamiento.encadenada(j)) ? 1 : 0;
+        }
+        size_t concurrentes = std::max<size_t>(1, std::min(hilos, simultaneas));
+        for (size_t j = 0; j < plan.mezclas.size(); j++) {
+            const MezclaPlanificada& mezcla = plan.mezclas[j];
+            if (mezcla.ronda != ronda || encadenamiento.encadenada(j)) continue;
+            size_t k = mezcla.entradas.size();
+            size_t por_buffer = planificarBuffers(M / concurrentes, B, k, 1, 2, 2).elementosPorBuffer(s);
+            for (size_t entrada : mezcla.entradas) {
+                costo += transferencias(entradas[entrada], por_buffer, s, B);
+            }
+            costo += transferencias(entradas[plan.runs + j], por_buffer, s, B);
+        }
+    }
+
+    // Pipeline: las mezclas encadenadas solo leen sus archivos y la final escribe la salida, sin particionar
+    if (encadenamiento.niveles > 0) {
+        size_t por_buffer = encadenamiento.bloques_por_buffer * por_bloque;
+        for (size_t j = 0; j < plan.mezclas.size(); j++) {
+            if (!encadenamiento.encadenada(j)) continue;
+            for (size_t entrada : plan.mezclas[j].entradas) {
+                if (!encadenada(entrada)) costo += transferencias(entradas[entrada], por_buffer, s, B);
+            }
+        }
+        for (size_t entrada : plan.final) {
+            if (!encadenada(entrada)) costo += transferencias(entradas[entrada], por_buffer, s, B);
+        }
+        costo += transferencias(static_cast<double>(n), por_buffer, s, B);
+        return cerrarPrediccion(costo, bloques_entrada, calibracion);
+    }
+    nivel.clear();
+    for (size_t entrada : plan.final) {
+        nivel.push_back(entradas[entrada]);
+    }
+
+    // Mezcla final, particionada por rangos de claves cuando hay hilos y datos suficientes
+    size_t k = nivel.size();
+    if (hilos > 1 && n >= hilos * 64 * por_bloque) {
+        size_t por_buffer = planificarBuffers(M / hilos, B, k, 1, 2, 2).elementosPorBuffer(s);
+        for (double elementos : nivel) {
+            // Muestras y busqueda binaria de cada separador, un bloque por lectura
+            double bloques_run = std::ceil(elementos / por_bloque);
+            double muestras = std::min<double>(bloques_run, 4.0 * hilos);
+            double busqueda = std::ceil(std::log2(std::max(bloques_run / muestras, 1.0))) + 1;
+            costo.bloques += muestras + (hilos - 1) * busqueda;
+            costo.accesos += muestras + (hilos - 1) * busqueda;
+            // Cada parte lee su tramo del run, que no empieza alineado a un bloque
+            Costo parte = transferencias(elementos / hilos, por_buffer, s, B);
+            costo.bloques += hilos * (parte.bloques + 1);
+            costo.accesos += hilos * parte.accesos;
+        }
+        Costo salida = transferencias(static_cast<double>(n) / hilos, por_buffer, s, B);
+        costo.bloques += hilos * (salida.bloques + 1);
+        costo.accesos += hilos * salida.accesos;
+    } else {
+        size_t por_buffer = planificarBuffers(M, B, k, 1, 2, 2).elementosPorBuffer(s);
+        for (double elementos : nivel) {
+            costo += transferencias(elementos, por_buffer, s, B);
+        }
+        costo += transferencias(static_cast<double>(n), por_buffer, s, B);
+    }
+    return cerrarPrediccion(costo, bloques_entrada, calibracion);
+}
+
+PrediccionIO predecirQuicksort(const ParametrosCosto& parametros, size_t a, const CalibracionDispositivo& calibracion) {
+    const size_t s = std::max<size_t>(parametros.tamano_registro, 1);
+    const size_t B = parametros.B;
+    const size_t por_bloque = std::max<size_t>(B / s, 1);
+    const size_t n = parametros.N / s;
+    const size_t capacidad = parametros.M / s;
+    a = std::max<size_t>(a, 2);
+
+    // Costo de ordenar una particion de 'elementos' registros, memorizado por tamaño. Con los pivotes sobremuestreados
+    // las particiones salen casi parejas, asi que se modelan iguales
+    std::unordered_map<size_t, Costo> memo;
+    std::function<Costo(size_t)> esperado = [&](size_t elementos) -> Costo {
+        Costo costo;
+        if (elementos == 0) return costo;
+        if (elementos <= capacidad) {
+            // Caso base: se lee, se ordena en memoria y se escribe de corrido
+            costo.bloques = 2 * std::ceil(static_cast<double>(elementos) / por_bloque);
+            costo.accesos = 2;
+            return costo;
+        }
+        auto guardado = memo.find(elementos);
+        if (guardado != memo.end()) return guardado->second;
+
+        // Bloques de la muestra y lectura de la particion, intercalada con las escrituras de las particiones hijas
+        PlanMuestreo muestreo = planificarMuestreo(elementos, capacidad, a, por_bloque, parametros.sobremuestreo);
+        size_t por_buffer = std::max<size_t>(planificarBuffers(parametros.M, B, 1, muestreo.particiones).elementosPorBuffer(s), 1);
+        costo.bloques = costo.accesos = static_cast<double>(muestreo.bloques);
+        costo += transferencias(static_cast<double>(elementos), por_buffer, s, B);
+        for (size_t i = 0; i < muestreo.particiones; i++) {
+            size_t hijo = (elementos * (i + 1)) / muestreo.particiones - (elementos * i) / muestreo.particiones;
+            // Cada hoja escribe directo en su zona de la salida, sin concatenaciones
+            costo += transferencias(static_cast<double>(hijo), por_buffer, s, B);
+            costo += esperado(hijo);
+        }
+        memo[elementos] = costo;
+        return costo;
+    };
+    return cerrarPrediccion(esperado(n), std::ceil(static_cast<double>(n) / por_bloque), calibracion);
+}
+
+EleccionAridad elegirAridad(AlgoritmoExterno algoritmo, const ParametrosCosto& parametros,
+                            const CalibracionDispositivo& calibracion, size_t a_min, size_t a_max) {
+    EleccionAridad mejor;
+    a_min = std::max<size_t>(a_min, 2);
+    a_max = std::max(a_max, a_min);
+    for (size_t a = a_min; a <= a_max; a++) {
+        PrediccionIO prediccion = (algoritmo == AlgoritmoExterno::Mergesort)
+            ? predecirMergesort(parametros, a, calibracion)
+            : predecirQuicksort(parametros, a, calibracion);
+        bool menor = (mejor.aridad == 0) || prediccion.segundos < mejor.prediccion.segundos ||
+                     (prediccion.segundos == mejor.prediccion.segundos && prediccion.bloques < mejor.prediccion.bloques);
+        if (menor) {
+            mejor.aridad = a;
+            mejor.prediccion = prediccion;
+        }
+    }
+
+    // Reparto de M de la pasada principal con la aridad elegida
+    if (algoritmo == AlgoritmoExterno::Mergesort) {
+        size_t s = std::max<size_t>(parametros.tamano_registro, 1);
+        size_t ventana = std::max<size_t>(parametros.M / parametros.B, 1) * std::max<size_t>(parametros.B / s, 1);
+        size_t largo = std::max<size_t>(static_cast<size_t>(ventana * parametros.largo_runs), 1);
+        size_t runs = (parametros.N / s + largo - 1) / largo;
+        size_t entradas = std::max<size_t>(std::min(mejor.aridad, runs), 1);
+        mejor.plan = planificarBuffers(parametros.M, parametros.B, entradas, 1, 2, 2);
+    } else {
+        size_t s = std::max<size_t>(parametros.tamano_registro, 1);
+        PlanMuestreo muestreo = planificarMuestreo(parametros.N / s, parametros.M / s, mejor.aridad,
+                                                   std::max<size_t>(parametros.B / s, 1), parametros.sobremuestreo);
+        mejor.plan = planificarBuffers(parametros.M, parametros.B, 1, muestreo.particiones);
+    }
+    return mejor;
+}
@@ -0,0 +1,109 @@
+#ifndef MODELO_COSTOS_H
+#define MODELO_COSTOS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "dispositivo_bloques.h"
+#include "muestreo_pivotes.h"
+#include "plan_buffers.h"
+
+/**
+ * Costo medido de un dispositivo: segundos por bloque leido en orden y segundos por bloque leido en una posicion
+ * aleatoria. El segundo incluye el posicionamiento que paga cada transferencia que alterna con otro archivo
+ */
+struct CalibracionDispositivo {
+    double segundos_secuencial = 1.0;
+    double segundos_aleatorio = 1.0;
+};
+
+/**
+ * Datos de un ordenamiento para el modelo de costos
+ */
+struct ParametrosCosto {
+    size_t N;                       // Tamaño de la entrada en bytes
+    size_t M;                       // Memoria principal en bytes
+    size_t B;                       // Tamaño de bloque en bytes
+    size_t tamano_registro = 8;     // sizeof(T)
+    unsigned hilos = 0;             // Hilos del pool del ordenador (0 o 1: mezcla final sin particionar)
+    double largo_runs = 1.0;        // Largo de los runs iniciales en ventanas de M (2 con seleccion con reemplazo)
+    bool encadenar = true;          // Niveles de arriba del arbol de mezclas encadenados con la final (plan_mezclas.h)
+    size_t sobremuestreo = SOBREMUESTREO_PIVOTES; // Muestras por particion de los pivotes del quicksort
+};
+
+/**
+ * Prediccion del modelo para una aridad
+ */
+struct PrediccionIO {
+    double bloques = 0;             // Valor esperado de contadorIO al terminar
+    double accesos_aleatorios = 0;  // Transferencias que alternan con otro archivo y pagan un posicionamiento
+    size_t pasadas = 0;             // Pasadas equivalentes: bloques / (2 * bloques de la entrada), redondeado
+    double segundos = 0;            // Tiempo de I/O estimado con la calibracion
+
+    std::string describir() const;
+};
+
+/**
+ * Algoritmo a modelar
+ */
+enum class AlgoritmoExterno {
+    Mergesort,
+    Quicksort
+};
+
+/**
+ * Aridad elegida por el modelo junto con su prediccion y el reparto de M de la pasada principal (la mezcla final del
+ * mergesort o la particion del quicksort)
+ */
+struct EleccionAridad {
+    size_t aridad = 0;
+    PrediccionIO prediccion;
+    PlanBuffers plan;
+};
+
+/**
+ * Mide el costo de leer bloques en orden y en posiciones aleatorias sobre un archivo de prueba de 'bytes' bytes que
+ * se escribe, se saca del cache de paginas y se borra al terminar. Usa el mismo dispositivo que el ordenamiento,
+ * por lo que con O_DIRECT mide el disco y con los demas lo que ve el programa a traves del cache
+ * @param archivo_prueba ruta del archivo de prueba, en el disco donde van a quedar los temporales
+ * @param B tamaño de bloque en bytes
+ * @param dispositivo forma de leer los bloques
+ * @param bytes tamaño del archivo de prueba
+ * @return calibracion medida; si no se pudo crear el archivo, costos iguales por bloque
+ */
+CalibracionDispositivo calibrarDispositivo(const std::string& archivo_prueba, size_t B, TipoDispositivo dispositivo,
+                                           size_t bytes = 16 * 1024 * 1024);
+
+/**
+ * Predice el I/O del mergesort con runs por ventanas sin comprimir, siguiendo las mismas reglas que el codigo: runs de
+ * M bytes, las mezclas intermedias de planificarMezclas por rondas, los niveles que planificarEncadenamiento deja
+ * en el pipeline y la mezcla final (particionada si hay hilos y no hay niveles encadenados)
+ * @param parametros tamaño de la entrada, memoria, bloque y registro
+ * @param a aridad
+ * @param calibracion costos del dispositivo para estimar el tiempo
+ */
+PrediccionIO predecirMergesort(const ParametrosCosto& parametros, size_t a, const CalibracionDispositivo& calibracion);
+
+/**
+ * Predice el I/O del quicksort. Cada archivo que no cabe en memoria se particiona en las partes que indica
+ * planificarMuestreo, con los bloques de su muestra; como los pivotes sobremuestreados dejan particiones casi
+ * parejas, se suponen iguales
+ * @param parametros tamaño de la entrada, memoria, bloque y registro
+ * @param a aridad
+ * @param calibracion costos del dispositivo para estimar el tiempo
+ */
+PrediccionIO predecirQuicksort(const ParametrosCosto& parametros, size_t a, const CalibracionDispositivo& calibracion);
+
+/**
+ * Recorre las aridades de [a_min, a_max] con el modelo y elige la de menor tiempo estimado; los empates se resuelven
+ * por menos bloques y luego por la aridad menor. No ordena nada, toma milisegundos
+ * @param algoritmo algoritmo a modelar
+ * @param parametros tamaño de la entrada, memoria, bloque y registro
+ * @param calibracion costos del dispositivo
+ * @param a_min menor aridad a probar, al menos 2
+ * @param a_max mayor aridad a probar
+ */
+EleccionAridad elegirAridad(AlgoritmoExterno algoritmo, const ParametrosCosto& parametros,
+                            const CalibracionDispositivo& calibracion, size_t a_min, size_t a_max);
+
+#endif // MODELO_COSTOS_H
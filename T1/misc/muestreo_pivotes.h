@@ -0,0 +1,54 @@
+#ifndef MUESTREO_PIVOTES_H
+#define MUESTREO_PIVOTES_H
+
+#include <algorithm>
+#include <cstddef>
+
+// Muestras por particion con que se eligen los pivotes del quicksort si no se configura otro factor
+constexpr size_t SOBREMUESTREO_PIVOTES = 32;
+
+/**
+ * Cuantas particiones se hacen de un archivo y cuanto se lee para elegir sus pivotes
+ */
+struct PlanMuestreo {
+    size_t particiones = 1;  // Particiones del archivo, los pivotes son una menos
+    size_t muestras = 0;     // Claves de la muestra
+    size_t bloques = 0;      // Bloques distintos, al azar, de donde salen las muestras
+};
+
+/**
+ * Planifica el muestreo de pivotes de un archivo que no cabe en memoria. Las particiones son las justas para que
+ * cada una espere a lo mas la mitad de la capacidad, sin pasar de 'a': asi una particion que salio mas grande de lo
+ * previsto se vuelve a particionar en pocas partes, con buffers mas grandes, en vez de en 'a'.
+ *
+ * La muestra tiene 'sobremuestreo' claves por particion y los pivotes son sus cuantiles equiespaciados. Con f claves
+ * por particion independientes, una particion supera el doble de su tamaño esperado solo si un tramo de ese largo
+ * recibe menos de f muestras cuando espera 2f; por la cota de Chernoff eso pasa con probabilidad a lo mas e^(-f/4)
+ * por tramo (3e-4 con f = 32). Lo ideal es una muestra por bloque, pero eso costaria casi otra pasada: se leen
+ * 4 bloques por particion o 1/64 de los bloques, lo que sea mayor, y se toman varias claves al azar de cada uno.
+ * Los 4 bloques por particion evitan que en una entrada ordenada o por tramos la muestra se concentre en pocas
+ * zonas del archivo
+ * @param elementos registros del archivo
+ * @param capacidad registros que caben en memoria
+ * @param a aridad maxima
+ * @param por_bloque registros por bloque
+ * @param sobremuestreo muestras por particion, al menos 1
+ */
+inline PlanMuestreo planificarMuestreo(size_t elementos, size_t capacidad, size_t a, size_t por_bloque,
+                                       size_t sobremuestreo = SOBREMUESTREO_PIVOTES) {
+    PlanMuestreo plan;
+    if (elementos == 0) return plan;
+    capacidad = std::max<size_t>(capacidad, 2);
+    por_bloque = std::max<size_t>(por_bloque, 1);
+    size_t necesarias = (2 * elementos + capacidad - 1) / capacidad;
+    plan.particiones = std::max<size_t>(std::min(std::max<size_t>(a, 2), necesarias), 2);
+
+    size_t total_bloques = (elementos + por_bloque - 1) / por_bloque;
+    plan.muestras = std::min(elementos, plan.particiones * std::max<size_t>(sobremuestreo, 1));
+    size_t minimo = (plan.muestras + por_bloque - 1) / por_bloque;
+    plan.bloques = std::min(plan.muestras, std::max({minimo, 4 * plan.particiones, total_bloques / 64}));
+    plan.bloques = std::max<size_t>(std::min(plan.bloques, total_bloques), 1);
+    return plan;
+}
+
+#endif // MUESTREO_PIVOTES_H
@@ -0,0 +1,175 @@
+#include "ordenamiento_paralelo.h"
+#include "../mergesort/arbol_perdedores.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Lee hasta 'cantidad' elementos en 'destino' por tramos
+ * @return elementos leídos, menor a 'cantidad' solo si la entrada se acabó
+ */
+template <typename T>
+static size_t leerPorTramos(T* destino, size_t cantidad, size_t elementos_por_tramo, const LectorTramos<T>& leer) {
+    size_t leidos = 0;
+    while (leidos < cantidad) {
+        size_t r = leer(destino + leidos, std::min(elementos_por_tramo, cantidad - leidos));
+        if (r == 0) break;
+        leidos += r;
+    }
+    return leidos;
+}
+
+/**
+ * Hilo escritor con dos buffers: uno se llena mientras el otro se escribe
+ */
+template <typename T>
+class EscritorDobleBuffer {
+private:
+    const EscritorTramos<T>& escribir;
+    std::vector<T> buffers[2];
+    size_t actual = 0;      // Buffer que se está llenando
+    size_t pos = 0;         // Elementos en el buffer actual
+    int entregado = -1;     // Buffer entregado al escritor, -1 si no hay
+    size_t cantidad_entregada = 0;
+    bool fin = false;
+    std::mutex mutex;
+    std::condition_variable cambio;
+    std::thread hilo;
+
+    void trabajar() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cambio.wait(lock, [this] { return entregado != -1 || fin; });
+            if (entregado == -1) return;
+            int indice = entregado;
+            size_t cantidad = cantidad_entregada;
+            lock.unlock();
+            escribir(buffers[indice].data(), cantidad);
+            lock.lock();
+            entregado = -1;
+            cambio.notify_all();
+        }
+    }
+
+    void entregar() {
+        std::unique_lock<std::mutex> lock(mutex);
+        // Esperar que termine la escritura anterior, que usaba el otro buffer
+        cambio.wait(lock, [this] { return entregado == -1; });
+        entregado = static_cast<int>(actual);
+        cantidad_entregada = pos;
+        cambio.notify_all();
+        actual = 1 - actual;
+        pos = 0;
+    }
+
+public:
+    EscritorDobleBuffer(const EscritorTramos<T>& escritor, size_t elementos_por_tramo) : escribir(escritor) {
+        buffers[0].resize(elementos_por_tramo);
+        buffers[1].resize(elementos_por_tramo);
+        hilo = std::thread(&EscritorDobleBuffer::trabajar, this);
+    }
+
+    void agregar(const T& valor) {
+        buffers[actual][pos++] = valor;
+        if (pos == buffers[actual].size()) {
+            entregar();
+        }
+    }
+
+    /**
+     * Entrega el buffer parcial y espera que el escritor termine
+     */
+    void terminar() {
+        if (pos > 0) {
+            entregar();
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cambio.wait(lock, [this] { return entregado == -1; });
+            fin = true;
+        }
+        cambio.notify_all();
+        hilo.join();
+    }
+};
+
+template <typename T, typename Clave>
+size_t ordenarEnPipeline(T* datos, size_t n, size_t elementos_por_tramo, PoolHilos& pool,
+                         const LectorTramos<T>& leer, const EscritorTramos<T>& escribir,
+                         OrdenamientoMemoria algoritmo, size_t memoria_auxiliar) {
+    if (elementos_por_tramo == 0) elementos_por_tramo = 1;
+
+    // Buffer auxiliar de radix sort, solo si cabe en la memoria extra permitida
+    std::unique_ptr<T[]> auxiliar;
+    if (algoritmo == OrdenamientoMemoria::Radix && n > 0 && n <= memoria_auxiliar / sizeof(T)) {
+        auxiliar.reset(new (std::nothrow) T[n]);
+    }
+    T* aux = auxiliar.get();
+
+    // Sin hilos extra: leer, ordenar y escribir en secuencia
+    if (pool.tamano() == 0) {
+        size_t total = leerPorTramos(datos, n, elementos_por_tramo, leer);
+        ordenarArreglo<T, Clave>(datos, total, aux, algoritmo);
+        for (size_t pos = 0; pos < total; pos += elementos_por_tramo) {
+            escribir(datos + pos, std::min(elementos_por_tramo, total - pos));
+        }
+        return total;
+    }
+
+    // Etapa 1 y 2: leer el fragmento por partes alineadas a tramos, y ordenar cada parte en el pool
+    // mientras se lee la siguiente
+    size_t tramos = (n + elementos_por_tramo - 1) / elementos_por_tramo;
+    size_t num_partes = std::max<size_t>(1, std::min<size_t>(4 * pool.tamano(), tramos));
+    size_t elementos_por_parte = ((tramos + num_partes - 1) / num_partes) * elementos_por_tramo;
+
+    // El pool puede estar compartido con otros llamadores (las tareas del quicksort): se esperan solo las partes
+    // de esta llamada
+    GrupoTareas grupo(pool);
+    std::vector<std::pair<size_t, size_t>> partes; // [inicio, fin) de cada parte en 'datos'
+    size_t total = 0;
+    while (total < n) {
+        size_t inicio = total;
+        total += leerPorTramos(datos + inicio, std::min(elementos_por_parte, n - inicio), elementos_por_tramo, leer);
+        if (total == inicio) break;
+        partes.emplace_back(inicio, total);
+        // Cada parte usa el tramo del buffer auxiliar que corresponde a su rango de 'datos'
+        grupo.encolar([datos, aux, algoritmo, inicio, total]() {
+            ordenarArreglo<T, Clave>(datos + inicio, total - inicio, aux ? aux + inicio : nullptr, algoritmo);
+        });
+        if (total - inicio < std::min(elementos_por_parte, n - inicio)) break; // Fin de la entrada
+    }
+    grupo.esperar();
+
+    // Etapa 3: mezclar las partes ordenadas mientras el hilo escritor vacía los buffers de salida
+    ArbolPerdedores<T, MenorPorClave<T, Clave>> arbol(partes.size());
+    std::vector<size_t> posiciones(partes.size());
+    for (size_t i = 0; i < partes.size(); i++) {
+        posiciones[i] = partes[i].first;
+        arbol.fijarHoja(i, datos[posiciones[i]]);
+    }
+    arbol.construir();
+
+    EscritorDobleBuffer<T> escritor(escribir, elementos_por_tramo);
+    while (!arbol.vacio()) {
+        size_t i = arbol.ganador();
+        escritor.agregar(arbol.valorGanador());
+        if (++posiciones[i] < partes[i].second) {
+            arbol.reemplazarGanador(datos[posiciones[i]]);
+        } else {
+            arbol.agotarGanador();
+        }
+    }
+    escritor.terminar();
+    return total;
+}
+
+// Instancias para los tipos de registro soportados (registro.h)
+#define INSTANCIAR_PIPELINE(T) \
+    template size_t ordenarEnPipeline<T, ClaveRegistro<T>>(T*, size_t, size_t, PoolHilos&, const LectorTramos<T>&, \
+                                                           const EscritorTramos<T>&, OrdenamientoMemoria, size_t);
+PARA_CADA_REGISTRO(INSTANCIAR_PIPELINE)
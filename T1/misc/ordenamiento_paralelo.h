@@ -0,0 +1,46 @@
+#ifndef ORDENAMIENTO_PARALELO_H
+#define ORDENAMIENTO_PARALELO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "pool_hilos.h"
+#include "ordenamiento_radix.h"
+
+/**
+ * Lee los siguientes elementos de la entrada, como máximo 'cantidad', y retorna cuántos leyó (0 al final)
+ */
+template <typename T>
+using LectorTramos = std::function<size_t(T* destino, size_t cantidad)>;
+
+/**
+ * Escribe los siguientes 'cantidad' elementos en la salida
+ */
+template <typename T>
+using EscritorTramos = std::function<void(const T* origen, size_t cantidad)>;
+
+/**
+ * Ordena en memoria un fragmento de hasta 'n' elementos como un pipeline de tres etapas:
+ * el hilo que llama lee el fragmento por partes, cada parte se ordena en el pool apenas termina de leerse
+ * (mientras se lee la siguiente), y las partes ordenadas se mezclan hacia dos buffers de salida que un hilo
+ * escritor va vaciando mientras la mezcla continúa. Sin hilos en el pool se lee todo, se ordena y se escribe.
+ * La entrada y la salida se recorren en tramos de 'elementos_por_tramo' elementos.
+ * Con radix sort se reserva un buffer auxiliar de 'n' elementos; si no cabe en 'memoria_auxiliar' o no se puede
+ * reservar, las partes se ordenan con std::sort. Los registros se ordenan por la clave que entrega 'Clave'; esta
+ * instanciado para los mismos tipos que ordenarRadix.
+ * @param datos arreglo de al menos 'n' elementos donde se carga el fragmento
+ * @param n cantidad máxima de elementos a leer
+ * @param elementos_por_tramo elementos de cada lectura y escritura
+ * @param pool hilos que ordenan las partes; se puede compartir entre llamadas simultáneas, cada una espera solo sus partes
+ * @param leer lector secuencial de la entrada
+ * @param escribir escritor secuencial de la salida
+ * @param algoritmo algoritmo con que se ordena cada parte
+ * @param memoria_auxiliar bytes disponibles para el buffer auxiliar de radix sort
+ * @return cantidad de elementos ordenados y escritos
+ */
+template <typename T, typename Clave = ClaveRegistro<T>>
+size_t ordenarEnPipeline(T* datos, size_t n, size_t elementos_por_tramo, PoolHilos& pool,
+                         const LectorTramos<T>& leer, const EscritorTramos<T>& escribir,
+                         OrdenamientoMemoria algoritmo = OrdenamientoMemoria::Comparacion, size_t memoria_auxiliar = 0);
+
+#endif // ORDENAMIENTO_PARALELO_H
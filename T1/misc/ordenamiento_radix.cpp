@@ -0,0 +1,84 @@
+#include "ordenamiento_radix.h"
+#include <algorithm>
+#include <cstring>
+
+// Digitos de 11 bits: 6 pasadas con histogramas de 2048 entradas (16 KB por digito), que caben en cache L1
+static const int BITS_DIGITO = 11;
+static const size_t VALORES_DIGITO = size_t(1) << BITS_DIGITO;
+static const int PASADAS = (64 + BITS_DIGITO - 1) / BITS_DIGITO;
+
+// Bajo este tamaño el costo fijo de los histogramas supera al de std::sort
+static const size_t MINIMO_RADIX = 256;
+
+/**
+ * Clave sin signo con el mismo orden que el entero con signo: se invierte el bit de signo
+ */
+static inline uint64_t claveOrdenable(int64_t valor) {
+    return static_cast<uint64_t>(valor) ^ (uint64_t(1) << 63);
+}
+
+template <typename T, typename Clave>
+void ordenarRadix(T* datos, size_t n, T* auxiliar) {
+    Clave clave_de;
+    if (n < MINIMO_RADIX) {
+        std::sort(datos, datos + n, MenorPorClave<T, Clave>());
+        return;
+    }
+
+    // Histogramas de todos los digitos en una sola pasada
+    static_assert(PASADAS * BITS_DIGITO >= 64, "los digitos deben cubrir la clave completa");
+    size_t conteos[PASADAS][VALORES_DIGITO];
+    std::memset(conteos, 0, sizeof(conteos));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t clave = claveOrdenable(clave_de(datos[i]));
+        for (int p = 0; p < PASADAS; p++) {
+            conteos[p][(clave >> (p * BITS_DIGITO)) & (VALORES_DIGITO - 1)]++;
+        }
+    }
+
+    T* origen = datos;
+    T* destino = auxiliar;
+    for (int p = 0; p < PASADAS; p++) {
+        size_t* conteo = conteos[p];
+        int desplazamiento = p * BITS_DIGITO;
+
+        // Si todos los elementos tienen el mismo digito la pasada no cambia el orden
+        uint64_t digito_comun = (claveOrdenable(clave_de(origen[0])) >> desplazamiento) & (VALORES_DIGITO - 1);
+        if (conteo[digito_comun] == n) continue;
+
+        // Prefijos: posicion donde comienza cada valor del digito en el destino
+        size_t suma = 0;
+        for (size_t d = 0; d < VALORES_DIGITO; d++) {
+            size_t c = conteo[d];
+            conteo[d] = suma;
+            suma += c;
+        }
+
+        // Distribucion estable, conserva el orden de las pasadas anteriores
+        for (size_t i = 0; i < n; i++) {
+            const T& valor = origen[i];
+            destino[conteo[(claveOrdenable(clave_de(valor)) >> desplazamiento) & (VALORES_DIGITO - 1)]++] = valor;
+        }
+        std::swap(origen, destino);
+    }
+
+    // Con un numero impar de pasadas efectivas el resultado quedo en el buffer auxiliar
+    if (origen != datos) {
+        std::memcpy(static_cast<void*>(datos), origen, n * sizeof(T));
+    }
+}
+
+template <typename T, typename Clave>
+void ordenarArreglo(T* datos, size_t n, T* auxiliar, OrdenamientoMemoria algoritmo) {
+    if (algoritmo == OrdenamientoMemoria::Radix && auxiliar != nullptr) {
+        ordenarRadix<T, Clave>(datos, n, auxiliar);
+    } else {
+        std::sort(datos, datos + n, MenorPorClave<T, Clave>());
+    }
+}
+
+// Instancias para los tipos de registro soportados (registro.h)
+#define INSTANCIAR_ORDENAMIENTO(T) \
+    template void ordenarRadix<T, ClaveRegistro<T>>(T*, size_t, T*); \
+    template void ordenarArreglo<T, ClaveRegistro<T>>(T*, size_t, T*, OrdenamientoMemoria);
+PARA_CADA_REGISTRO(INSTANCIAR_ORDENAMIENTO)
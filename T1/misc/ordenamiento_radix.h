@@ -0,0 +1,39 @@
+#ifndef ORDENAMIENTO_RADIX_H
+#define ORDENAMIENTO_RADIX_H
+
+#include <cstddef>
+#include <cstdint>
+#include "registro.h"
+
+/**
+ * Algoritmo con que se ordenan en memoria los fragmentos que caben en M
+ */
+enum class OrdenamientoMemoria {
+    Comparacion, // std::sort, no usa memoria extra
+    Radix        // Radix sort LSD, necesita un buffer auxiliar del mismo tamaño que los datos
+};
+
+/**
+ * Radix sort LSD sobre la clave con signo de 64 bits de cada registro, con digitos de 11 bits (6 pasadas). Para que
+ * los negativos queden antes que los positivos, cada clave se compara con su bit de signo invertido. Los histogramas
+ * de todos los digitos se calculan en una sola pasada y se saltan las pasadas donde todos los elementos comparten el
+ * digito. Es estable: registros con la misma clave conservan su orden.
+ * Esta instanciado para los tipos de PARA_CADA_REGISTRO (registro.h) con ClaveRegistro.
+ * @param datos arreglo a ordenar, queda ordenado al terminar
+ * @param n cantidad de elementos
+ * @param auxiliar buffer de al menos 'n' elementos, su contenido se pierde
+ */
+template <typename T, typename Clave = ClaveRegistro<T>>
+void ordenarRadix(T* datos, size_t n, T* auxiliar);
+
+/**
+ * Ordena un arreglo por clave con el algoritmo pedido. Si se pide radix sort sin buffer auxiliar se usa std::sort
+ * @param datos arreglo a ordenar
+ * @param n cantidad de elementos
+ * @param auxiliar buffer de al menos 'n' elementos, o nullptr
+ * @param algoritmo algoritmo a usar
+ */
+template <typename T, typename Clave = ClaveRegistro<T>>
+void ordenarArreglo(T* datos, size_t n, T* auxiliar, OrdenamientoMemoria algoritmo);
+
+#endif // ORDENAMIENTO_RADIX_H
@@ -0,0 +1,88 @@
+#ifndef PLAN_BUFFERS_H
+#define PLAN_BUFFERS_H
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+/**
+ * Reparto de la memoria principal entre los flujos de una pasada (entradas que se leen y salidas que se escriben).
+ * Cada flujo recibe la misma cantidad de bloques completos, de modo que cada transferencia mueve varios bloques
+ * contiguos en vez de uno solo.
+ */
+struct PlanBuffers {
+    size_t B;                    // Tamaño de bloque en bytes
+    size_t M;                    // Memoria total disponible en bytes
+    size_t entradas;             // Número de flujos de lectura
+    size_t salidas;              // Número de flujos de escritura
+    size_t copias_entrada;       // Buffers por flujo de lectura (2 con doble buffer)
+    size_t copias_salida;        // Buffers por flujo de escritura
+    size_t bloques_por_buffer;   // Bloques de cada buffer, al menos 1
+
+    /**
+     * @return cantidad de elementos de tamaño 'tamano_elemento' en un buffer
+     */
+    size_t elementosPorBuffer(size_t tamano_elemento) const {
+        return bloques_por_buffer * (B / tamano_elemento);
+    }
+
+    /**
+     * @return bytes de cada transferencia
+     */
+    size_t bytesPorBuffer() const {
+        return bloques_por_buffer * B;
+    }
+
+    /**
+     * @return memoria total que ocupan los buffers del plan
+     */
+    size_t bytesUsados() const {
+        return (entradas * copias_entrada + salidas * copias_salida) * bytesPorBuffer();
+    }
+
+    /**
+     * @return descripcion legible del reparto, para reportar en la salida del programa
+     */
+    std::string describir() const {
+        std::ostringstream out;
+        out << entradas << " entrada(s) x " << copias_entrada << " buffer(s) + "
+            << salidas << " salida(s) x " << copias_salida << " buffer(s) de "
+            << bloques_por_buffer << " bloque(s) (" << bytesPorBuffer() << " bytes por transferencia), "
+            << bytesUsados() << " de " << M << " bytes usados";
+        return out.str();
+    }
+};
+
+/**
+ * Reparte M en partes iguales de bloques completos entre todos los buffers de una pasada
+ * @param M memoria disponible en bytes
+ * @param B tamaño de bloque en bytes
+ * @param entradas número de flujos de lectura
+ * @param salidas número de flujos de escritura
+ * @param copias_entrada buffers por flujo de lectura
+ * @param copias_salida buffers por flujo de escritura
+ * @return plan con el tamaño de buffer de cada flujo
+ */
+inline PlanBuffers planificarBuffers(size_t M, size_t B, size_t entradas, size_t salidas,
+                                     size_t copias_entrada = 1, size_t copias_salida = 1) {
+    PlanBuffers plan{B, M, entradas, salidas, copias_entrada, copias_salida, 1};
+    size_t total_buffers = entradas * copias_entrada + salidas * copias_salida;
+    if (total_buffers > 0 && B > 0) {
+        size_t bloques = M / (total_buffers * B);
+        plan.bloques_por_buffer = (bloques > 0) ? bloques : 1;
+    }
+    return plan;
+}
+
+/**
+ * Bloques de tamaño B que cuenta una transferencia de 'bytes' bytes. Una lectura que llega al fin del
+ * archivo sin datos cuenta como un acceso, igual que antes con bloques de a uno
+ * @param bytes bytes transferidos
+ * @param B tamaño de bloque en bytes
+ */
+inline size_t bloquesTransferidos(size_t bytes, size_t B) {
+    size_t bloques = (bytes + B - 1) / B;
+    return (bloques > 0) ? bloques : 1;
+}
+
+#endif // PLAN_BUFFERS_H
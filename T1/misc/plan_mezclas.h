@@ -0,0 +1,191 @@
+#ifndef PLAN_MEZCLAS_H
+#define PLAN_MEZCLAS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Mezcla intermedia de un plan. Las entradas se numeran con los runs primero: el indice i < runs es el run i, y
+ * runs + j es el resultado de la mezcla j del plan
+ */
+struct MezclaPlanificada {
+    std::vector<size_t> entradas;
+    uint64_t bytes;   // Tamaño del resultado
+    size_t ronda;     // 0 si solo mezcla runs; si no, una mas que la mayor ronda de sus entradas
+};
+
+/**
+ * Orden de las mezclas de un mergesort de costo minimo: las mezclas intermedias en el orden en que se planificaron
+ * (una mezcla siempre va despues de las que producen sus entradas) y las entradas de la mezcla final
+ */
+struct PlanMezclas {
+    size_t runs = 0;
+    std::vector<MezclaPlanificada> mezclas;
+    std::vector<size_t> final;   // Entradas de la mezcla final, a lo mas 'a'
+    size_t rondas = 0;           // Rondas de mezclas intermedias; las de una ronda son independientes
+    size_t niveles = 0;          // Mayor cantidad de veces que se reescribe un registro, contando la mezcla final
+    uint64_t bytes_runs = 0;     // Tamaño total de los runs
+    uint64_t bytes_movidos = 0;  // Bytes leidos mas escritos por todas las mezclas, incluida la final
+
+    /**
+     * @return descripcion legible del plan, para reportar antes de ejecutarlo
+     */
+    std::string describir() const {
+        std::ostringstream out;
+        out << runs << " run(s), " << mezclas.size() << " mezcla(s) intermedia(s) en " << rondas << " ronda(s), "
+            << final.size() << " entrada(s) en la mezcla final, " << niveles << " nivel(es), " << bytes_movidos
+            << " bytes movidos";
+        if (bytes_runs > 0) {
+            out << " (" << static_cast<double>(bytes_movidos) / (2.0 * bytes_runs) << " pasadas)";
+        }
+        return out.str();
+    }
+};
+
+/**
+ * Planifica las mezclas de un conjunto de runs con el arbol de Huffman de aridad 'a', que minimiza los bytes
+ * reescritos: siempre se mezclan los 'a' resultados mas chicos disponibles. Para que la mezcla final quede con
+ * exactamente 'a' entradas, la primera mezcla toma solo (runs - 2) mod (a - 1) + 2 runs, lo mismo que agregar runs
+ * vacios al arbol. Los empates se resuelven por el indice, asi el plan es el mismo para los mismos tamaños
+ * @param tamanos tamaño en bytes de cada run, en orden de creacion
+ * @param a aridad, al menos 2
+ * @return plan de mezclas; con a lo mas 'a' runs no hay mezclas intermedias
+ */
+inline PlanMezclas planificarMezclas(const std::vector<uint64_t>& tamanos, size_t a) {
+    PlanMezclas plan;
+    a = std::max<size_t>(a, 2);
+    plan.runs = tamanos.size();
+    std::vector<size_t> profundidad(tamanos.size(), 0); // Veces que ya se reescribio cada entrada
+    std::vector<size_t> ronda(tamanos.size(), 0);
+    for (uint64_t bytes : tamanos) {
+        plan.bytes_runs += bytes;
+    }
+
+    using Entrada = std::pair<uint64_t, size_t>; // Tamaño e indice
+    std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> disponibles;
+    for (size_t i = 0; i < tamanos.size(); i++) {
+        disponibles.push({tamanos[i], i});
+    }
+
+    size_t tomar = (tamanos.size() > a) ? (tamanos.size() - 2) % (a - 1) + 2 : 0;
+    while (disponibles.size() > a) {
+        MezclaPlanificada mezcla{{}, 0, 0};
+        size_t nivel = 0;
+        for (size_t k = 0; k < tomar; k++) {
+            Entrada entrada = disponibles.top();
+            disponibles.pop();
+            mezcla.entradas.push_back(entrada.second);
+            mezcla.bytes += entrada.first;
+            nivel = std::max(nivel, profundidad[entrada.second]);
+            if (entrada.second >= plan.runs) mezcla.ronda = std::max(mezcla.ronda, ronda[entrada.second] + 1);
+        }
+        std::sort(mezcla.entradas.begin(), mezcla.entradas.end());
+        plan.bytes_movidos += 2 * mezcla.bytes;
+        plan.rondas = std::max(plan.rondas, mezcla.ronda + 1);
+        disponibles.push({mezcla.bytes, plan.runs + plan.mezclas.size()});
+        profundidad.push_back(nivel + 1);
+        ronda.push_back(mezcla.ronda);
+        plan.mezclas.push_back(mezcla);
+        tomar = a;
+    }
+
+    // Lo que queda va a la mezcla final, en orden de indice
+    size_t nivel = 0;
+    while (!disponibles.empty()) {
+        plan.final.push_back(disponibles.top().second);
+        nivel = std::max(nivel, profundidad[disponibles.top().second]);
+        disponibles.pop();
+    }
+    std::sort(plan.final.begin(), plan.final.end());
+    if (plan.final.size() > 1) {
+        plan.bytes_movidos += 2 * plan.bytes_runs;
+        plan.niveles = nivel + 1;
+    } else {
+        plan.niveles = nivel;
+    }
+    return plan;
+}
+
+/**
+ * Mezclas intermedias que se encadenan con la mezcla final en vez de escribir su resultado: las de profundidad hasta
+ * 'niveles', contando como 1 a las que entregan directo a la final
+ */
+struct EncadenamientoMezclas {
+    size_t niveles = 0;             // 0 si no se encadena nada
+    size_t bloques_por_buffer = 0;  // Bloques de cada buffer de las mezclas encadenadas y de la final
+    std::vector<size_t> profundidad; // Profundidad de cada mezcla del plan
+    size_t archivos_final = 0;      // Entradas de la mezcla final que se leen de un archivo
+
+    /**
+     * @return true si la mezcla j del plan se encadena
+     */
+    bool encadenada(size_t j) const { return profundidad[j] <= niveles; }
+};
+
+/**
+ * Decide cuantos niveles del arbol de mezclas se ejecutan como un pipeline: cada mezcla encadenada entrega su salida
+ * a la mezcla de arriba por lotes en memoria, asi esos niveles cuestan CPU y no una pasada por disco. Todas las
+ * mezclas del pipeline corren a la vez y se reparten M: cada una necesita dos buffers por archivo que lee y dos de
+ * salida, y una entrada encadenada se consume desde los buffers de salida de la mezcla de abajo. Se agrega un nivel
+ * mientras cada buffer conserve al menos 'bloques_minimos' bloques; con menos, el posicionamiento entre tantas
+ * entradas intercaladas cuesta mas que la pasada que se ahorra
+ * @param plan plan de mezclas
+ * @param M memoria disponible en bytes
+ * @param B tamaño de bloque en bytes
+ * @param bytes_por_archivo memoria extra de cada archivo leido, por ejemplo el marco de un run comprimido
+ * @param bloques_minimos bloques minimos de cada buffer para encadenar un nivel
+ */
+inline EncadenamientoMezclas planificarEncadenamiento(const PlanMezclas& plan, size_t M, size_t B,
+                                                      size_t bytes_por_archivo = 0, size_t bloques_minimos = 8) {
+    EncadenamientoMezclas encadenamiento;
+    encadenamiento.profundidad.assign(plan.mezclas.size(), 0);
+    size_t maxima = 0;
+    for (size_t entrada : plan.final) {
+        if (entrada >= plan.runs) encadenamiento.profundidad[entrada - plan.runs] = 1;
+    }
+    for (size_t j = plan.mezclas.size(); j-- > 0;) {
+        maxima = std::max(maxima, encadenamiento.profundidad[j]);
+        for (size_t entrada : plan.mezclas[j].entradas) {
+            if (entrada >= plan.runs) encadenamiento.profundidad[entrada - plan.runs] = encadenamiento.profundidad[j] + 1;
+        }
+    }
+
+    encadenamiento.archivos_final = plan.final.size();
+    for (size_t niveles = 1; niveles <= maxima; niveles++) {
+        // Un archivo es un run o el resultado de una mezcla que queda por debajo del pipeline
+        auto es_archivo = [&](size_t entrada) {
+            return entrada < plan.runs || encadenamiento.profundidad[entrada - plan.runs] > niveles;
+        };
+        size_t archivos_final = 0;
+        for (size_t entrada : plan.final) {
+            archivos_final += es_archivo(entrada) ? 1 : 0;
+        }
+        size_t archivos = archivos_final;
+        size_t buffers = 2 * archivos_final + 2;
+        for (size_t j = 0; j < plan.mezclas.size(); j++) {
+            if (encadenamiento.profundidad[j] > niveles) continue;
+            size_t propios = 0;
+            for (size_t entrada : plan.mezclas[j].entradas) {
+                propios += es_archivo(entrada) ? 1 : 0;
+            }
+            archivos += propios;
+            buffers += 2 * propios + 2;
+        }
+        size_t extra = archivos * bytes_por_archivo;
+        size_t bloques = (M > extra) ? (M - extra) / (buffers * B) : 0;
+        if (bloques < bloques_minimos) break;
+        encadenamiento.niveles = niveles;
+        encadenamiento.bloques_por_buffer = bloques;
+        encadenamiento.archivos_final = archivos_final;
+    }
+    return encadenamiento;
+}
+
+#endif // PLAN_MEZCLAS_H
@@ -0,0 +1,136 @@
+#ifndef PLANIFICADOR_TAREAS_H
+#define PLANIFICADOR_TAREAS_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Planificador de tareas con robo de trabajo. Cada hilo tiene su cola: lo que lanza una tarea queda en la cola de
+ * su hilo, que toma primero lo último que se lanzó (el recorrido va en profundidad y quedan pocos temporales a
+ * medio consumir), y un hilo sin trabajo le roba a otro la tarea más antigua, que suele ser la más grande.
+ * A diferencia de PoolHilos, las tareas pueden lanzar tareas. Se espera que sean gruesas (leer y escribir varios
+ * bloques), por lo que un solo mutex protege todas las colas sin que la contención se note.
+ * Con 0 hilos cada tarea se ejecuta en el hilo que la lanza, igual que una llamada recursiva.
+ */
+class PlanificadorTareas {
+private:
+    std::vector<std::thread> hilos;
+    std::vector<std::deque<std::function<void()>>> colas; // Una por hilo
+    std::mutex mutex;
+    std::condition_variable hay_trabajo;
+    std::condition_variable sin_pendientes;
+    size_t encoladas = 0;    // Tareas en alguna cola
+    size_t pendientes = 0;   // Tareas encoladas o en ejecucion
+    size_t siguiente = 0;    // Cola donde quedan las tareas lanzadas desde fuera del planificador
+    bool terminar = false;
+
+    // Planificador y cola del hilo actual, para que una tarea lance en su propia cola
+    static PlanificadorTareas*& planificadorDelHilo() {
+        static thread_local PlanificadorTareas* planificador = nullptr;
+        return planificador;
+    }
+    static size_t& colaDelHilo() {
+        static thread_local size_t cola = 0;
+        return cola;
+    }
+
+    // Con el mutex tomado y al menos una tarea encolada: la última de la cola propia o la primera de otra
+    std::function<void()> tomar(size_t propia) {
+        std::deque<std::function<void()>>* cola = &colas[propia];
+        for (size_t k = 1; cola->empty() && k < colas.size(); k++) {
+            cola = &colas[(propia + k) % colas.size()];
+        }
+        std::function<void()> tarea;
+        if (cola == &colas[propia]) {
+            tarea = std::move(cola->back());
+            cola->pop_back();
+        } else {
+            tarea = std::move(cola->front());
+            cola->pop_front();
+        }
+        encoladas--;
+        return tarea;
+    }
+
+    void trabajar(size_t indice) {
+        planificadorDelHilo() = this;
+        colaDelHilo() = indice;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            hay_trabajo.wait(lock, [this] { return terminar || encoladas > 0; });
+            if (encoladas == 0) return;
+            std::function<void()> tarea = tomar(indice);
+            lock.unlock();
+            tarea();
+            tarea = nullptr;
+            lock.lock();
+            if (--pendientes == 0) sin_pendientes.notify_all();
+        }
+    }
+
+public:
+    /**
+     * Crea los hilos
+     * @param num_hilos cantidad de hilos trabajadores
+     */
+    explicit PlanificadorTareas(unsigned num_hilos) : colas(num_hilos) {
+        for (unsigned i = 0; i < num_hilos; i++) {
+            hilos.emplace_back(&PlanificadorTareas::trabajar, this, i);
+        }
+    }
+
+    ~PlanificadorTareas() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            terminar = true;
+        }
+        hay_trabajo.notify_all();
+        for (auto& hilo : hilos) {
+            hilo.join();
+        }
+    }
+
+    PlanificadorTareas(const PlanificadorTareas&) = delete;
+    PlanificadorTareas& operator=(const PlanificadorTareas&) = delete;
+
+    /**
+     * Lanza una tarea; desde una tarea queda en la cola del mismo hilo y desde fuera se reparte por turnos
+     * @param tarea funcion a ejecutar en algun hilo del planificador
+     */
+    void lanzar(std::function<void()> tarea) {
+        if (hilos.empty()) {
+            tarea();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t cola = (planificadorDelHilo() == this) ? colaDelHilo() : siguiente++ % colas.size();
+            colas[cola].push_back(std::move(tarea));
+            encoladas++;
+            pendientes++;
+        }
+        hay_trabajo.notify_one();
+    }
+
+    /**
+     * Bloquea hasta que terminen todas las tareas, incluidas las que lancen mientras tanto. No se debe llamar
+     * desde una tarea
+     */
+    void esperarTodas() {
+        std::unique_lock<std::mutex> lock(mutex);
+        sin_pendientes.wait(lock, [this] { return pendientes == 0; });
+    }
+
+    /**
+     * @return cantidad de hilos trabajadores
+     */
+    unsigned tamano() const {
+        return static_cast<unsigned>(hilos.size());
+    }
+};
+
+#endif // PLANIFICADOR_TAREAS_H
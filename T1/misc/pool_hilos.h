@@ -0,0 +1,156 @@
+#ifndef POOL_HILOS_H
+#define POOL_HILOS_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Grupo fijo de hilos que ejecuta tareas desde una cola compartida.
+ * Con 0 hilos las tareas se ejecutan en el mismo hilo que las encola.
+ */
+class PoolHilos {
+private:
+    std::vector<std::thread> hilos;
+    std::deque<std::function<void()>> cola;
+    std::mutex mutex;
+    std::condition_variable hay_trabajo;
+    std::condition_variable sin_pendientes;
+    size_t pendientes = 0;   // Tareas encoladas o en ejecucion
+    bool terminar = false;
+
+    void trabajar() {
+        while (true) {
+            std::function<void()> tarea;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                hay_trabajo.wait(lock, [this] { return terminar || !cola.empty(); });
+                if (cola.empty()) return;
+                tarea = std::move(cola.front());
+                cola.pop_front();
+            }
+            tarea();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pendientes--;
+            }
+            sin_pendientes.notify_all();
+        }
+    }
+
+public:
+    /**
+     * Crea el grupo de hilos
+     * @param num_hilos cantidad de hilos trabajadores
+     */
+    explicit PoolHilos(unsigned num_hilos) {
+        for (unsigned i = 0; i < num_hilos; i++) {
+            hilos.emplace_back(&PoolHilos::trabajar, this);
+        }
+    }
+
+    ~PoolHilos() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            terminar = true;
+        }
+        hay_trabajo.notify_all();
+        for (auto& hilo : hilos) {
+            hilo.join();
+        }
+    }
+
+    PoolHilos(const PoolHilos&) = delete;
+    PoolHilos& operator=(const PoolHilos&) = delete;
+
+    /**
+     * Agrega una tarea a la cola
+     * @param tarea funcion a ejecutar en algun hilo del grupo
+     */
+    void encolar(std::function<void()> tarea) {
+        if (hilos.empty()) {
+            tarea();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cola.push_back(std::move(tarea));
+            pendientes++;
+        }
+        hay_trabajo.notify_one();
+    }
+
+    /**
+     * Bloquea hasta que todas las tareas encoladas hayan terminado
+     */
+    void esperarTodas() {
+        std::unique_lock<std::mutex> lock(mutex);
+        sin_pendientes.wait(lock, [this] { return pendientes == 0; });
+    }
+
+    /**
+     * @return cantidad de hilos trabajadores
+     */
+    unsigned tamano() const {
+        return static_cast<unsigned>(hilos.size());
+    }
+};
+
+/**
+ * Tareas de un PoolHilos que se esperan juntas. A diferencia de PoolHilos::esperarTodas, esperar solo bloquea hasta
+ * que terminen las tareas encoladas por este grupo, así varios llamadores que comparten el pool no se esperan entre
+ * sí. El destructor espera las tareas que queden.
+ */
+class GrupoTareas {
+private:
+    PoolHilos& pool;
+    std::mutex mutex;
+    std::condition_variable terminaron;
+    size_t pendientes = 0;   // Tareas del grupo encoladas o en ejecucion
+
+public:
+    explicit GrupoTareas(PoolHilos& pool) : pool(pool) {}
+
+    ~GrupoTareas() { esperar(); }
+
+    GrupoTareas(const GrupoTareas&) = delete;
+    GrupoTareas& operator=(const GrupoTareas&) = delete;
+
+    /**
+     * Encola una tarea del grupo en el pool
+     * @param tarea funcion a ejecutar en algun hilo del pool
+     */
+    void encolar(std::function<void()> tarea) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pendientes++;
+        }
+        pool.encolar([this, tarea = std::move(tarea)]() {
+            tarea();
+            // Se avisa con el mutex tomado: al soltarlo el grupo ya se puede destruir
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pendientes == 0) terminaron.notify_all();
+        });
+    }
+
+    /**
+     * Bloquea hasta que terminen las tareas encoladas por este grupo
+     */
+    void esperar() {
+        std::unique_lock<std::mutex> lock(mutex);
+        terminaron.wait(lock, [this] { return pendientes == 0; });
+    }
+};
+
+/**
+ * @return cantidad de hilos de hardware, al menos 1
+ */
+inline unsigned hilosDisponibles() {
+    unsigned n = std::thread::hardware_concurrency();
+    return (n > 0) ? n : 1;
+}
+
+#endif // POOL_HILOS_H
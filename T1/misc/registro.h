@@ -0,0 +1,58 @@
+#ifndef REGISTRO_H
+#define REGISTRO_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Registro de tamaño fijo con una clave de 64 bits al inicio y el resto de carga util. Los archivos de registros
+ * son arreglos contiguos, sin relleno entre registros.
+ * @tparam Bytes tamaño total del registro, mayor a 8
+ */
+template <size_t Bytes>
+struct RegistroFijo {
+    static_assert(Bytes > sizeof(int64_t), "el registro debe tener carga util ademas de la clave");
+    int64_t clave;
+    unsigned char carga[Bytes - sizeof(int64_t)];
+};
+
+/**
+ * Tipos de registro con que se instancian los ordenamientos. Cada .cpp define una macro que instancia lo suyo para
+ * un tipo y la aplica a todos con PARA_CADA_REGISTRO(MACRO), asi un tamaño nuevo se agrega solo aqui.
+ * RegistroFijo<24> no divide a un bloque potencia de 2, lo que deja sin usar el resto de cada bloque
+ */
+#define PARA_CADA_REGISTRO(INSTANCIAR) \
+    INSTANCIAR(int64_t) \
+    INSTANCIAR(RegistroFijo<16>) \
+    INSTANCIAR(RegistroFijo<24>) \
+    INSTANCIAR(RegistroFijo<32>) \
+    INSTANCIAR(RegistroFijo<64>)
+
+/**
+ * Extractor de la clave de 64 bits por la que se ordena un registro
+ */
+template <typename T>
+struct ClaveRegistro {
+    int64_t operator()(const T& registro) const { return registro.clave; }
+};
+
+/**
+ * Un int64_t es su propia clave
+ */
+template <>
+struct ClaveRegistro<int64_t> {
+    int64_t operator()(int64_t valor) const { return valor; }
+};
+
+/**
+ * Comparador de registros por su clave
+ */
+template <typename T, typename Clave = ClaveRegistro<T>>
+struct MenorPorClave {
+    bool operator()(const T& x, const T& y) const {
+        Clave clave;
+        return clave(x) < clave(y);
+    }
+};
+
+#endif // REGISTRO_H
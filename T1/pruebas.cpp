@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <dirent.h>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+#include "misc/clasificador_particiones.h"
+#include "misc/compresion_runs.h"
+#include "misc/mezcla_simd.h"
+#include "misc/ordenamiento_radix.h"
+#include "misc/plan_mezclas.h"
+#include "quicksort/quicksort_externo.h"
+using namespace std;
+
+/**
+ * Pruebas de los kernels en memoria (mezcla de dos secuencias, radix sort, marcos comprimidos, clasificador de
+ * particiones y plan de mezclas). Cada kernel se compara contra la version de la biblioteca estandar con datos al azar
+ * y con los valores extremos de int64_t, en cada nivel de instrucciones que soporta la CPU. No usan el disco; solo
+ * la prueba de flujos del quicksort escribe archivos chicos en el directorio actual y los borra.
+ */
+
+static int fallas = 0;
+static std::mt19937_64 generador(12345);
+
+/**
+ * Registra el resultado de un caso y reporta los que fallan
+ */
+static void verificar(bool condicion, const std::string& caso) {
+    if (!condicion) {
+        fallas++;
+        cout << "FALLA: " << caso << endl;
+    }
+}
+
+/**
+ * @return niveles de instrucciones soportados por la CPU, del escalar al mejor
+ */
+static std::vector<NivelSimd> nivelesDisponibles() {
+    std::vector<NivelSimd> niveles = {NivelSimd::Escalar};
+    if (nivelSimdDisponible() != NivelSimd::Escalar) niveles.push_back(NivelSimd::AVX2);
+    if (nivelSimdDisponible() == NivelSimd::AVX512) niveles.push_back(NivelSimd::AVX512);
+    return niveles;
+}
+
+/**
+ * Valores al azar; con 'extremos' la mitad sale de un conjunto chico con INT64_MIN, INT64_MAX y sus vecinos, para
+ * forzar empates y el borde del cambio de signo
+ */
+static std::vector<int64_t> valoresAlAzar(size_t n, bool extremos) {
+    const int64_t minimo = std::numeric_limits<int64_t>::min();
+    const int64_t maximo = std::numeric_limits<int64_t>::max();
+    const int64_t especiales[] = {minimo, minimo + 1, -1, 0, 1, maximo - 1, maximo};
+    std::vector<int64_t> valores(n);
+    for (auto& valor : valores) {
+        valor = static_cast<int64_t>(generador());
+        if (extremos && generador() % 2 == 0) valor = especiales[generador() % 7];
+    }
+    return valores;
+}
+
+/**
+ * mezclarDos contra std::merge, con una salida de capacidad chica al azar para que la mezcla se corte y se retome
+ * con vectores a medio consumir
+ */
+static void probarMezcla() {
+    for (NivelSimd nivel : nivelesDisponibles()) {
+        for (int caso = 0; caso < 400; caso++) {
+            std::vector<int64_t> a = valoresAlAzar(generador() % 300, caso % 2 == 0);
+            std::vector<int64_t> b = valoresAlAzar(generador() % 300, caso % 2 == 0);
+            std::sort(a.begin(), a.end());
+            std::sort(b.begin(), b.end());
+            std::vector<int64_t> esperado(a.size() + b.size());
+            std::merge(a.begin(), a.end(), b.begin(), b.end(), esperado.begin());
+
+            std::vector<int64_t> salida(esperado.size());
+            size_t ia = 0, ib = 0, is = 0;
+            while (ia < a.size() && ib < b.size()) {
+                size_t capacidad = std::min(salida.size(), is + 1 + generador() % 40);
+                mezclarDos(a.data(), ia, a.size(), b.data(), ib, b.size(), salida.data(), is, capacidad, nivel);
+            }
+            // Lo que queda de la entrada que no se agoto va tal cual
+            while (ia < a.size()) salida[is++] = a[ia++];
+            while (ib < b.size()) salida[is++] = b[ib++];
+            verificar(is == esperado.size() && salida == esperado,
+                      std::string("mezcla ") + nombreNivelSimd(nivel) + " caso " + std::to_string(caso));
+        }
+    }
+}
+
+/**
+ * Estabilidad de ordenarRadix con registros: la carga guarda la posicion original
+ */
+template <typename Registro>
+static void probarRadixEstable(const std::string& nombre) {
+    std::vector<Registro> registros(20000);
+    std::vector<int64_t> claves = valoresAlAzar(registros.size(), true);
+    for (size_t i = 0; i < registros.size(); i++) {
+        registros[i].clave = claves[i];
+        uint64_t posicion = i;
+        memcpy(registros[i].carga, &posicion, sizeof(posicion));
+    }
+    std::vector<Registro> esperado = registros;
+    std::stable_sort(esperado.begin(), esperado.end(), MenorPorClave<Registro>());
+    std::vector<Registro> auxiliar(registros.size());
+    ordenarRadix(registros.data(), registros.size(), auxiliar.data());
+    bool iguales = true;
+    for (size_t i = 0; i < registros.size(); i++) {
+        iguales = iguales && memcmp(&registros[i], &esperado[i], sizeof(Registro)) == 0;
+    }
+    verificar(iguales, "radix estable " + nombre);
+}
+
+/**
+ * ordenarRadix contra std::sort para int64_t y contra std::stable_sort para registros con claves repetidas,
+ * tambien de un tamaño que no divide al bloque
+ */
+static void probarRadix() {
+    for (size_t n : {0, 1, 2, 100, 5000, 70000}) {
+        for (bool extremos : {false, true}) {
+            std::vector<int64_t> datos = valoresAlAzar(n, extremos);
+            std::vector<int64_t> esperado = datos;
+            std::vector<int64_t> auxiliar(n);
+            std::sort(esperado.begin(), esperado.end());
+            ordenarRadix(datos.data(), n, auxiliar.data());
+            verificar(datos == esperado, "radix int64_t n=" + std::to_string(n));
+        }
+    }
+    probarRadixEstable<RegistroFijo<16>>("RegistroFijo<16>");
+    probarRadixEstable<RegistroFijo<24>>("RegistroFijo<24>");
+}
+
+/**
+ * Marcos comprimidos: comprimir y descomprimir un run ordenado debe devolver los mismos valores, incluidas las
+ * diferencias que no caben en un int64_t (de INT64_MIN a INT64_MAX)
+ */
+static void probarCompresion() {
+    for (size_t B : {64, 512, 4096}) {
+        for (int caso = 0; caso < 60; caso++) {
+            std::vector<int64_t> valores = valoresAlAzar(1 + generador() % 20000, caso % 3 == 0);
+            if (caso % 3 == 1) {
+                // Run denso, con diferencias chicas
+                int64_t valor = static_cast<int64_t>(generador());
+                for (auto& v : valores) {
+                    valor += static_cast<int64_t>(generador() % 16);
+                    v = valor;
+                }
+            }
+            std::sort(valores.begin(), valores.end());
+
+            std::vector<unsigned char> bloque(B);
+            std::vector<int64_t> marco(maxElementosPorMarco(B));
+            std::vector<int64_t> recuperados;
+            size_t consumidos = 0;
+            bool marcos_validos = true;
+            while (consumidos < valores.size()) {
+                size_t guardados = comprimirMarco(valores.data() + consumidos, valores.size() - consumidos, bloque.data(), B);
+                marcos_validos = marcos_validos && guardados >= std::min(minElementosPorMarco(B), valores.size() - consumidos) &&
+                                 guardados <= maxElementosPorMarco(B);
+                size_t leidos = descomprimirMarco(bloque.data(), marco.data());
+                marcos_validos = marcos_validos && leidos == guardados;
+                recuperados.insert(recuperados.end(), marco.begin(), marco.begin() + leidos);
+                consumidos += guardados;
+            }
+            verificar(marcos_validos && recuperados == valores,
+                      "compresion B=" + std::to_string(B) + " caso " + std::to_string(caso));
+        }
+    }
+}
+
+/**
+ * ClasificadorParticiones contra upper_bound sobre los limites, con cantidades de limites que no completan el arbol
+ * (no son 2^h - 1) y claves iguales a los limites o en los extremos
+ */
+static void probarClasificador() {
+    for (NivelSimd nivel : nivelesDisponibles()) {
+        for (size_t cantidad = 0; cantidad <= 70; cantidad++) {
+            std::vector<int64_t> limites = valoresAlAzar(cantidad, cantidad % 2 == 0);
+            std::sort(limites.begin(), limites.end());
+            limites.erase(std::unique(limites.begin(), limites.end()), limites.end());
+            ClasificadorParticiones clasificador(limites, nivel);
+
+            std::vector<int64_t> claves = valoresAlAzar(1000 + generador() % 100, true);
+            for (size_t i = 0; i < limites.size(); i++) {
+                claves[generador() % claves.size()] = limites[i];
+            }
+            std::vector<uint32_t> salida(claves.size());
+            clasificador.clasificar(claves.data(), claves.size(), salida.data());
+
+            bool correcto = clasificador.particiones() == limites.size() + 1;
+            for (size_t i = 0; i < claves.size(); i++) {
+                size_t esperada = std::upper_bound(limites.begin(), limites.end(), claves[i]) - limites.begin();
+                correcto = correcto && salida[i] == esperada;
+            }
+            verificar(correcto, std::string("clasificador ") + nombreNivelSimd(nivel) + " con " +
+                                std::to_string(limites.size()) + " limites");
+        }
+    }
+}
+
+/**
+ * Costo del arbol de Huffman de aridad 'a' calculado aparte: se agregan runs vacios hasta que (runs - 1) sea
+ * multiplo de (a - 1) y se suman los tamaños de todas las mezclas
+ */
+static uint64_t costoHuffman(std::vector<uint64_t> tamanos, size_t a) {
+    while ((tamanos.size() - 1) % (a - 1) != 0) tamanos.push_back(0);
+    std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> disponibles(tamanos.begin(), tamanos.end());
+    uint64_t costo = 0;
+    while (disponibles.size() > 1) {
+        uint64_t mezcla = 0;
+        for (size_t k = 0; k < a; k++) {
+            mezcla += disponibles.top();
+            disponibles.pop();
+        }
+        costo += mezcla;
+        disponibles.push(mezcla);
+    }
+    return costo;
+}
+
+/**
+ * planificarMezclas: cada run y cada mezcla intermedia se usan una sola vez, cada mezcla va despues de las que
+ * producen sus entradas, la final tiene a lo mas 'a' entradas y los bytes movidos son los del arbol de Huffman
+ */
+static void probarPlanMezclas() {
+    for (int caso = 0; caso < 300; caso++) {
+        size_t runs = 1 + generador() % 200;
+        size_t a = 2 + generador() % 20;
+        std::vector<uint64_t> tamanos(runs);
+        for (auto& t : tamanos) t = 1 + generador() % ((caso % 2 == 0) ? 1000000 : 10);
+        PlanMezclas plan = planificarMezclas(tamanos, a);
+
+        std::vector<int> usos(runs + plan.mezclas.size(), 0);
+        bool correcto = plan.final.size() <= a && plan.runs == runs;
+        for (size_t j = 0; j < plan.mezclas.size(); j++) {
+            uint64_t bytes = 0;
+            correcto = correcto && plan.mezclas[j].entradas.size() >= 2 && plan.mezclas[j].entradas.size() <= a;
+            for (size_t entrada : plan.mezclas[j].entradas) {
+                correcto = correcto && entrada < runs + j;
+                bytes += (entrada < runs) ? tamanos[entrada] : plan.mezclas[entrada - runs].bytes;
+                usos[entrada]++;
+            }
+            correcto = correcto && bytes == plan.mezclas[j].bytes;
+        }
+        for (size_t entrada : plan.final) {
+            usos[entrada]++;
+        }
+        for (int u : usos) {
+            correcto = correcto && u == 1;
+        }
+        uint64_t esperado = (runs > 1) ? 2 * costoHuffman(tamanos, a) : 0;
+        correcto = correcto && plan.bytes_movidos == esperado;
+        verificar(correcto, "plan de mezclas con " + std::to_string(runs) + " runs y a=" + std::to_string(a));
+    }
+}
+
+/**
+ * Dos flujos abiertos sobre el mismo QuicksortExterno y consumidos intercalados: cada uno debe entregar su archivo
+ * completo y ordenado, y al terminar no deben quedar temporales
+ */
+static void probarFlujosSimultaneos() {
+    const size_t n = 200000;
+    const std::string nombres[2] = {"prueba_flujo_a.bin", "prueba_flujo_b.bin"};
+    std::vector<int64_t> esperados[2];
+    for (int f = 0; f < 2; f++) {
+        esperados[f] = valoresAlAzar(n, f == 1);
+        FILE* archivo = fopen(nombres[f].c_str(), "wb");
+        fwrite(esperados[f].data(), sizeof(int64_t), n, archivo);
+        fclose(archivo);
+        std::sort(esperados[f].begin(), esperados[f].end());
+    }
+
+    // M de 256 KB: cada archivo se particiona al menos una vez
+    QuicksortExterno<> quicksort(4096, 256 * 1024, 8);
+    std::vector<int64_t> recibidos[2];
+    {
+        std::unique_ptr<FlujoOrdenado<int64_t>> flujos[2] = {quicksort.abrirFlujo(nombres[0]), quicksort.abrirFlujo(nombres[1])};
+        bool activos[2] = {flujos[0] != nullptr, flujos[1] != nullptr};
+        while (activos[0] || activos[1]) {
+            for (int f = 0; f < 2; f++) {
+                if (!activos[f]) continue;
+                const int64_t* lote = nullptr;
+                size_t cantidad = flujos[f]->siguienteLote(lote);
+                recibidos[f].insert(recibidos[f].end(), lote, lote + cantidad);
+                activos[f] = cantidad > 0;
+            }
+        }
+    }
+    for (int f = 0; f < 2; f++) {
+        verificar(recibidos[f] == esperados[f], "flujo simultaneo " + nombres[f]);
+    }
+
+    size_t sobrantes = 0;
+    if (DIR* directorio = opendir(".")) {
+        while (dirent* entrada = readdir(directorio)) {
+            sobrantes += (strstr(entrada->d_name, "prueba_flujo_") && strstr(entrada->d_name, ".temp_qsort")) ? 1 : 0;
+        }
+        closedir(directorio);
+    }
+    verificar(sobrantes == 0, "flujos simultaneos sin temporales sobrantes");
+    for (const auto& nombre : nombres) {
+        std::remove(nombre.c_str());
+    }
+}
+
+int main() {
+    cout << "Instrucciones disponibles: " << nombreNivelSimd(nivelSimdDisponible()) << endl;
+    probarMezcla();
+    probarRadix();
+    probarCompresion();
+    probarClasificador();
+    probarPlanMezclas();
+    probarFlujosSimultaneos();
+    if (fallas > 0) {
+        cout << fallas << " caso(s) fallaron" << endl;
+        return 1;
+    }
+    cout << "Todas las pruebas pasaron" << endl;
+    return 0;
+}
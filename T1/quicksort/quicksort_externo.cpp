@@ -1,380 +1,917 @@
-#include "quicksort_externo.h"
-#include <vector>
-#include <string>
-#include <algorithm> // Para std::sort, std::min, std::shuffle
-#include <cstdio>    // Para FILE*, fopen, fclose, fread, fwrite, fseek, ftell, remove
-#include <cstdlib>   // Para rand, srand
-#include <ctime>     // Para time
-#include <stdexcept> // Para std::runtime_error (opcional)
-#include <random>    // Para std::random_device, std::mt19937
-
-/**
- * Constructor de la clase QuicksortExterno.
- * @param block_size_bytes Tamaño del bloque de disco en bytes (B).
- * @param memory_size_bytes Tamaño de la memoria principal en bytes (M).
- * @param arity_a_val Aridad 'a', número de subarreglos en los que particionar.
- */
-QuicksortExterno::QuicksortExterno(size_t block_size_bytes, size_t memory_size_bytes, size_t arity_a_val)
-    : B_bytes(block_size_bytes), M_bytes(memory_size_bytes), arity_a(arity_a_val),
-      contador_io(0), temp_file_id_counter(0) {
-    this->num_pivots_to_select = (this->arity_a > 0) ? (this->arity_a - 1) : 0;
-
-    // Sembrar el generador de números aleatorios una vez
-    srand(static_cast<unsigned int>(time(nullptr)));
-}
-/**
- * Ordena un archivo binario de enteros de 64 bits usando Quicksort Externo.
- * @param archivo_entrada Ruta al archivo binario de entrada.
- * @param archivo_salida Ruta donde se guardará el archivo binario ordenado.
- */
-void QuicksortExterno::ordenar(const std::string& archivo_entrada, const std::string& archivo_salida) {
-    resetContadorIO();
-    temp_file_id_counter = 0; // Reiniciar para nombres de temp únicos por cada llamada a ordenar
-
-    size_t N_total_elements = get_num_elements_in_file(archivo_entrada);
-
-    if (N_total_elements == 0) {
-        // Si el archivo de entrada está vacío, crear un archivo de salida vacío.
-        FILE* out_empty = fopen(archivo_salida.c_str(), "wb");
-        if (out_empty) {
-            fclose(out_empty);
-        } else {
-            // Manejar error si no se puede crear el archivo de salida
-        }
-        return;
-    }
-    quicksort_recursivo(archivo_entrada, N_total_elements, archivo_salida);
-}
-
-/**
- * Metodo para obtener contador de I/O
- * @return El número total de operaciones de E/S (lectura/escritura de bloques) realizadas.
- */
-size_t QuicksortExterno::obtenerContadorIO() const {
-    return contador_io;
-}
-
-
-/**
- * Reinicia el contador de operaciones de E/S a cero.
- */
-void QuicksortExterno::resetContadorIO() {
-    contador_io = 0;
-}
-
-/**
- * Obtiene el número de elementos int64_t en un archivo binario.
- * @param file_name Nombre del archivo.
- * @return Número de elementos de 64 bits en el archivo.
- */
-size_t QuicksortExterno::get_num_elements_in_file(const std::string& file_name) {
-    FILE* file = fopen(file_name.c_str(), "rb");
-    if (!file) {
-        // std::cerr << "Error abriendo archivo para obtener tamaño: " << file_name << std::endl;
-        return 0; // O lanzar excepción
-    }
-    fseek(file, 0, SEEK_END);
-    long file_size_bytes = ftell(file);
-    fclose(file);
-
-    if (file_size_bytes <= 0) { // Igual a 0 para archivo vacío, negativo para error en ftell
-        return 0;
-    }
-    return static_cast<size_t>(file_size_bytes) / sizeof(int64_t);
-}
-
-/**
- * Genera un nombre único para un archivo temporal.
- * @return Nombre del archivo temporal.
- */
-std::string QuicksortExterno::generar_nombre_temporal() {
-    return "temp_qsort_" + std::to_string(temp_file_id_counter++) + ".bin";
-}
-
-
-/**
- * Ordena en memoria una partición que cabe completamente en la memoria principal.
- * Lee de 'input_filename', ordena y escribe en 'output_filename'.
- * @param input_filename nombre archivo a ordenar
- * @param num_elements numero de elementos en el archivo
- * @param output_filename nombre del archivo de salida
- */
-void QuicksortExterno::sort_in_memory_and_write(const std::string& input_filename, size_t num_elements, const std::string& output_filename) {
-    if (num_elements == 0) {
-        FILE* out_empty = fopen(output_filename.c_str(), "wb");
-        if (out_empty) fclose(out_empty);
-        return;
-    }
-
-    std::vector<int64_t> data_to_sort;
-    data_to_sort.reserve(num_elements);
-
-    FILE* in_file = fopen(input_filename.c_str(), "rb");
-    if (!in_file) { /* Manejar error */ return; }
-
-    size_t elements_per_B_block = B_bytes / sizeof(int64_t);
-    if (elements_per_B_block == 0) elements_per_B_block = 1; // Evitar división por cero si B es muy pequeño
-
-    std::vector<int64_t> read_buffer_vec(elements_per_B_block);
-    size_t elements_read_total = 0;
-
-    while (elements_read_total < num_elements) {
-        size_t elements_to_read_this_round = std::min(num_elements - elements_read_total, elements_per_B_block);
-        size_t actual_read = fread(read_buffer_vec.data(), sizeof(int64_t), elements_to_read_this_round, in_file);
-        contador_io++;
-        
-        if (actual_read > 0) {
-            data_to_sort.insert(data_to_sort.end(), read_buffer_vec.begin(), read_buffer_vec.begin() + actual_read);
-            elements_read_total += actual_read;
-        } else { // EOF o error
-            break;
-        }
-    }
-    fclose(in_file);
-
-    std::sort(data_to_sort.begin(), data_to_sort.end());
-
-    FILE* out_file = fopen(output_filename.c_str(), "wb");
-    if (!out_file) { /* Manejar error */ return; }
-    
-    size_t elements_written_total = 0;
-    while (elements_written_total < num_elements) {
-        size_t elements_to_write_this_round = std::min(num_elements - elements_written_total, elements_per_B_block);
-        fwrite(data_to_sort.data() + elements_written_total, sizeof(int64_t), elements_to_write_this_round, out_file);
-        contador_io++;
-        elements_written_total += elements_to_write_this_round;
-    }
-    fclose(out_file);
-}
-
-/**
- * Selecciona 'num_pivots_to_select' pivotes de un bloque aleatorio del archivo 'input_filename'.
- * @param input_filename Archivo del cual seleccionar pivotes.
- * @param num_elements_in_file Número total de elementos en 'input_filename'.
- * @return Vector con los pivotes seleccionados y ordenados.
- */
-std::vector<int64_t> QuicksortExterno::seleccionar_pivotes(const std::string& input_filename, size_t num_elements_in_file) {
-    if (num_pivots_to_select == 0 || num_elements_in_file == 0) {
-        return {};
-    }
-
-    FILE* file = fopen(input_filename.c_str(), "rb");
-    if (!file) return {}; // Manejar error
-
-    size_t elements_per_B_block = B_bytes / sizeof(int64_t);
-    if (elements_per_B_block == 0) elements_per_B_block = 1;
-
-    size_t num_total_blocks_in_file = (num_elements_in_file * sizeof(int64_t) + B_bytes - 1) / B_bytes;
-    if (num_total_blocks_in_file == 0 && num_elements_in_file > 0) num_total_blocks_in_file = 1; // Si es más pequeño que un bloque
-
-    size_t random_block_idx = 0;
-    if (num_total_blocks_in_file > 1) { // rand() % 1 can be problematic
-        random_block_idx = static_cast<size_t>(rand()) % num_total_blocks_in_file;
-    }
-    
-    fseek(file, random_block_idx * B_bytes, SEEK_SET);
-
-    std::vector<int64_t> block_elements_buffer(elements_per_B_block);
-    size_t elements_read_from_block = fread(block_elements_buffer.data(), sizeof(int64_t), elements_per_B_block, file);
-    contador_io++;
-    fclose(file);
-
-    if (elements_read_from_block == 0) {
-        return {}; // No se pudo leer nada
-    }
-    
-    // Redimensionar al tamaño real leído
-    block_elements_buffer.resize(elements_read_from_block);
-
-    std::vector<int64_t> pivots;
-    // Usar C++11 <random> para mejor aleatoriedad y selección
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(block_elements_buffer.begin(), block_elements_buffer.end(), g);
-
-    size_t count_to_pick = std::min(num_pivots_to_select, elements_read_from_block);
-    for (size_t i = 0; i < count_to_pick; ++i) {
-        pivots.push_back(block_elements_buffer[i]);
-    }
-
-    std::sort(pivots.begin(), pivots.end());
-    return pivots;
-}
-
-/**
- * Particiona 'input_filename' en 'arity_a' archivos temporales basado en los 'pivots'.
- * @param input_filename Archivo a particionar.
- * @param num_elements_total Número de elementos en 'input_filename'.
- * @param pivots Vector de pivotes ordenados.
- * @return Vector de pares, donde cada par contiene el nombre del archivo de partición temporal y el número de elementos que contiene.
- */
-std::vector<std::pair<std::string, size_t>> QuicksortExterno::particionar_archivo(
-    const std::string& input_filename,
-    size_t num_elements_total,
-    const std::vector<int64_t>& pivots) {
-
-    std::vector<std::pair<std::string, size_t>> partition_files_info;
-    std::vector<FILE*> out_files_ptr(arity_a, nullptr);
-    std::vector<std::string> temp_filenames(arity_a);
-    std::vector<size_t> elements_in_partition_count(arity_a, 0);
-    
-    // Búferes en memoria para cada partición antes de escribir al disco
-    std::vector<std::vector<int64_t>> partition_write_buffers(arity_a);
-    size_t elements_per_B_block_for_write = B_bytes / sizeof(int64_t);
-    if (elements_per_B_block_for_write == 0) elements_per_B_block_for_write = 1;
-
-
-    for (size_t i = 0; i < arity_a; ++i) {
-        temp_filenames[i] = generar_nombre_temporal();
-        out_files_ptr[i] = fopen(temp_filenames[i].c_str(), "wb");
-        if (!out_files_ptr[i]) { /* Manejar error: cerrar abiertos y limpiar */ }
-        partition_write_buffers[i].reserve(elements_per_B_block_for_write);
-    }
-
-    FILE* in_file = fopen(input_filename.c_str(), "rb");
-    if (!in_file) { /* Manejar error */ }
-
-    size_t elements_per_B_block_for_read = B_bytes / sizeof(int64_t);
-    if (elements_per_B_block_for_read == 0) elements_per_B_block_for_read = 1;
-    std::vector<int64_t> read_buffer_vec(elements_per_B_block_for_read);
-    size_t elements_processed = 0;
-
-    while (elements_processed < num_elements_total) {
-        size_t elements_to_read_this_block = std::min(elements_per_B_block_for_read, num_elements_total - elements_processed);
-        if (elements_to_read_this_block == 0) break;
-
-        size_t actual_read = fread(read_buffer_vec.data(), sizeof(int64_t), elements_to_read_this_block, in_file);
-        contador_io++;
-
-        if (actual_read == 0) { // EOF o error
-            break;
-        }
-
-        for (size_t i = 0; i < actual_read; ++i) {
-            int64_t current_element = read_buffer_vec[i];
-            size_t partition_idx = 0;
-            
-            // Determinar a qué partición pertenece el elemento
-            // pivots está ordenado: p_0, p_1, ..., p_{k-1} donde k = num_pivots_to_select
-            // Partición 0: elem < p_0
-            // Partición j: p_{j-1} <= elem < p_j
-            // Partición arity_a-1 (última): elem >= p_{k-1} (último pivote)
-            while (partition_idx < pivots.size() && current_element >= pivots[partition_idx]) {
-                partition_idx++;
-            }
-
-            partition_write_buffers[partition_idx].push_back(current_element);
-            elements_in_partition_count[partition_idx]++;
-
-            if (partition_write_buffers[partition_idx].size() == elements_per_B_block_for_write) {
-                fwrite(partition_write_buffers[partition_idx].data(), sizeof(int64_t), elements_per_B_block_for_write, out_files_ptr[partition_idx]);
-                contador_io++;
-                partition_write_buffers[partition_idx].clear();
-            }
-        }
-        elements_processed += actual_read;
-    }
-    fclose(in_file);
-
-    // Escribir los datos restantes en los búferes de partición
-    for (size_t i = 0; i < arity_a; ++i) {
-        if (!partition_write_buffers[i].empty()) {
-            fwrite(partition_write_buffers[i].data(), sizeof(int64_t), partition_write_buffers[i].size(), out_files_ptr[i]);
-            contador_io++; // Se cuenta como una E/S aunque sea parcial
-        }
-        fclose(out_files_ptr[i]);
-        partition_files_info.emplace_back(temp_filenames[i], elements_in_partition_count[i]);
-    }
-    return partition_files_info;
-}
-
-/**
- * Concatena una lista de archivos de entrada (ordenados) en un único archivo de salida.
- * @param nombres_archivos_entrada Vector de nombres de archivos a concatenar.
- * @param archivo_salida_final Nombre del archivo resultante de la concatenación.
- */
-void QuicksortExterno::concatenar_archivos(const std::vector<std::string>& nombres_archivos_entrada, const std::string& archivo_salida_final) {
-    FILE* out_final_file = fopen(archivo_salida_final.c_str(), "wb");
-    if (!out_final_file) { /* Manejar error */ return; }
-
-    size_t elements_per_B_block = B_bytes / sizeof(int64_t);
-    if (elements_per_B_block == 0) elements_per_B_block = 1;
-    std::vector<int64_t> buffer_vec(elements_per_B_block);
-
-    for (const std::string& nombre_entrada : nombres_archivos_entrada) {
-        FILE* in_sub_file = fopen(nombre_entrada.c_str(), "rb");
-        if (!in_sub_file) { /* Manejar error, quizás continuar con los demás? */ continue; }
-
-        while (true) {
-            size_t read_count = fread(buffer_vec.data(), sizeof(int64_t), elements_per_B_block, in_sub_file);
-            if (read_count > 0) {
-                contador_io++; // Contar lectura
-                fwrite(buffer_vec.data(), sizeof(int64_t), read_count, out_final_file);
-                contador_io++; // Contar escritura
-            }
-            if (read_count < elements_per_B_block) { // EOF o error
-                break;
-            }
-        }
-        fclose(in_sub_file);
-    }
-    fclose(out_final_file);
-}
-
-/**
- * Función principal recursiva de Quicksort Externo.
- * Ordena el archivo 'input_filename' que contiene 'num_elements' y escribe el resultado en 'output_filename'.
- * @param current_input_file nombre del archivo actual que se esta ordenando
- * @param num_elements_in_partition numero de elementos en esta particion
- * @param final_output_file_for_this_recursion nombre del archivo de salida final
- */
-void QuicksortExterno::quicksort_recursivo(const std::string& current_input_file, size_t num_elements_in_partition, const std::string& final_output_file_for_this_recursion) {
-    if (num_elements_in_partition == 0) {
-        FILE* out_empty = fopen(final_output_file_for_this_recursion.c_str(), "wb");
-        if (out_empty) fclose(out_empty);
-        // No es necesario eliminar current_input_file aquí si es el original, solo si es temp.
-        return;
-    }
-    
-    // Caso base: si la partición cabe en memoria principal (M_bytes)
-    size_t M_elements_capacity = M_bytes / sizeof(int64_t);
-    if (num_elements_in_partition <= M_elements_capacity) {
-        sort_in_memory_and_write(current_input_file, num_elements_in_partition, final_output_file_for_this_recursion);
-        return;
-    }
-
-    // Paso recursivo
-    // 1. Seleccionar pivotes
-    std::vector<int64_t> pivots = seleccionar_pivotes(current_input_file, num_elements_in_partition);
-
-    // 2. Particionar archivo
-    std::vector<std::pair<std::string, size_t>> partitions_info =
-        particionar_archivo(current_input_file, num_elements_in_partition, pivots);
-
-    std::vector<std::string> sorted_partition_files_temp_names;
-
-    // 3. Llamadas recursivas para cada partición
-    for (const auto& partition_pair : partitions_info) {
-        const std::string& temp_partition_file_raw = partition_pair.first;
-        size_t num_elements_in_temp_partition = partition_pair.second;
-
-        std::string temp_sorted_output_for_sub_problem = generar_nombre_temporal();
-        
-        if (num_elements_in_temp_partition > 0) {
-            quicksort_recursivo(temp_partition_file_raw, num_elements_in_temp_partition, temp_sorted_output_for_sub_problem);
-        } else { // Partición vacía
-            FILE* ef = fopen(temp_sorted_output_for_sub_problem.c_str(), "wb");
-            if (ef) fclose(ef);
-        }
-        sorted_partition_files_temp_names.push_back(temp_sorted_output_for_sub_problem);
-        remove(temp_partition_file_raw.c_str()); // Eliminar partición cruda (no ordenada)
-    }
-
-    // 4. Concatenar particiones ordenadas
-    concatenar_archivos(sorted_partition_files_temp_names, final_output_file_for_this_recursion);
-
-    // 5. Limpiar archivos temporales de particiones ordenadas
-    for (const std::string& sorted_temp_file : sorted_partition_files_temp_names) {
-        remove(sorted_temp_file.c_str());
-    }
-}
\ No newline at end of file
+#include "quicksort_externo.h"
+#include <vector>
+#include <string>
+#include <algorithm> // Para std::sort, std::min, std::swap
+#include <cstdio>    // Para remove
+#include <stdexcept> // Para std::runtime_error (opcional)
+#include <random>    // Para std::random_device, std::mt19937_64
+#include <iostream>  // Para std::cerr
+#include <sstream>   // Para la firma del manifiesto
+#include <atomic>    // Para numerar los flujos
+#include <unistd.h>  // Para getpid
+#include "../misc/ordenamiento_radix.h"
+#include "../misc/clasificador_particiones.h"
+
+/**
+ * Constructor de la clase QuicksortExterno.
+ * @param block_size_bytes Tamaño del bloque de disco en bytes (B).
+ * @param memory_size_bytes Tamaño de la memoria principal en bytes (M).
+ * @param arity_a_val Aridad 'a', máximo de subarreglos en los que particionar.
+ * @param dispositivo Forma de leer y escribir bloques (stdio, pread/pwrite, mmap u O_DIRECT).
+ */
+template <typename T, typename Clave>
+QuicksortExterno<T, Clave>::QuicksortExterno(size_t block_size_bytes, size_t memory_size_bytes, size_t arity_a_val, TipoDispositivo dispositivo)
+    : B_bytes(block_size_bytes), M_bytes(memory_size_bytes), arity_a(arity_a_val), dispositivo(dispositivo),
+      contador_io(0), gobernador_memoria(memory_size_bytes), heredado_invalido(false), error_io(false),
+      ordenamiento(OrdenamientoMemoria::Comparacion), memoria_auxiliar(0),
+      checkpoint(false), sobremuestreo(SOBREMUESTREO_PIVOTES), nivel_simd(nivelSimdDisponible()) {
+    this->plan_particion = planificarBuffers(M_bytes, B_bytes, 1, arity_a);
+    this->pool.reset(new PoolHilos(hilosDisponibles()));
+    this->planificador.reset(new PlanificadorTareas(hilosDisponibles()));
+}
+/**
+ * Ordena un archivo binario de enteros de 64 bits usando Quicksort Externo.
+ * Con checkpoint activado las particiones y los ordenamientos terminados se registran en archivo_salida + ".manifiesto",
+ * y una llamada interrumpida se retoma reutilizando los temporales registrados si la entrada y los parámetros no cambiaron.
+ * Un error de I/O detiene el ordenamiento (error_io) sin registrar la zona ni la partición que fallaron.
+ * @param archivo_entrada Ruta al archivo binario de entrada.
+ * @param archivo_salida Ruta donde se guardará el archivo binario ordenado.
+ */
+template <typename T, typename Clave>
+void QuicksortExterno<T, Clave>::ordenar(const std::string& archivo_entrada, const std::string& archivo_salida) {
+    resetContadorIO();
+
+    if (!abrirArchivoBloques(dispositivo, archivo_entrada, ModoApertura::Lectura)) {
+        std::cerr << "Error al abrir archivo de entrada: " << archivo_entrada << std::endl;
+        return;
+    }
+    size_t N_total_elements = get_num_elements_in_file(archivo_entrada);
+
+    if (N_total_elements == 0) {
+        // Si el archivo de entrada está vacío, crear un archivo de salida vacío.
+        if (!abrirArchivoBloques(dispositivo, archivo_salida, ModoApertura::Escritura)) {
+            std::cerr << "Error: No se pudo crear el archivo de salida " << archivo_salida << std::endl;
+        }
+        return;
+    }
+
+    if (checkpoint) {
+        std::ostringstream firma;
+        firma << "quicksort " << firmaArchivo(archivo_entrada) << " " << B_bytes << " " << M_bytes << " " << arity_a << " " << sizeof(T);
+        manifiesto.abrir(archivo_salida + ".manifiesto", firma.str());
+    }
+
+    error_io = false;
+    if (!quicksort_recursivo(archivo_entrada, N_total_elements, archivo_salida) && !error_io) {
+        // Un temporal o una zona de la salida heredados no coinciden con el manifiesto: se descarta lo anterior y se ordena desde cero
+        std::cerr << "Advertencia: el manifiesto no coincide con los archivos temporales o la salida, se ordena desde cero" << std::endl;
+        manifiesto.reiniciar();
+        quicksort_recursivo(archivo_entrada, N_total_elements, archivo_salida);
+    }
+    if (error_io) {
+        // Con checkpoint el manifiesto, las zonas terminadas y las particiones pendientes quedan para retomar;
+        // sin él la salida incompleta no sirve
+        std::cerr << "Error: se detiene el ordenamiento por un error de I/O" << std::endl;
+        if (!manifiesto.activo()) remove(archivo_salida.c_str());
+        manifiesto.soltar();
+        return;
+    }
+    manifiesto.cerrar();
+}
+
+/**
+ * Flujo sobre el resultado del quicksort. En vez de ordenar cada partición en un temporal y concatenarlas, guarda
+ * las particiones pendientes en una pila en orden de claves: al pedir un lote saca la primera, y si no cabe en
+ * memoria la particiona y apila sus partes; si cabe la carga, la ordena y la entrega completa como un lote.
+ * Así las particiones solo se ordenan cuando se llega a ellas y el resultado nunca se escribe. Las particiones de
+ * iguales ya están ordenadas y se entregan tal cual, de a lo más M.
+ */
+template <typename T, typename Clave>
+class FlujoQuicksort : public FlujoOrdenado<T> {
+private:
+    struct Pendiente {
+        std::string nombre;
+        size_t elementos;
+        bool temporal; // Indica si el archivo es una partición propia que se borra al usarla
+        bool ordenada; // Indica si es una partición de iguales, que se entrega sin ordenar
+        size_t desde;  // Registros ya entregados de una partición de iguales
+        std::string nodo; // Camino en el árbol de particiones, da nombre a sus partes
+    };
+
+    QuicksortExterno<T, Clave>& ordenador;
+    std::string prefijo;             // Nombre base de los temporales de este flujo, distinto para cada flujo
+    std::vector<Pendiente> pila;     // Particiones por consumir, la próxima al final
+    std::vector<T> datos;            // Partición ordenada que se está entregando
+    std::vector<T> auxiliar;         // Buffer de radix sort
+
+public:
+    FlujoQuicksort(QuicksortExterno<T, Clave>& ordenador, const std::string& archivo_entrada, size_t elementos,
+                   const std::string& prefijo)
+        : ordenador(ordenador), prefijo(prefijo) {
+        pila.push_back({archivo_entrada, elementos, false, false, 0, ""});
+    }
+
+    ~FlujoQuicksort() override {
+        for (const auto& pendiente : pila) {
+            if (pendiente.temporal) remove(pendiente.nombre.c_str());
+        }
+    }
+
+    size_t siguienteLote(const T*& lote) override {
+        const size_t capacidad = ordenador.M_bytes / sizeof(T);
+        while (!pila.empty()) {
+            Pendiente actual = pila.back();
+            pila.pop_back();
+
+            if (actual.ordenada) {
+                // Partición de iguales: se entrega tal cual, de a lo más 'capacidad' registros
+                std::unique_ptr<ArchivoBloques> archivo = abrirArchivoBloques(ordenador.dispositivo, actual.nombre, ModoApertura::Lectura);
+                size_t leidos = 0;
+                if (archivo && actual.desde < actual.elementos) {
+                    datos.resize(std::min(capacidad, actual.elementos - actual.desde));
+                    leidos = archivo->leer(datos.data(), datos.size() * sizeof(T), actual.desde * sizeof(T)) / sizeof(T);
+                    ordenador.contador_io += bloquesTransferidos(leidos * sizeof(T), ordenador.B_bytes);
+                }
+                archivo.reset();
+                if (leidos > 0 && actual.desde + leidos < actual.elementos) {
+                    actual.desde += leidos;
+                    pila.push_back(actual);
+                } else if (actual.temporal) {
+                    remove(actual.nombre.c_str());
+                }
+                if (leidos == 0) continue;
+                lote = datos.data();
+                return leidos;
+            }
+
+            if (actual.elementos > capacidad) {
+                // Particionar y apilar las partes, la de claves menores queda al final
+                std::vector<int64_t> pivots = ordenador.seleccionar_pivotes(actual.nombre, actual.elementos);
+                std::vector<uint64_t> partition_sums;
+                std::vector<bool> sorted_partitions;
+                std::vector<std::pair<std::string, size_t>> partitions_info =
+                    ordenador.particionar_archivo(actual.nombre, actual.elementos, pivots, partition_sums, sorted_partitions,
+                                                  prefijo, actual.nodo);
+                if (partitions_info.empty()) {
+                    // particionar_archivo ya informó el error: el flujo termina y el destructor borra lo pendiente
+                    pila.push_back(actual);
+                    return 0;
+                }
+                if (actual.temporal) remove(actual.nombre.c_str());
+                for (size_t i = partitions_info.size(); i-- > 0;) {
+                    pila.push_back({partitions_info[i].first, partitions_info[i].second, true, sorted_partitions[i], 0,
+                                    actual.nodo + "_" + std::to_string(i)});
+                }
+                continue;
+            }
+
+            // Cabe en memoria: cargar de a varios bloques, ordenar y entregar completa
+            std::unique_ptr<ArchivoBloques> archivo = abrirArchivoBloques(ordenador.dispositivo, actual.nombre, ModoApertura::Lectura);
+            size_t leidos = 0;
+            if (archivo && actual.elementos > 0) {
+                datos.resize(actual.elementos);
+                leidos = archivo->leer(datos.data(), actual.elementos * sizeof(T), 0) / sizeof(T);
+                ordenador.contador_io += bloquesTransferidos(leidos * sizeof(T), ordenador.B_bytes);
+            }
+            archivo.reset();
+            if (actual.temporal) remove(actual.nombre.c_str());
+            if (leidos == 0) continue;
+
+            T* buffer_auxiliar = nullptr;
+            if (ordenador.ordenamiento == OrdenamientoMemoria::Radix && leidos * sizeof(T) <= ordenador.memoria_auxiliar) {
+                auxiliar.resize(leidos);
+                buffer_auxiliar = auxiliar.data();
+            }
+            ordenarArreglo<T, Clave>(datos.data(), leidos, buffer_auxiliar, ordenador.ordenamiento);
+            lote = datos.data();
+            return leidos;
+        }
+        return 0;
+    }
+};
+
+/**
+ * Ordena un archivo sin escribir el resultado: las particiones se generan y se ordenan a medida que se consume
+ * el flujo, y cada partición ordenada se entrega directo desde memoria, sin la concatenación final.
+ * No usa el manifiesto de checkpoint.
+ * @param archivo_entrada Ruta al archivo binario de entrada.
+ * @return Flujo con los registros ordenados, o nullptr si no se pudo abrir la entrada.
+ */
+template <typename T, typename Clave>
+std::unique_ptr<FlujoOrdenado<T>> QuicksortExterno<T, Clave>::abrirFlujo(const std::string& archivo_entrada) {
+    if (!abrirArchivoBloques(dispositivo, archivo_entrada, ModoApertura::Lectura)) {
+        std::cerr << "Error: No se pudo abrir el archivo de entrada" << std::endl;
+        return nullptr;
+    }
+    resetContadorIO();
+    // Sin archivo de salida, los temporales se nombran por la entrada y un identificador del flujo, que cada flujo
+    // guarda para sí: varios flujos abiertos sobre el mismo ordenador no comparten temporales
+    static std::atomic<unsigned> flujos{0};
+    std::string prefijo = archivo_entrada + ".flujo_" + std::to_string(getpid()) + "_" + std::to_string(flujos++);
+    return std::unique_ptr<FlujoOrdenado<T>>(
+        new FlujoQuicksort<T, Clave>(*this, archivo_entrada, get_num_elements_in_file(archivo_entrada), prefijo));
+}
+
+/**
+ * Metodo para obtener contador de I/O
+ * @return El número total de operaciones de E/S (lectura/escritura de bloques) realizadas.
+ */
+template <typename T, typename Clave>
+size_t QuicksortExterno<T, Clave>::obtenerContadorIO() const {
+    return contador_io.load();
+}
+
+
+/**
+ * Obtiene el reparto de memoria usado en el último particionamiento.
+ * @return Plan de búferes de la última llamada a particionar_archivo.
+ */
+template <typename T, typename Clave>
+const PlanBuffers& QuicksortExterno<T, Clave>::obtenerPlanParticion() const {
+    return plan_particion;
+}
+
+/**
+ * Cambia la cantidad de hilos que ordenan las particiones que caben en memoria y de hilos que procesan los
+ * subproblemas en paralelo.
+ * @param hilos Hilos del pool y del planificador, con 0 se lee, ordena y escribe en secuencia y las particiones se
+ * procesan una tras otra.
+ */
+template <typename T, typename Clave>
+void QuicksortExterno<T, Clave>::updateHilos(unsigned hilos) {
+    pool.reset(new PoolHilos(hilos));
+    planificador.reset(new PlanificadorTareas(hilos));
+}
+
+/**
+ * Cambia el algoritmo que ordena las particiones que caben en memoria.
+ * @param algoritmo Comparacion (std::sort) o Radix.
+ * @param memoria_auxiliar Bytes extra permitidos para el buffer auxiliar de radix sort; si no alcanza se usa std::sort.
+ */
+template <typename T, typename Clave>
+void QuicksortExterno<T, Clave>::updateOrdenamiento(OrdenamientoMemoria algoritmo, size_t memoria_auxiliar) {
+    this->ordenamiento = algoritmo;
+    this->memoria_auxiliar = memoria_auxiliar;
+    gobernador_auxiliar.configurar(memoria_auxiliar);
+}
+
+/**
+ * Cambia cuántas claves por partición se muestrean para elegir los pivotes (planificarMuestreo).
+ * @param factor Muestras por partición; con 1 cada pivote sale de una sola muestra, como con un solo bloque.
+ */
+template <typename T, typename Clave>
+void QuicksortExterno<T, Clave>::updateSobremuestreo(size_t factor) {
+    this->sobremuestreo = std::max<size_t>(factor, 1);
+}
+
+/**
+ * Cambia las instrucciones con que particionar_archivo clasifica las claves (ClasificadorParticiones).
+ * @param nivel Nivel soportado por la CPU; por defecto se usa nivelSimdDisponible().
+ */
+template <typename T, typename Clave>
+void QuicksortExterno<T, Clave>::updateNivelSimd(NivelSimd nivel) {
+    this->nivel_simd = nivel;
+}
+
+/**
+ * Activa o desactiva el registro de los pasos terminados en un manifiesto junto al archivo de salida.
+ * @param activar true para registrar los pasos y retomar una llamada interrumpida.
+ */
+template <typename T, typename Clave>
+void QuicksortExterno<T, Clave>::updateCheckpoint(bool activar) {
+    this->checkpoint = activar;
+}
+
+/**
+ * Cambia los directorios donde se crean las particiones y sus resultados ordenados.
+ * @param directorios Directorios de los temporales, idealmente en discos distintos; vacío para dejarlos junto a la salida.
+ * @param politica Rotacion o EspacioLibre.
+ */
+template <typename T, typename Clave>
+void QuicksortExterno<T, Clave>::updateDirectoriosTemporales(const std::vector<std::string>& directorios, PoliticaTemporales politica) {
+    temporales.configurar(directorios, politica);
+}
+
+/**
+ * Reinicia el contador de operaciones de E/S a cero.
+ */
+template <typename T, typename Clave>
+void QuicksortExterno<T, Clave>::resetContadorIO() {
+    contador_io = 0;
+}
+
+/**
+ * Obtiene el número de registros en un archivo binario.
+ * @param file_name Nombre del archivo.
+ * @return Número de elementos de 64 bits en el archivo.
+ */
+template <typename T, typename Clave>
+size_t QuicksortExterno<T, Clave>::get_num_elements_in_file(const std::string& file_name) {
+    std::unique_ptr<ArchivoBloques> file = abrirArchivoBloques(dispositivo, file_name, ModoApertura::Lectura);
+    if (!file) {
+        // std::cerr << "Error abriendo archivo para obtener tamaño: " << file_name << std::endl;
+        return 0; // O lanzar excepción
+    }
+    return static_cast<size_t>(file->tamano() / sizeof(T));
+}
+
+/**
+ * Genera el nombre de un archivo temporal. El nombre se deriva del prefijo de la llamada (el archivo de salida, o
+ * el identificador de un flujo), así dos llamadas o dos flujos no comparten temporales, y del nodo del árbol de
+ * particiones que lo produce, así las tareas en paralelo no comparten temporales y al retomar cada uno se llama
+ * igual que antes, sin importar el orden en que terminaron; el directorio lo elige 'temporales'.
+ * @param prefijo Nombre base de los temporales de la llamada.
+ * @param nodo Camino del temporal en el árbol de particiones, distinto para cada temporal.
+ * @return Ruta del archivo temporal.
+ */
+template <typename T, typename Clave>
+std::string QuicksortExterno<T, Clave>::generar_nombre_temporal(const std::string& prefijo, const std::string& nodo) {
+    return temporales.ruta(prefijo, ".temp_qsort" + nodo + ".bin", &manifiesto);
+}
+
+/**
+ * Valida un temporal antes de reutilizarlo, contando los bloques releídos.
+ * @param file_name Nombre del archivo temporal.
+ * @return true si el archivo es de esta llamada o coincide con lo registrado en el manifiesto.
+ */
+template <typename T, typename Clave>
+bool QuicksortExterno<T, Clave>::validar_heredado(const std::string& file_name) {
+    size_t bloques_leidos = 0;
+    bool valido = manifiesto.validar(file_name, B_bytes, bloques_leidos);
+    contador_io += bloques_leidos;
+    return valido;
+}
+
+
+/**
+ * Ordena en memoria una partición que cabe completamente en la memoria principal.
+ * Lee de 'input_filename', ordena y escribe el resultado en su zona del archivo de salida, que ya tiene su tamaño
+ * final. La lectura, el ordenamiento y la escritura se solapan con ordenarEnPipeline usando el pool de hilos.
+ * @param input_filename nombre archivo a ordenar
+ * @param num_elements numero de elementos en el archivo
+ * @param output_filename nombre del archivo de salida, reservado con reservarArchivo
+ * @param output_offset posición en bytes de la zona donde se escribe el resultado
+ * @param auxiliar bytes permitidos para el buffer auxiliar de radix sort en esta llamada
+ * @return suma de verificación de la zona escrita; si falla una apertura, una lectura o una escritura marca error_io
+ */
+template <typename T, typename Clave>
+uint64_t QuicksortExterno<T, Clave>::sort_in_memory_and_write(const std::string& input_filename, size_t num_elements, const std::string& output_filename,
+                                                              uint64_t output_offset, size_t auxiliar) {
+    SumaVerificacion sum;
+    if (num_elements == 0) {
+        return sum.valor();
+    }
+
+    std::unique_ptr<ArchivoBloques> in_file = abrirArchivoBloques(dispositivo, input_filename, ModoApertura::Lectura);
+    if (!in_file) {
+        std::cerr << "Error al abrir la partición: " << input_filename << std::endl;
+        error_io = true;
+        return 0;
+    }
+
+    std::unique_ptr<ArchivoBloques> out_file = abrirArchivoBloques(dispositivo, output_filename, ModoApertura::Actualizacion);
+    if (!out_file) {
+        std::cerr << "Error al abrir archivo de salida: " << output_filename << std::endl;
+        error_io = true;
+        return 0;
+    }
+
+    size_t elements_per_B_block = B_bytes / sizeof(T);
+    if (elements_per_B_block == 0) elements_per_B_block = 1; // Evitar división por cero si B es muy pequeño
+
+    std::vector<T> data_to_sort(num_elements);
+    bool escritura_corta = false;
+
+    // Lectura secuencial de a un bloque
+    uint64_t read_offset = 0;
+    auto read_block = [&](T* destination, size_t count) -> size_t {
+        size_t actual_read = in_file->leer(destination, count * sizeof(T), read_offset) / sizeof(T);
+        read_offset += actual_read * sizeof(T);
+        contador_io++;
+        return actual_read;
+    };
+
+    // Escritura secuencial de a un bloque, dentro de la zona
+    uint64_t write_offset = output_offset;
+    auto write_block = [&](const T* source, size_t count) {
+        size_t escritos = out_file->escribir(source, count * sizeof(T), write_offset);
+        escritura_corta = escritura_corta || escritos != count * sizeof(T);
+        write_offset += escritos;
+        sum.agregar(source, count * sizeof(T));
+        contador_io++;
+    };
+
+    size_t ordenados = ordenarEnPipeline<T, Clave>(data_to_sort.data(), num_elements, elements_per_B_block, *pool,
+                                                   read_block, write_block, ordenamiento, auxiliar);
+    if (ordenados != num_elements || escritura_corta) {
+        std::cerr << "Error al ordenar la partición " << input_filename << ": se leyeron " << ordenados << " de "
+                  << num_elements << " registros" << (escritura_corta ? " y una escritura quedó incompleta" : "") << std::endl;
+        error_io = true;
+    }
+    return sum.valor();
+}
+
+/**
+ * Selecciona los pivotes de 'input_filename' por sobremuestreo (planificarMuestreo): lee bloques distintos al azar,
+ * en orden de posicion, toma de cada uno algunas claves al azar y devuelve los cuantiles equiespaciados de la
+ * muestra. La cantidad de pivotes se adapta al tamaño del archivo, a lo mas 'arity_a' - 1, más un pivote repetido
+ * por cada clave pesada de la muestra, que pide su partición de iguales.
+ * @param input_filename Archivo del cual seleccionar pivotes.
+ * @param num_elements_in_file Número total de elementos en 'input_filename'.
+ * @return Vector con los pivotes seleccionados y ordenados.
+ */
+template <typename T, typename Clave>
+std::vector<int64_t> QuicksortExterno<T, Clave>::seleccionar_pivotes(const std::string& input_filename, size_t num_elements_in_file) {
+    if (num_elements_in_file == 0) {
+        return {};
+    }
+
+    std::unique_ptr<ArchivoBloques> file = abrirArchivoBloques(dispositivo, input_filename, ModoApertura::Lectura);
+    if (!file) {
+        std::cerr << "Error al abrir archivo para elegir pivotes: " << input_filename << std::endl;
+        error_io = true;
+        return {};
+    }
+
+    size_t elements_per_B_block = B_bytes / sizeof(T);
+    if (elements_per_B_block == 0) elements_per_B_block = 1;
+    size_t num_total_blocks_in_file = (num_elements_in_file + elements_per_B_block - 1) / elements_per_B_block;
+
+    PlanMuestreo muestreo = planificarMuestreo(num_elements_in_file, M_bytes / sizeof(T), arity_a, elements_per_B_block,
+                                               sobremuestreo);
+    size_t por_bloque = (muestreo.muestras + muestreo.bloques - 1) / muestreo.bloques;
+
+    // Usar C++11 <random> para mejor aleatoriedad y selección
+    std::random_device rd;
+    std::mt19937_64 g(rd());
+
+    // Bloques distintos al azar, ya en orden de posicion (seleccion secuencial de Knuth)
+    std::vector<int64_t> sample; // Claves de los registros elegidos
+    std::vector<T> block_elements_buffer(elements_per_B_block);
+    Clave clave_de;
+    size_t faltan = muestreo.bloques;
+    for (size_t bloque = 0; bloque < num_total_blocks_in_file && faltan > 0; ++bloque) {
+        if (g() % (num_total_blocks_in_file - bloque) >= faltan) continue;
+        faltan--;
+        size_t elements_read_from_block = file->leer(block_elements_buffer.data(), elements_per_B_block * sizeof(T),
+                                                     static_cast<uint64_t>(bloque) * elements_per_B_block * sizeof(T)) / sizeof(T);
+        contador_io++;
+        if (elements_read_from_block == 0) {
+            std::cerr << "Error al leer archivo para elegir pivotes: " << input_filename << std::endl;
+            error_io = true;
+            return {};
+        }
+
+        // Mezcla parcial: las primeras 'tomar' posiciones quedan con registros al azar del bloque
+        size_t tomar = std::min(por_bloque, elements_read_from_block);
+        for (size_t i = 0; i < tomar; ++i) {
+            std::swap(block_elements_buffer[i], block_elements_buffer[i + g() % (elements_read_from_block - i)]);
+            sample.push_back(clave_de(block_elements_buffer[i]));
+        }
+    }
+    file.reset();
+
+    if (sample.empty()) {
+        return {}; // No se pudo leer nada
+    }
+
+    // Cuantiles equiespaciados de la muestra
+    std::sort(sample.begin(), sample.end());
+    std::vector<int64_t> pivots;
+    for (size_t j = 1; j < muestreo.particiones; ++j) {
+        pivots.push_back(sample[j * sample.size() / muestreo.particiones]);
+    }
+
+    // Una clave que ocupa en la muestra lo de una partición entera queda repetida, para que tenga su partición
+    // de iguales: sin ella todas sus copias caerían siempre en la misma partición y nunca cabrían en memoria
+    size_t pesada = std::max<size_t>(sample.size() / muestreo.particiones, 1);
+    for (size_t i = 0; i < sample.size();) {
+        size_t fin = std::upper_bound(sample.begin() + i, sample.end(), sample[i]) - sample.begin();
+        if (fin - i >= pesada) {
+            size_t veces = std::count(pivots.begin(), pivots.end(), sample[i]);
+            for (; veces < 2; ++veces) {
+                pivots.push_back(sample[i]);
+            }
+        }
+        i = fin;
+    }
+    std::sort(pivots.begin(), pivots.end());
+    return pivots;
+}
+
+/**
+ * Particiona 'input_filename' en archivos temporales por rangos de claves separados por los 'pivots'. Un pivote
+ * repetido tiene además su propia partición de iguales, con solo esa clave: ya está ordenada y no se vuelve a
+ * particionar, así una clave con más copias que M no hace recursión sin fin.
+ * M se reparte entre el búfer de lectura y los búferes de escritura de las particiones (planificarBuffers),
+ * así cada lectura y cada escritura transfiere varios bloques contiguos.
+ * Las claves se clasifican por lotes con ClasificadorParticiones, un árbol de búsqueda sobre los límites que se
+ * recorre sin saltos, en vez de comparar cada clave con los límites uno por uno.
+ * @param input_filename Archivo a particionar.
+ * @param num_elements_total Número de elementos en 'input_filename'.
+ * @param pivots Vector de pivotes ordenados.
+ * @param partition_sums Recibe la suma de verificación de cada partición.
+ * @param sorted_partitions Recibe si cada partición tiene una sola clave y por lo tanto ya está ordenada.
+ * @param prefijo Nombre base de los temporales de la llamada (generar_nombre_temporal).
+ * @param nodo Camino del archivo en el árbol de particiones; la partición i se nombra con nodo + "_i".
+ * @return Vector de pares, donde cada par contiene el nombre del archivo de partición temporal y el número de elementos que contiene.
+ * Vacío si falla una apertura, una lectura o una escritura: marca error_io, borra las particiones a medio escribir y
+ * deja la entrada como estaba.
+ */
+template <typename T, typename Clave>
+std::vector<std::pair<std::string, size_t>> QuicksortExterno<T, Clave>::particionar_archivo(
+    const std::string& input_filename,
+    size_t num_elements_total,
+    const std::vector<int64_t>& pivots,
+    std::vector<uint64_t>& partition_sums,
+    std::vector<bool>& sorted_partitions,
+    const std::string& prefijo,
+    const std::string& nodo) {
+
+    // Límites inferiores de las particiones 1..k; la partición i tiene las claves de [limites[i-1], limites[i]).
+    // Un pivote repetido p agrega el límite p + 1, que cierra la partición de iguales [p, p + 1)
+    std::vector<int64_t> limites;
+    for (size_t i = 0; i < pivots.size();) {
+        size_t fin = std::upper_bound(pivots.begin() + i, pivots.end(), pivots[i]) - pivots.begin();
+        int64_t p = pivots[i];
+        limites.push_back(p);
+        bool siguiente_cierra = (fin < pivots.size() && pivots[fin] == p + 1);
+        if (fin - i > 1 && p != INT64_MAX && !siguiente_cierra) limites.push_back(p + 1);
+        i = fin;
+    }
+
+    std::vector<std::pair<std::string, size_t>> partition_files_info;
+    const size_t num_partitions = limites.size() + 1;
+    // Una partición donde cabe una sola clave ya está ordenada
+    for (size_t i = 0; i < num_partitions; ++i) {
+        bool una_clave;
+        if (i == 0) {
+            una_clave = !limites.empty() && limites[0] <= INT64_MIN + 1;
+        } else if (i < limites.size()) {
+            una_clave = (limites[i] == limites[i - 1] + 1);
+        } else {
+            una_clave = (limites[i - 1] == INT64_MAX);
+        }
+        sorted_partitions.push_back(una_clave);
+    }
+
+    std::vector<SumaVerificacion> sums(num_partitions);
+    std::vector<std::unique_ptr<ArchivoBloques>> out_files_ptr(num_partitions);
+    std::vector<uint64_t> out_offsets(num_partitions, 0);
+    std::vector<std::string> temp_filenames(num_partitions);
+    std::vector<size_t> elements_in_partition_count(num_partitions, 0);
+    
+    // Repartir M entre el búfer de lectura y los búferes de cada partición, cada transferencia mueve varios bloques
+    PlanBuffers plan = planificarBuffers(M_bytes, B_bytes, 1, num_partitions);
+    {
+        std::lock_guard<std::mutex> lock(mutex_plan);
+        plan_particion = plan;
+    }
+
+    // Búferes de escritura de las particiones, contiguos en un solo arreglo: la partición i usa
+    // [i * elements_per_buffer_for_write, (i + 1) * elements_per_buffer_for_write)
+    size_t elements_per_buffer_for_write = plan.elementosPorBuffer(sizeof(T));
+    if (elements_per_buffer_for_write == 0) elements_per_buffer_for_write = 1;
+    std::vector<T> partition_write_buffers(num_partitions * elements_per_buffer_for_write);
+    std::vector<size_t> buffered(num_partitions, 0);
+
+    // Ante un error se cierran y se borran las particiones creadas; la entrada no se toca
+    auto fallar = [&](const std::string& mensaje, const std::string& archivo) {
+        std::cerr << mensaje << archivo << std::endl;
+        error_io = true;
+        for (size_t i = 0; i < num_partitions; ++i) {
+            if (!out_files_ptr[i]) continue;
+            out_files_ptr[i].reset();
+            remove(temp_filenames[i].c_str());
+        }
+        return std::vector<std::pair<std::string, size_t>>();
+    };
+
+    for (size_t i = 0; i < num_partitions; ++i) {
+        temp_filenames[i] = generar_nombre_temporal(prefijo, nodo + "_" + std::to_string(i));
+        out_files_ptr[i] = abrirArchivoBloques(dispositivo, temp_filenames[i], ModoApertura::Escritura);
+        if (!out_files_ptr[i]) return fallar("Error al abrir archivo de partición: ", temp_filenames[i]);
+    }
+
+    bool escritura_corta = false;
+    auto flush_partition = [&](size_t i) {
+        const T* datos = partition_write_buffers.data() + i * elements_per_buffer_for_write;
+        size_t escritos = out_files_ptr[i]->escribir(datos, buffered[i] * sizeof(T), out_offsets[i]);
+        escritura_corta = escritura_corta || escritos != buffered[i] * sizeof(T);
+        out_offsets[i] += escritos;
+        sums[i].agregar(datos, buffered[i] * sizeof(T));
+        contador_io += bloquesTransferidos(buffered[i] * sizeof(T), B_bytes); // El último bloque parcial cuenta como una E/S
+        buffered[i] = 0;
+    };
+
+    std::unique_ptr<ArchivoBloques> in_file = abrirArchivoBloques(dispositivo, input_filename, ModoApertura::Lectura);
+    if (!in_file) return fallar("Error al abrir archivo a particionar: ", input_filename);
+    uint64_t in_offset = 0;
+
+    size_t elements_per_buffer_for_read = plan.elementosPorBuffer(sizeof(T));
+    if (elements_per_buffer_for_read == 0) elements_per_buffer_for_read = 1;
+    std::vector<T> read_buffer_vec(elements_per_buffer_for_read);
+    Clave clave_de;
+    size_t elements_processed = 0;
+
+    // Las claves se clasifican por lotes con el árbol de límites y después se reparten los registros
+    ClasificadorParticiones clasificador(limites, nivel_simd);
+    int64_t batch_keys[LOTE_CLASIFICACION];
+    uint32_t batch_partitions[LOTE_CLASIFICACION];
+
+    while (elements_processed < num_elements_total) {
+        size_t elements_to_read_this_block = std::min(elements_per_buffer_for_read, num_elements_total - elements_processed);
+        if (elements_to_read_this_block == 0) break;
+
+        size_t actual_read = in_file->leer(read_buffer_vec.data(), elements_to_read_this_block * sizeof(T), in_offset) / sizeof(T);
+        in_offset += actual_read * sizeof(T);
+        contador_io += bloquesTransferidos(actual_read * sizeof(T), B_bytes);
+
+        if (actual_read == 0) { // EOF o error antes de leer todos los registros
+            break;
+        }
+
+        for (size_t start = 0; start < actual_read; start += LOTE_CLASIFICACION) {
+            size_t batch = std::min(LOTE_CLASIFICACION, actual_read - start);
+            for (size_t i = 0; i < batch; ++i) {
+                batch_keys[i] = clave_de(read_buffer_vec[start + i]);
+            }
+            clasificador.clasificar(batch_keys, batch, batch_partitions);
+
+            for (size_t i = 0; i < batch; ++i) {
+                size_t partition_idx = batch_partitions[i];
+                partition_write_buffers[partition_idx * elements_per_buffer_for_write + buffered[partition_idx]] =
+                    read_buffer_vec[start + i];
+                elements_in_partition_count[partition_idx]++;
+                if (++buffered[partition_idx] == elements_per_buffer_for_write) {
+                    flush_partition(partition_idx);
+                }
+            }
+        }
+        elements_processed += actual_read;
+        if (escritura_corta) return fallar("Error al escribir las particiones de: ", input_filename);
+    }
+    in_file.reset();
+    if (elements_processed < num_elements_total) return fallar("Error al leer archivo a particionar: ", input_filename);
+
+    // Escribir los datos restantes en los búferes de partición
+    for (size_t i = 0; i < num_partitions; ++i) {
+        if (buffered[i] > 0) {
+            flush_partition(i);
+        }
+    }
+    if (escritura_corta) return fallar("Error al escribir las particiones de: ", input_filename);
+    for (size_t i = 0; i < num_partitions; ++i) {
+        out_files_ptr[i].reset();
+        partition_files_info.emplace_back(temp_filenames[i], elements_in_partition_count[i]);
+        partition_sums.push_back(sums[i].valor());
+    }
+    return partition_files_info;
+}
+
+/**
+ * Copia una partición de iguales, que ya está ordenada, a su zona del archivo de salida.
+ * @param input_filename Partición a copiar.
+ * @param output_filename Archivo de salida, reservado con reservarArchivo.
+ * @param output_offset Posición en bytes de la zona.
+ * @return Suma de verificación de la zona escrita. Si falla una apertura, una lectura o una escritura marca error_io.
+ */
+template <typename T, typename Clave>
+uint64_t QuicksortExterno<T, Clave>::copiar_a_salida(const std::string& input_filename, const std::string& output_filename, uint64_t output_offset) {
+    SumaVerificacion sum;
+    std::unique_ptr<ArchivoBloques> in_file = abrirArchivoBloques(dispositivo, input_filename, ModoApertura::Lectura);
+    if (!in_file) {
+        std::cerr << "Error al abrir la partición: " << input_filename << std::endl;
+        error_io = true;
+        return 0;
+    }
+    std::unique_ptr<ArchivoBloques> out_file = abrirArchivoBloques(dispositivo, output_filename, ModoApertura::Actualizacion);
+    if (!out_file) {
+        std::cerr << "Error al abrir archivo de salida: " << output_filename << std::endl;
+        error_io = true;
+        return 0;
+    }
+
+    size_t elements_per_B_block = B_bytes / sizeof(T);
+    if (elements_per_B_block == 0) elements_per_B_block = 1;
+    std::vector<T> buffer_vec(elements_per_B_block);
+
+    uint64_t in_offset = 0;
+    uint64_t out_offset = output_offset;
+    while (true) {
+        size_t read_count = in_file->leer(buffer_vec.data(), elements_per_B_block * sizeof(T), in_offset) / sizeof(T);
+        in_offset += read_count * sizeof(T);
+        if (read_count > 0) {
+            contador_io++; // Contar lectura
+            size_t escritos = out_file->escribir(buffer_vec.data(), read_count * sizeof(T), out_offset);
+            out_offset += escritos;
+            sum.agregar(buffer_vec.data(), read_count * sizeof(T));
+            contador_io++; // Contar escritura
+            if (escritos != read_count * sizeof(T)) {
+                std::cerr << "Error al escribir en el archivo de salida: " << output_filename << std::endl;
+                error_io = true;
+                break;
+            }
+        }
+        if (read_count < elements_per_B_block) { // EOF o error
+            break;
+        }
+    }
+    // Una lectura que falla antes del final deja la zona incompleta
+    if (!error_io && in_offset != in_file->tamano()) {
+        std::cerr << "Error al leer la partición: " << input_filename << std::endl;
+        error_io = true;
+    }
+    return sum.valor();
+}
+
+/**
+ * Subproblema del quicksort: ordenar 'entrada' en su zona del archivo de salida, que empieza en 'offset'. Los
+ * subproblemas forman un árbol y cada uno es una tarea del planificador.
+ */
+template <typename T, typename Clave>
+struct QuicksortExterno<T, Clave>::NodoQuicksort {
+    std::string entrada;
+    size_t elementos;
+    std::string salida;     // Archivo de salida de la llamada, también da nombre a los temporales
+    uint64_t offset;        // Posición en bytes de la zona del nodo en el archivo de salida
+    std::string id;         // Camino en el árbol de particiones, prefijo de los temporales del nodo
+    bool entrada_temporal;  // La entrada es una partición del padre, se borra cuando ya no se necesita
+    bool ordenada;          // La entrada es una partición de iguales, se copia tal cual
+};
+
+/**
+ * Función principal de Quicksort Externo.
+ * Ordena el archivo 'input_filename' que contiene 'num_elements' y escribe el resultado en 'output_filename'.
+ * La salida se reserva con su tamaño final y cada partición conoce su zona: la suma de los tamaños de las particiones
+ * anteriores. Así cada hoja del árbol (una partición ordenada en memoria o una partición de iguales) escribe directo
+ * en su lugar y no hay concatenaciones.
+ * Las particiones de un archivo son independientes, así que cada una se ordena en una tarea del planificador y los
+ * subproblemas avanzan en paralelo. La memoria de las tareas en curso se reparte con gobernador_memoria: particionar
+ * reserva M completa y ordenar en memoria reserva lo que ocupa la partición, así la suma nunca pasa M.
+ * Cada partición y cada zona escrita se registran en el manifiesto (si está abierto). Los temporales y las zonas se
+ * nombran por su camino en el árbol, así al retomar se saltan los mismos pasos aunque las tareas hayan terminado en
+ * otro orden.
+ * @param current_input_file nombre del archivo actual que se esta ordenando
+ * @param num_elements_in_partition numero de elementos en esta particion
+ * @param final_output_file_for_this_recursion nombre del archivo de salida final
+ * @return false si un temporal o una zona heredados de una llamada anterior no pasaron la validación, o si hubo un
+ * error de I/O (error_io)
+ */
+template <typename T, typename Clave>
+bool QuicksortExterno<T, Clave>::quicksort_recursivo(const std::string& current_input_file, size_t num_elements_in_partition, const std::string& final_output_file_for_this_recursion) {
+    if (num_elements_in_partition == 0) {
+        abrirArchivoBloques(dispositivo, final_output_file_for_this_recursion, ModoApertura::Escritura);
+        return true;
+    }
+
+    // La salida se reserva una vez; al retomar ya tiene las zonas terminadas y no se vuelve a crear
+    uint64_t bytes_salida = static_cast<uint64_t>(num_elements_in_partition) * sizeof(T);
+    PasoManifiesto paso;
+    if (manifiesto.buscar(clavePaso("salida", final_output_file_for_this_recursion), paso)) {
+        if (get_num_elements_in_file(final_output_file_for_this_recursion) != num_elements_in_partition) return false;
+    } else {
+        if (!reservarArchivo(final_output_file_for_this_recursion, bytes_salida)) {
+            std::cerr << "Error: No se pudo crear el archivo de salida " << final_output_file_for_this_recursion << std::endl;
+            error_io = true;
+            return false;
+        }
+        manifiesto.registrar(clavePaso("salida", final_output_file_for_this_recursion), 0, {});
+    }
+
+    NodoQuicksort raiz{current_input_file, num_elements_in_partition, final_output_file_for_this_recursion, 0, "", false, false};
+    heredado_invalido = false;
+    planificador->lanzar([this, raiz]() { procesar_nodo(raiz); });
+    planificador->esperarTodas();
+    return !heredado_invalido && !error_io;
+}
+
+/**
+ * Tarea de un subproblema. Una hoja (cabe en memoria, o es una partición de iguales) escribe su zona de la salida y
+ * la registra; si no, el subproblema se particiona y se lanza una tarea por partición no vacía, cada una con la zona
+ * que le toca. Si un temporal o una zona heredados no pasan la validación marca heredado_invalido.
+ * Después de un error de I/O (error_io) no se registra ni se borra nada: con manifiesto la entrada queda para
+ * retomar; sin él ya no sirve y se borra si es una partición propia.
+ * @param nodo Subproblema a procesar.
+ */
+template <typename T, typename Clave>
+void QuicksortExterno<T, Clave>::procesar_nodo(const NodoQuicksort& nodo) {
+    auto abandonar = [&]() {
+        if (nodo.entrada_temporal && !manifiesto.activo()) remove(nodo.entrada.c_str());
+    };
+    if (heredado_invalido) return;
+    if (error_io) {
+        abandonar();
+        return;
+    }
+
+    // Zona ya escrita en una llamada anterior
+    const std::string zona = nodo.salida + "#" + nodo.id;
+    PasoManifiesto paso;
+    if (manifiesto.buscar(clavePaso("orden", zona), paso)) {
+        size_t bloques_leidos = 0;
+        bool valida = manifiesto.validarZona(zona, nodo.salida, nodo.offset, B_bytes, bloques_leidos);
+        contador_io += bloques_leidos;
+        if (!valida) {
+            heredado_invalido = true;
+            return;
+        }
+        if (nodo.entrada_temporal) remove(nodo.entrada.c_str());
+        return;
+    }
+
+    // Partición ya escrita en una llamada anterior: su entrada ya no hace falta, las partes se validan al usarlas
+    std::vector<std::pair<std::string, size_t>> partitions_info;
+    std::vector<bool> sorted_partitions;
+    bool particionado = manifiesto.buscar(clavePaso("particion", zona), paso);
+    if (particionado) {
+        for (const auto& archivo : paso.archivos) {
+            partitions_info.emplace_back(archivo.nombre, static_cast<size_t>(archivo.bytes / sizeof(T)));
+        }
+        PasoManifiesto iguales;
+        bool con_iguales = manifiesto.buscar(clavePaso("iguales", zona), iguales);
+        for (const auto& archivo : paso.archivos) {
+            bool igual = false;
+            for (size_t i = 0; con_iguales && i < iguales.archivos.size(); ++i) {
+                igual = igual || iguales.archivos[i].nombre == archivo.nombre;
+            }
+            sorted_partitions.push_back(igual);
+        }
+    } else if (!validar_heredado(nodo.entrada)) {
+        heredado_invalido = true;
+        return;
+    }
+
+    // Hojas: se escribe la zona, se registra y la entrada ya no hace falta
+    size_t M_elements_capacity = M_bytes / sizeof(T);
+    if (!particionado && (nodo.ordenada || nodo.elementos <= M_elements_capacity)) {
+        uint64_t sum;
+        if (nodo.ordenada) {
+            sum = copiar_a_salida(nodo.entrada, nodo.salida, nodo.offset);
+        } else {
+            // El buffer auxiliar de radix sort sale de memoria_auxiliar si está libre; si no, se ordena con std::sort
+            size_t bytes = nodo.elementos * sizeof(T);
+            ReservaMemoria reserva(gobernador_memoria, bytes);
+            bool con_auxiliar = (ordenamiento == OrdenamientoMemoria::Radix && gobernador_auxiliar.intentarReservar(bytes));
+            sum = sort_in_memory_and_write(nodo.entrada, nodo.elementos, nodo.salida, nodo.offset,
+                                           con_auxiliar ? bytes : 0);
+            if (con_auxiliar) gobernador_auxiliar.liberar(bytes);
+        }
+        if (error_io) {
+            abandonar();
+            return;
+        }
+        manifiesto.registrar(clavePaso("orden", zona), 0, {ArchivoVerificado{zona, nodo.elementos * sizeof(T), sum}});
+        if (nodo.entrada_temporal) remove(nodo.entrada.c_str());
+        return;
+    }
+
+    // Paso recursivo
+    if (!particionado) {
+        ReservaMemoria reserva(gobernador_memoria, M_bytes);
+
+        // 1. Seleccionar pivotes
+        std::vector<int64_t> pivots = seleccionar_pivotes(nodo.entrada, nodo.elementos);
+
+        // 2. Particionar archivo
+        std::vector<uint64_t> partition_sums;
+        if (!error_io) {
+            partitions_info = particionar_archivo(nodo.entrada, nodo.elementos, pivots, partition_sums,
+                                                  sorted_partitions, nodo.salida, nodo.id);
+        }
+        if (error_io) {
+            abandonar();
+            return;
+        }
+
+        // Las particiones de iguales se registran antes que la partición, así al retomar se sabe cuáles son
+        std::vector<ArchivoVerificado> partition_files;
+        std::vector<ArchivoVerificado> equal_files;
+        for (size_t i = 0; i < partitions_info.size(); ++i) {
+            partition_files.push_back(describirArchivo(partitions_info[i].first, partition_sums[i]));
+            if (sorted_partitions[i]) equal_files.push_back(partition_files.back());
+        }
+        if (!equal_files.empty()) {
+            manifiesto.registrar(clavePaso("iguales", zona), 0, equal_files);
+        }
+        manifiesto.registrar(clavePaso("particion", zona), 0, partition_files);
+    }
+    if (nodo.entrada_temporal) remove(nodo.entrada.c_str()); // Eliminar partición cruda (no ordenada)
+
+    // 3. Un subproblema por partición, en la zona que sigue a las de las particiones anteriores
+    uint64_t offset = nodo.offset;
+    for (size_t i = 0; i < partitions_info.size(); ++i) {
+        NodoQuicksort hijo{partitions_info[i].first, partitions_info[i].second, nodo.salida, offset,
+                           nodo.id + "_" + std::to_string(i), true, sorted_partitions[i]};
+        offset += static_cast<uint64_t>(partitions_info[i].second) * sizeof(T);
+        if (hijo.elementos == 0) {
+            remove(hijo.entrada.c_str());
+            continue;
+        }
+        planificador->lanzar([this, hijo]() { procesar_nodo(hijo); });
+    }
+}
+
+// Instancias para los tipos de registro soportados (registro.h)
+#define INSTANCIAR_QUICKSORT(T) template class QuicksortExterno<T>;
+PARA_CADA_REGISTRO(INSTANCIAR_QUICKSORT)
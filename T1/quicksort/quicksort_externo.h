@@ -1,49 +1,124 @@
-#ifndef QUICKSORT_EXTERNO_H
-#define QUICKSORT_EXTERNO_H
-
-#include <string>
-#include <vector>
-#include <cstdint> // Para int64_t
-
-class QuicksortExterno {
-public:
-    //Headers metodos publicos
-    QuicksortExterno(size_t block_size_bytes, size_t memory_size_bytes, size_t arity_a_val);
-
-    void ordenar(const std::string& archivo_entrada, const std::string& archivo_salida);
-
-    size_t obtenerContadorIO() const;
-
-    void resetContadorIO();
-
-private:
-    //Metodos y variables privadas
-    size_t B_bytes;              // Tamaño del bloque de disco en bytes
-    size_t M_bytes;              // Tamaño de la memoria principal en bytes
-    size_t arity_a;              // Número de sub-arreglos para particionar (parámetro 'a')
-    size_t num_pivots_to_select; // arity_a - 1
-
-    size_t contador_io;          // Contador de operaciones de E/S
-    int temp_file_id_counter;    // Contador para generar nombres de archivos temporales únicos
-
-
-    void quicksort_recursivo(const std::string& input_filename, size_t num_elements, const std::string& output_filename);
-
-    void sort_in_memory_and_write(const std::string& input_filename, size_t num_elements, const std::string& output_filename);
-
-    std::vector<int64_t> seleccionar_pivotes(const std::string& input_filename, size_t num_elements_in_file);
-
-    std::vector<std::pair<std::string, size_t>> particionar_archivo(
-        const std::string& input_filename,
-        size_t num_elements_total,
-        const std::vector<int64_t>& pivots
-    );
-
-    void concatenar_archivos(const std::vector<std::string>& nombres_archivos_entrada, const std::string& archivo_salida_final);
-
-    size_t get_num_elements_in_file(const std::string& file_name);
-
-    std::string generar_nombre_temporal();
-};
-
+#ifndef QUICKSORT_EXTERNO_H
+#define QUICKSORT_EXTERNO_H
+
+#include <string>
+#include <vector>
+#include <cstdint> // Para int64_t
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include "../misc/plan_buffers.h"
+#include "../misc/dispositivo_bloques.h"
+#include "../misc/registro.h"
+#include "../misc/ordenamiento_paralelo.h"
+#include "../misc/manifiesto.h"
+#include "../misc/directorios_temporales.h"
+#include "../misc/flujo_ordenado.h"
+#include "../misc/muestreo_pivotes.h"
+#include "../misc/mezcla_simd.h"
+#include "../misc/planificador_tareas.h"
+#include "../misc/gobernador_memoria.h"
+
+template <typename T, typename Clave>
+class FlujoQuicksort;
+
+/**
+ * Quicksort externo sobre archivos de registros de tamaño fijo, ordenados por la clave de 64 bits que entrega 'Clave'.
+ * Los pivotes son claves. Un bloque contiene B / sizeof(T) registros completos.
+ *
+ * Los pivotes salen por sobremuestreo (muestreo_pivotes.h). La aridad a es un maximo: cada archivo se parte en las
+ * particiones justas para que cada una espere la mitad de M, y una que igual salio grande se vuelve a partir. Una
+ * clave repetida que llena una particion entera tiene su propia particion de iguales, que ya esta ordenada y se copia
+ * sin volver a particionarla. Cada subproblema es una tarea del planificador con robo de trabajo, y el gobernador de
+ * memoria limita a M la suma de lo que usan las tareas en curso. La salida se reserva con su tamaño final y cada
+ * particion escribe directo en su zona. Los temporales se nombran por su camino en el arbol de particiones, asi al
+ * retomar desde el manifiesto se llaman igual.
+ * Esta instanciado en quicksort_externo.cpp para los tipos de PARA_CADA_REGISTRO (registro.h).
+ */
+template <typename T = int64_t, typename Clave = ClaveRegistro<T>>
+class QuicksortExterno {
+public:
+    //Headers metodos publicos
+    QuicksortExterno(size_t block_size_bytes, size_t memory_size_bytes, size_t arity_a_val,
+                     TipoDispositivo dispositivo = TipoDispositivo::Posicional);
+
+    void ordenar(const std::string& archivo_entrada, const std::string& archivo_salida);
+
+    std::unique_ptr<FlujoOrdenado<T>> abrirFlujo(const std::string& archivo_entrada);
+
+    size_t obtenerContadorIO() const;
+
+    void resetContadorIO();
+
+    const PlanBuffers& obtenerPlanParticion() const;
+
+    void updateHilos(unsigned hilos);
+
+    void updateOrdenamiento(OrdenamientoMemoria algoritmo, size_t memoria_auxiliar);
+
+    void updateSobremuestreo(size_t factor);
+
+    void updateNivelSimd(NivelSimd nivel);
+
+    void updateCheckpoint(bool activar);
+
+    void updateDirectoriosTemporales(const std::vector<std::string>& directorios,
+                                     PoliticaTemporales politica = PoliticaTemporales::Rotacion);
+
+private:
+    friend class FlujoQuicksort<T, Clave>;
+
+    //Metodos y variables privadas
+    size_t B_bytes;              // Tamaño del bloque de disco en bytes
+    size_t M_bytes;              // Tamaño de la memoria principal en bytes
+    size_t arity_a;              // Máximo de sub-arreglos en que se particiona (parámetro 'a')
+    TipoDispositivo dispositivo; // Forma de leer y escribir bloques
+
+    std::atomic<size_t> contador_io; // Contador de operaciones de E/S, las tareas en paralelo lo incrementan a la vez
+    PlanBuffers plan_particion;  // Reparto de M usado en el último particionamiento
+    std::mutex mutex_plan;       // Protege plan_particion, que escriben las tareas al particionar
+    std::unique_ptr<PoolHilos> pool; // Hilos que ordenan las particiones en memoria
+    std::unique_ptr<PlanificadorTareas> planificador; // Hilos que particionan y ordenan los subproblemas en paralelo
+    GobernadorMemoria gobernador_memoria;   // Reparte M entre las tareas en curso
+    GobernadorMemoria gobernador_auxiliar;  // Reparte memoria_auxiliar entre los ordenamientos en curso
+    std::atomic<bool> heredado_invalido;    // Alguna tarea encontró un temporal heredado que no pasó la validación
+    std::atomic<bool> error_io;             // Alguna tarea falló al abrir, leer o escribir un archivo
+    OrdenamientoMemoria ordenamiento; // Algoritmo que ordena las particiones en memoria
+    size_t memoria_auxiliar;     // Bytes extra permitidos para el buffer auxiliar de radix sort
+    bool checkpoint;             // Indica si los pasos terminados se registran en un manifiesto para retomarlos
+    size_t sobremuestreo;        // Claves muestreadas por partición al elegir los pivotes
+    NivelSimd nivel_simd;        // Instrucciones con que se clasifican las claves al particionar
+    Manifiesto manifiesto;       // Particiones y ordenamientos terminados de la llamada en curso
+    DirectoriosTemporales temporales; // Directorios donde se reparten las particiones
+
+    struct NodoQuicksort;
+
+    bool quicksort_recursivo(const std::string& input_filename, size_t num_elements, const std::string& output_filename);
+
+    void procesar_nodo(const NodoQuicksort& nodo);
+
+    uint64_t sort_in_memory_and_write(const std::string& input_filename, size_t num_elements, const std::string& output_filename,
+                                      uint64_t output_offset, size_t auxiliar);
+
+    std::vector<int64_t> seleccionar_pivotes(const std::string& input_filename, size_t num_elements_in_file);
+
+    std::vector<std::pair<std::string, size_t>> particionar_archivo(
+        const std::string& input_filename,
+        size_t num_elements_total,
+        const std::vector<int64_t>& pivots,
+        std::vector<uint64_t>& partition_sums,
+        std::vector<bool>& sorted_partitions,
+        const std::string& prefijo,
+        const std::string& nodo
+    );
+
+    uint64_t copiar_a_salida(const std::string& input_filename, const std::string& output_filename, uint64_t output_offset);
+
+    size_t get_num_elements_in_file(const std::string& file_name);
+
+    std::string generar_nombre_temporal(const std::string& prefijo, const std::string& nodo);
+
+    bool validar_heredado(const std::string& file_name);
+};
+
 #endif // QUICKSORT_EXTERNO_H
\ No newline at end of file